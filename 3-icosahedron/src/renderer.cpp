@@ -29,7 +29,7 @@ const std::vector<Vertex> vertices{
     {{ -Z,  -X, 0.0}, {0.0, 1.0, 1.0}},
 };
 
-const std::vector<GLuint> indices{
+const std::vector<GLushort> indices{ // 12 vertices, so 16-bit indices are plenty
     0, 4, 1,
     0, 9, 4,
     9, 5, 4,
@@ -117,7 +117,7 @@ void OpenGLRenderer::startRendering() {
 void OpenGLRenderer::render() {
     shaders->enable();
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // wireframe mode -- try it
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_SHORT, 0);
 }
 
 void OpenGLRenderer::finishRendering() const {
@@ -135,7 +135,7 @@ void OpenGLRenderer::prepareBuffers() {
 
     glGenBuffers(1, &ebo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * indices.size(), indices.data(), GL_STATIC_DRAW);
 
     glVertexAttribPointer(
         0,
@@ -5,9 +5,17 @@ layout (location = 1) in vec3 in_color;
 
 out vec3 color;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 lightDirection; // towards the light
+    vec4 cameraPosition;
+};
+
+layout (std140) uniform ObjectUniforms {
+    mat4 model;
+    mat4 normalMatrix;
+};
 
 void main() {
     gl_Position = projection * view * model * vec4(in_position, 1.0);
@@ -35,7 +35,7 @@ const std::vector<Vertex> vertices{
 };
 
 // each of these triples is a triangle
-const std::vector<GLuint> indices{
+const std::vector<GLushort> indices{ // 12 vertices, so 16-bit indices are plenty
     0, 4, 1,
     0, 9, 4,
     9, 5, 4,
@@ -106,10 +106,15 @@ OpenGLRenderer::OpenGLRenderer(const int windowWidth, const int windowHeight) {
         "../4-icosahedron-moving/shaders/main.frag"
     );
 
+    frameUniforms = std::make_unique<UniformBuffer<FrameUniforms>>();
+    objectUniforms = std::make_unique<UniformBuffer<ObjectUniforms>>();
+
     prepareBuffers();
 }
 
 OpenGLRenderer::~OpenGLRenderer() {
+    frameUniforms.reset(); // have to go while the context is still alive
+    objectUniforms.reset();
     glDeleteBuffers(1, &vbo);
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &ebo);
@@ -170,11 +175,18 @@ void OpenGLRenderer::startRendering() {
 void OpenGLRenderer::render() {
     shaders->enable();
 
-    shaders->setUniform("model", glm::identity<glm::mat4>());
-    shaders->setUniform("view", getViewMatrix());
-    shaders->setUniform("projection", glm::perspective(glm::radians(fieldOfView), aspectRatio, zNear, zFar));
-
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    frameUniforms->update({
+        .view = getViewMatrix(),
+        .projection = glm::perspective(glm::radians(fieldOfView), aspectRatio, zNear, zFar),
+        .lightDirection = {},
+        .cameraPosition = glm::vec4(cameraPosition, 1.0f),
+    });
+    objectUniforms->update({
+        .model = glm::identity<glm::mat4>(),
+        .normalMatrix = glm::identity<glm::mat4>(),
+    });
+
+    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_SHORT, 0);
 }
 
 void OpenGLRenderer::finishRendering() const {
@@ -192,7 +204,7 @@ void OpenGLRenderer::prepareBuffers() {
 
     glGenBuffers(1, &ebo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * indices.size(), indices.data(), GL_STATIC_DRAW);
 
     glVertexAttribPointer(
         0,
@@ -0,0 +1,26 @@
+#version 410
+
+in vec2 tex_coords;
+
+// which page at which level of the virtual texture this fragment samples, with the last component set to 1
+out uvec4 out_page;
+
+uniform vec2 virtualScale;
+uniform float virtualPageCount;
+uniform float pageSize;
+uniform float maxLevel;
+uniform float levelBias; // the feedback target is smaller than the window, so its derivatives are that much larger
+
+// the same lookup as in main.frag, up to the page table
+void main() {
+    vec2 last_texel = virtualScale - 0.5 / (virtualPageCount * pageSize);
+    vec2 virtual_coords = clamp(tex_coords * virtualScale, vec2(0.0), last_texel);
+
+    vec2 texels = virtual_coords * virtualPageCount * pageSize;
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    float level = clamp(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy))) - levelBias), 0.0, maxLevel);
+
+    uvec2 page = uvec2(virtual_coords * virtualPageCount / exp2(level));
+    out_page = uvec4(page, uint(level), 1u);
+}
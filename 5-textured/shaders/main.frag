@@ -4,7 +4,14 @@ in vec2 tex_coords;
 
 out vec4 out_color;
 
-uniform sampler2D colorTexture;
+// the color texture is a virtual texture, of which only the pages in view are resident -- see `VirtualTexture`
+uniform sampler2D pageTable;
+uniform sampler2D physicalPages;
+uniform vec2 virtualScale;      // the part of the virtual texture covered by the image
+uniform float virtualPageCount; // pages along a side of the virtual texture's finest level
+uniform float pageSize;         // texels along a side of a page, not counting its border
+uniform float pageBorder;
+uniform float maxLevel;
 
 float linearize_depth(float depth) {
     float near = 0.1f;
@@ -16,8 +23,30 @@ float linearize_depth(float depth) {
     return linearDepth;
 }
 
+float get_virtual_level(vec2 virtual_coords) {
+    vec2 texels = virtual_coords * virtualPageCount * pageSize;
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    return clamp(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy)))), 0.0, maxLevel);
+}
+
+vec4 sample_virtual(vec2 coords) {
+    // kept half a texel inside the image, so the last row and column never round over into a page past its edge
+    vec2 last_texel = virtualScale - 0.5 / (virtualPageCount * pageSize);
+    vec2 virtual_coords = clamp(coords * virtualScale, vec2(0.0), last_texel);
+    float level = get_virtual_level(virtual_coords);
+
+    // the entry of the page we want points at the finest resident page covering it, which may be a coarser one
+    ivec2 page = ivec2(virtual_coords * virtualPageCount / exp2(level));
+    vec4 entry = round(texelFetch(pageTable, page, int(level)) * 255.0);
+
+    vec2 in_page = fract(virtual_coords * virtualPageCount / exp2(entry.b));
+    vec2 slot_texels = entry.rg * (pageSize + 2.0 * pageBorder) + pageBorder + in_page * pageSize;
+    return textureLod(physicalPages, slot_texels / vec2(textureSize(physicalPages, 0)), 0.0);
+}
+
 void main() {
-    out_color = texture(colorTexture, tex_coords);
+    out_color = sample_virtual(tex_coords);
 
     // visualize the depth buffer
     // out_color = vec4(linearize_depth(gl_FragCoord.z)) / 5; // divide by 5 to make it look a bit clearer; this is purely ad-hoc
@@ -1,5 +1,7 @@
 #include "renderer.hpp"
 
+#include <chrono>
+#include <iostream>
 #include <stdexcept>
 #include <vector>
 #include <string>
@@ -10,11 +12,21 @@
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
-#include <stb_image.h>
-
 #include "utilities/debug.hpp"
+#include "utilities/gl-state.hpp"
 #include "vertex.hpp"
 
+// the image is streamed a page at a time through a physical texture holding this many pages along each side,
+// way less than the whole image takes
+static constexpr int COLOR_TEXTURE_SLOTS_PER_SIDE = 6;
+
+// where the cubes are drawn. one at (1, 0, 0) would z-fight with the first one
+static const glm::vec3 CUBE_POSITIONS[] = {
+    {0.0f, 0.0f, 0.0f},
+    {1.0f, 2.0f, 3.0f},
+    {5.0f, 0.0f, 1.0f},
+};
+
 // we'll move to a simple cube for a moment
 const std::vector<Vertex> vertices{
 //   position               uv
@@ -62,6 +74,12 @@ const std::vector<Vertex> vertices{
 };
 
 OpenGLRenderer::OpenGLRenderer(const int windowWidth, const int windowHeight) {
+    // decoding doesn't need the GL context, so it can start right away and overlap with creating the window
+    threadPool = std::make_unique<ThreadPool>();
+    pendingColorTexture = threadPool->submit([&pool = *threadPool] {
+        return loadVirtualTexture(pool, "../assets/textures/landscape.png");
+    });
+
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -93,10 +111,10 @@ OpenGLRenderer::OpenGLRenderer(const int windowWidth, const int windowHeight) {
 
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
-    glEnable(GL_DEPTH_TEST);
+    getGLState().enable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS); // this is the default -- can be changed
 
-    glEnable(GL_DEBUG_OUTPUT);
+    getGLState().enable(GL_DEBUG_OUTPUT);
 #ifndef __APPLE__
     glDebugMessageCallback(reinterpret_cast<GLDEBUGPROC>(&debugCallback), nullptr);
 #endif
@@ -109,6 +127,13 @@ OpenGLRenderer::OpenGLRenderer(const int windowWidth, const int windowHeight) {
         "../5-textured/shaders/main.vert",
         "../5-textured/shaders/main.frag"
     );
+    feedbackShaders = std::make_unique<GLShaders>(
+        "../5-textured/shaders/main.vert",
+        "../5-textured/shaders/feedback.frag"
+    );
+
+    frameUniforms = std::make_unique<UniformBuffer<FrameUniforms>>();
+    objectUniforms = std::make_unique<UniformBuffer<ObjectUniforms>>();
 
     camera = std::make_unique<Camera>(window);
 
@@ -118,8 +143,11 @@ OpenGLRenderer::OpenGLRenderer(const int windowWidth, const int windowHeight) {
 }
 
 OpenGLRenderer::~OpenGLRenderer() {
-    glDeleteBuffers(1, &vbo);
-    glDeleteVertexArrays(1, &vao);
+    colorTexture.reset(); // needs the context to delete its textures, and the thread pool to finish reading pages
+    frameUniforms.reset();
+    objectUniforms.reset();
+    getGLState().deleteBuffer(vbo);
+    getGLState().deleteVertexArray(vao);
     glfwDestroyWindow(window);
     glfwTerminate();
 }
@@ -135,11 +163,31 @@ void OpenGLRenderer::tickInputEvents() {
                 "../5-textured/shaders/main.vert",
                 "../5-textured/shaders/main.frag"
             );
+            feedbackShaders = std::make_unique<GLShaders>(
+                "../5-textured/shaders/main.vert",
+                "../5-textured/shaders/feedback.frag"
+            );
         }
         wasPressedLastFrame = true;
     } else {
         wasPressedLastFrame = false;
     }
+
+    // print what the virtual texture has been doing since the last time
+    static bool wasStatsKeyPressedLastFrame = false;
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) {
+        if (!wasStatsKeyPressedLastFrame) {
+            const VirtualTextureStats stats = colorTexture->takeStats();
+            std::cout << "virtual texture: " << stats.feedbackCount << " feedback frames, " << stats.hitCount
+                      << " hits, " << stats.missCount << " misses, " << stats.loadedPageCount << " pages loaded, "
+                      << stats.evictedPageCount << " evicted, " << colorTexture->getResidentPageCount() << "/"
+                      << colorTexture->getSlotCount() << " resident, " << colorTexture->getPendingPageCount()
+                      << " pending\n";
+        }
+        wasStatsKeyPressedLastFrame = true;
+    } else {
+        wasStatsKeyPressedLastFrame = false;
+    }
 }
 
 void OpenGLRenderer::startRendering() {
@@ -147,25 +195,46 @@ void OpenGLRenderer::startRendering() {
 }
 
 void OpenGLRenderer::render() {
-    shaders->enable();
-
-    shaders->setUniform("model", glm::identity<glm::mat4>());
-    shaders->setUniform("view", camera->getViewMatrix());
-    shaders->setUniform("projection", camera->getPerspectiveMatrix());
-    shaders->setUniform("colorTexture", 0); // the texture is in slot 0 (GL_TEXTURE0) so that's what we set the uniform to
-
-    glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+    colorTexture->tick();
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+
+    frameUniforms->update({
+        .view = camera->getViewMatrix(),
+        .projection = camera->getPerspectiveMatrix(),
+        .lightDirection = {},
+        .cameraPosition = glm::vec4(camera->getPosition(), 1.0f),
+    });
+
+    objectUniforms->clear();
+    for (const glm::vec3 &position : CUBE_POSITIONS) {
+        objectUniforms->push({
+            .model = glm::translate(glm::identity<glm::mat4>(), position),
+            .normalMatrix = glm::identity<glm::mat4>(),
+        });
+    }
+    objectUniforms->upload();
 
-    shaders->setUniform("model", glm::translate(glm::identity<glm::mat4>(), glm::vec3(1, 2, 3)));
+    // the feedback pass goes first, so that reading it back has the rest of the frame to finish in
+    feedbackShaders->enable();
+    colorTexture->bindFeedback(*feedbackShaders);
 
-    glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+    colorTexture->beginFeedback({width, height});
+    drawCubes();
+    colorTexture->endFeedback({width, height});
 
-    // z-fighting
-    // shaders->setUniform("model", glm::translate(glm::identity<glm::mat4>(), glm::vec3(1, 0, 0)));
+    shaders->enable();
+    colorTexture->bind(*shaders, 0, 1); // the page table goes in slot 0 (GL_TEXTURE0), the pages themselves in slot 1
 
-    shaders->setUniform("model", glm::translate(glm::identity<glm::mat4>(), glm::vec3(5, 0, 1)));
+    drawCubes();
+}
 
-    glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+void OpenGLRenderer::drawCubes() const {
+    for (std::size_t i = 0; i < objectUniforms->getBlockCount(); i++) {
+        objectUniforms->bind(i);
+        glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+    }
 }
 
 void OpenGLRenderer::finishRendering() const {
@@ -175,10 +244,10 @@ void OpenGLRenderer::finishRendering() const {
 
 void OpenGLRenderer::prepareBuffers() {
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    getGLState().bindVertexArray(vao);
 
     glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    getGLState().bindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
 
     glVertexAttribPointer(
@@ -203,39 +272,34 @@ void OpenGLRenderer::prepareBuffers() {
 }
 
 void OpenGLRenderer::loadTextures() {
-    int width, height, channelCount;
-    unsigned char *data = stbi_load("../assets/textures/uvtest.png", &width, &height, &channelCount, 0);
-    if (!data) {
-        throw std::runtime_error("failed to load texture!");
+    // waits for the virtual texture opened in the constructor, rethrowing any error it ran into.
+    // only its coarsest page is uploaded here -- the rest are streamed in as the feedback asks for them
+    colorTexture = std::make_unique<VirtualTexture>(*threadPool, pendingColorTexture.get(),
+                                                    COLOR_TEXTURE_SLOTS_PER_SIDE);
+}
+
+std::unique_ptr<VirtualTextureFile> OpenGLRenderer::loadVirtualTexture(ThreadPool &threadPool,
+                                                                       const std::filesystem::path &path) {
+    // the cooked file goes next to its source asset, so it's found no matter which directory the app is run from
+    const std::filesystem::path cookedPath = std::filesystem::path(path).replace_extension(".vtex");
+
+    if (std::unique_ptr<VirtualTextureFile> file = VirtualTextureFile::open(cookedPath, path)) {
+        return file;
     }
 
-    glGenTextures(1, &colorTextureID);
-    glActiveTexture(GL_TEXTURE0); // there are guaranteed 16 slots from GL_TEXTURE0 to GL_TEXTURE16; we put this texture in slot 0
-    glBindTexture(GL_TEXTURE_2D, colorTextureID);
-
-    // feel free to experiment with these 4!
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // border color used when we set either of the GL_TEXTURE_WRAP_* to GL_CLAMP_TO_BORDER
-    constexpr float borderColor[] = { 1.0f, 1.0f, 0.0f, 1.0f };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-    glTexImage2D(
-        GL_TEXTURE_2D,    // target bind point -- we called glBindTexture(GL_TEXTURE_2D, ...) so we pick GL_TEXTURE_2D
-        0,                // mipmap layer -- when loading images we always load into the first layer and generate the rest
-        GL_RGB,           // internal format -- for simplicity it's just RGB, but we can e.g. specify bit lengths for components
-        width, height,    // width and height of the texture
-        0,                // must be 0 for legacy reasons
-        GL_RGB,           // format of the provided data -- the provided texture has 3 channels, so it's in RGB (could be e.g. RGBA if 4 channels)
-        GL_UNSIGNED_BYTE, // type of each channel's data -- typically textures have 8-bit unsigned int channels, but some are different (e.g. HDR)
-        data              // pointer to the data
-    );
-    glGenerateMipmap(GL_TEXTURE_2D);
+    const auto cookStart = std::chrono::steady_clock::now();
+    VirtualTextureFile::cook(threadPool, path, cookedPath);
+    const auto cookTime = std::chrono::steady_clock::now() - cookStart;
+
+    std::cout << "cooked " << path.string() << " into " << cookedPath.string() << " in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(cookTime).count() << " ms\n";
+
+    std::unique_ptr<VirtualTextureFile> file = VirtualTextureFile::open(cookedPath, path);
+    if (!file) {
+        throw std::runtime_error("failed to open freshly cooked virtual texture: " + cookedPath.string());
+    }
 
-    stbi_image_free(data);
+    return file;
 }
 
 void OpenGLRenderer::windowRefreshCallback(GLFWwindow *window) {
@@ -1,25 +1,39 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include <future>
 #include <memory>
 
 #include "GL/glew.h"
 #include "GLFW/glfw3.h"
 
 #include "utilities/gl-shader.hpp"
+#include "utilities/uniform-buffer.hpp"
+#include "utilities/thread-pool.hpp"
 #include "camera.hpp"
+#include "virtual-texture.hpp"
 
 class OpenGLRenderer {
     glm::ivec2 windowSize;
     GLFWwindow *window;
 
     std::unique_ptr<GLShaders> shaders;
+    std::unique_ptr<GLShaders> feedbackShaders;
+
+    // both passes draw with the same blocks, which are uploaded once per frame. every cube has a block of its own
+    std::unique_ptr<UniformBuffer<FrameUniforms>> frameUniforms;
+    std::unique_ptr<UniformBuffer<ObjectUniforms>> objectUniforms;
 
     GLuint vbo;
     GLuint vao;
     // GLuint ebo; // won't be using indexing for a moment; will bring it back in the next program
 
-    GLuint colorTextureID;
+    // the virtual texture is opened (or cooked) on the thread pool while the rest of the renderer is being set up,
+    // and its pages are read by the workers later on
+    std::unique_ptr<ThreadPool> threadPool;
+    std::future<std::unique_ptr<VirtualTextureFile>> pendingColorTexture;
+
+    std::unique_ptr<VirtualTexture> colorTexture;
 
     // camera stuff won't change too much; we're moving it to a separate class to avoid clutter
     std::unique_ptr<Camera> camera;
@@ -55,10 +69,22 @@ public:
     void finishRendering() const;
 
 private:
+    /**
+     * Draws all the cubes with the currently enabled shaders, binding each one's block of `objectUniforms`.
+     */
+    void drawCubes() const;
+
     void prepareBuffers();
 
     void loadTextures();
 
+    /**
+     * Opens the virtual texture cooked from the image at the given path, cooking it first if there's no usable one
+     * yet. Doesn't touch the GL context, so it's meant to run on the thread pool.
+     */
+    static std::unique_ptr<VirtualTextureFile> loadVirtualTexture(ThreadPool &threadPool,
+                                                                  const std::filesystem::path &path);
+
     static void windowRefreshCallback(GLFWwindow *window);
 
     static void framebufferSizeCallback(GLFWwindow *window, int width, int height);
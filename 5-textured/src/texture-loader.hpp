@@ -0,0 +1,56 @@
+#ifndef TEXTURE_LOADER_HPP
+#define TEXTURE_LOADER_HPP
+
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "utilities/thread-pool.hpp"
+
+/**
+ * Pixels of a decoded image, as tightly packed rows of 8-bit channels, ready to be handed to `glTexImage2D`.
+ */
+struct DecodedTexture {
+    std::unique_ptr<unsigned char, void (*)(void *)> pixels{nullptr, nullptr};
+    int width = 0;
+    int height = 0;
+    int channelCount = 0;
+};
+
+/**
+ * Decodes image files on a thread pool, so that several large textures are decoded at once and none of them holds
+ * up the GL thread, which only has to upload the results.
+ *
+ * Images are flipped by the worker decoding them, if asked to, rather than through
+ * `stbi_set_flip_vertically_on_load` -- that one is a global setting shared by every thread decoding at the time.
+ */
+class TextureLoader {
+    ThreadPool &threadPool;
+
+public:
+    explicit TextureLoader(ThreadPool &threadPool) : threadPool(threadPool) {}
+
+    /**
+     * Starts decoding the image at the given path on one of the workers. The future throws if the image couldn't be
+     * decoded. `channelCount` is the number of channels to convert the image to, or 0 to keep its own.
+     *
+     * Waiting for the result from inside a task running on the same pool may deadlock, use `loadAll` there instead.
+     */
+    std::future<DecodedTexture> load(const std::filesystem::path &path, int channelCount, bool isFlipped) const;
+
+    /**
+     * Decodes all the given images, spreading them over the workers and the calling thread, and waits for them.
+     * This is safe to call from inside a task running on the same pool.
+     */
+    std::vector<DecodedTexture> loadAll(std::span<const std::filesystem::path> paths, int channelCount,
+                                        bool isFlipped) const;
+
+    /**
+     * Decodes the image at the given path on the calling thread.
+     */
+    static DecodedTexture decode(const std::filesystem::path &path, int channelCount, bool isFlipped);
+};
+
+#endif //TEXTURE_LOADER_HPP
@@ -0,0 +1,294 @@
+#include "virtual-texture-file.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <stb_image.h>
+
+#include "texture-loader.hpp"
+
+static constexpr std::size_t TEXEL_SIZE = 4;
+
+// pages start at a boundary this large, so that reading one never touches the memory page holding the header
+static constexpr std::size_t PAGE_DATA_OFFSET = 4096;
+
+// linear values are turned back into sRGB through a table this large, see the same table in 6-loaded
+static constexpr std::size_t LINEAR_TO_SRGB_TABLE_SIZE = 16384;
+
+static constexpr std::size_t MIN_ROWS_PER_CHUNK = 8;
+
+/**
+ * A mip level of the image while it's being cooked.
+ */
+struct CookedLevel {
+    std::size_t width;
+    std::size_t height;
+    std::vector<std::uint8_t> texels;
+};
+
+static const std::array<float, 256> &getSrgbToLinearTable() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> values{};
+        for (std::size_t i = 0; i < values.size(); i++) {
+            const float srgb = static_cast<float>(i) / 255.0f;
+            values[i] = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+        }
+
+        return values;
+    }();
+
+    return table;
+}
+
+static const std::array<std::uint8_t, LINEAR_TO_SRGB_TABLE_SIZE> &getLinearToSrgbTable() {
+    static const std::array<std::uint8_t, LINEAR_TO_SRGB_TABLE_SIZE> table = [] {
+        std::array<std::uint8_t, LINEAR_TO_SRGB_TABLE_SIZE> values{};
+        for (std::size_t i = 0; i < values.size(); i++) {
+            const float linear = static_cast<float>(i) / (LINEAR_TO_SRGB_TABLE_SIZE - 1);
+            const float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+            values[i] = static_cast<std::uint8_t>(std::clamp(srgb * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+
+        return values;
+    }();
+
+    return table;
+}
+
+static std::size_t divideRoundingUp(const std::size_t value, const std::size_t divisor) {
+    return (value + divisor - 1) / divisor;
+}
+
+/**
+ * Filters a level down into the next one with a 2x2 box filter, averaging colors in linear space. Levels are rounded
+ * up rather than down, so every texel of the image keeps being covered; texels past the edge repeat the last one.
+ */
+static CookedLevel filterLevel(ThreadPool &threadPool, const CookedLevel &source) {
+    CookedLevel target{
+        .width = divideRoundingUp(source.width, 2),
+        .height = divideRoundingUp(source.height, 2),
+        .texels = {},
+    };
+    target.texels.resize(target.width * target.height * TEXEL_SIZE);
+
+    const std::array<float, 256> &srgbToLinear = getSrgbToLinearTable();
+    const std::array<std::uint8_t, LINEAR_TO_SRGB_TABLE_SIZE> &linearToSrgb = getLinearToSrgbTable();
+
+    threadPool.parallelFor(target.height, MIN_ROWS_PER_CHUNK, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t y = begin; y < end; y++) {
+            const std::size_t sourceRows[] = { 2 * y, std::min(2 * y + 1, source.height - 1) };
+
+            for (std::size_t x = 0; x < target.width; x++) {
+                const std::size_t sourceColumns[] = { 2 * x, std::min(2 * x + 1, source.width - 1) };
+                std::array<float, TEXEL_SIZE> sum{};
+
+                for (const std::size_t sourceY : sourceRows) {
+                    for (const std::size_t sourceX : sourceColumns) {
+                        const std::uint8_t *texel = &source.texels[(sourceY * source.width + sourceX) * TEXEL_SIZE];
+
+                        for (std::size_t channel = 0; channel < 3; channel++) {
+                            sum[channel] += srgbToLinear[texel[channel]];
+                        }
+                        sum[3] += static_cast<float>(texel[3]) / 255.0f;
+                    }
+                }
+
+                std::uint8_t *filtered = &target.texels[(y * target.width + x) * TEXEL_SIZE];
+
+                for (std::size_t channel = 0; channel < 3; channel++) {
+                    const float index = std::clamp(0.25f * sum[channel], 0.0f, 1.0f)
+                                        * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f;
+                    filtered[channel] = linearToSrgb[static_cast<std::size_t>(index)];
+                }
+                filtered[3] = static_cast<std::uint8_t>(std::clamp(0.25f * sum[3] * 255.0f + 0.5f, 0.0f, 255.0f));
+            }
+        }
+    });
+
+    return target;
+}
+
+/**
+ * Copies the page at the given position out of the level, border included. Texels of the border which fall outside
+ * the level repeat its edge, which is what clamping would sample there.
+ */
+static void copyPage(const CookedLevel &level, const std::size_t pageX, const std::size_t pageY, std::byte *page) {
+    constexpr auto border = static_cast<std::ptrdiff_t>(VirtualTextureFile::PAGE_BORDER);
+    constexpr auto size = static_cast<std::ptrdiff_t>(VirtualTextureFile::PAGE_SIZE);
+    const auto maxX = static_cast<std::ptrdiff_t>(level.width) - 1;
+    const auto maxY = static_cast<std::ptrdiff_t>(level.height) - 1;
+
+    for (std::ptrdiff_t y = -border; y < size + border; y++) {
+        const std::ptrdiff_t levelY = std::clamp(static_cast<std::ptrdiff_t>(pageY) * size + y,
+                                                 std::ptrdiff_t{0}, maxY);
+
+        for (std::ptrdiff_t x = -border; x < size + border; x++) {
+            const std::ptrdiff_t levelX = std::clamp(static_cast<std::ptrdiff_t>(pageX) * size + x,
+                                                     std::ptrdiff_t{0}, maxX);
+            std::memcpy(page, &level.texels[(levelY * (maxX + 1) + levelX) * TEXEL_SIZE], TEXEL_SIZE);
+            page += TEXEL_SIZE;
+        }
+    }
+}
+
+static std::int64_t getWriteTime(const std::filesystem::path &path) {
+    return std::filesystem::last_write_time(path).time_since_epoch().count();
+}
+
+VirtualTextureFile::VirtualTextureFile(const std::filesystem::path &path)
+    : file(path), header(reinterpret_cast<const VirtualTextureHeader *>(file.getData().data())) {
+}
+
+std::unique_ptr<VirtualTextureFile> VirtualTextureFile::open(const std::filesystem::path &path,
+                                                             const std::filesystem::path &sourcePath) {
+    if (!std::filesystem::exists(path)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<VirtualTextureFile> file(new VirtualTextureFile(path));
+    if (!file->isValid(sourcePath)) {
+        return nullptr;
+    }
+
+    return file;
+}
+
+void VirtualTextureFile::cook(ThreadPool &threadPool, const std::filesystem::path &sourcePath,
+                              const std::filesystem::path &path) {
+    // rows stay top to bottom, the same way 5-textured has always sampled its textures
+    const DecodedTexture image = TextureLoader::decode(sourcePath, STBI_rgb_alpha, false);
+
+    VirtualTextureHeader header{};
+    header.magic = VirtualTextureHeader::MAGIC;
+    header.version = VirtualTextureHeader::VERSION;
+    header.sourceSize = std::filesystem::file_size(sourcePath);
+    header.sourceWriteTime = getWriteTime(sourcePath);
+    header.width = static_cast<std::uint32_t>(image.width);
+    header.height = static_cast<std::uint32_t>(image.height);
+    header.pageSize = PAGE_SIZE;
+    header.pageBorder = PAGE_BORDER;
+    header.pageCount = std::bit_ceil(static_cast<std::uint32_t>(
+        divideRoundingUp(std::max(header.width, header.height), PAGE_SIZE)));
+    header.levelCount = std::countr_zero(header.pageCount) + 1;
+
+    if (header.levelCount > VirtualTextureHeader::MAX_LEVEL_COUNT) {
+        throw std::runtime_error("image is too large for a virtual texture: " + sourcePath.string());
+    }
+
+    std::vector<CookedLevel> levels;
+    levels.push_back({
+        .width = header.width,
+        .height = header.height,
+        .texels = std::vector<std::uint8_t>(
+            image.pixels.get(), image.pixels.get() + std::size_t{header.width} * header.height * TEXEL_SIZE),
+    });
+
+    std::uint64_t pageTotal = 0;
+    for (std::uint32_t level = 0; level < header.levelCount; level++) {
+        if (level > 0) {
+            levels.push_back(filterLevel(threadPool, levels.back()));
+        }
+
+        header.levels[level] = {
+            .pageCountX = static_cast<std::uint32_t>(divideRoundingUp(levels[level].width, PAGE_SIZE)),
+            .pageCountY = static_cast<std::uint32_t>(divideRoundingUp(levels[level].height, PAGE_SIZE)),
+            .firstPage = pageTotal,
+        };
+        pageTotal += std::uint64_t{header.levels[level].pageCountX} * header.levels[level].pageCountY;
+    }
+
+    const std::filesystem::path tempPath = path.string() + ".tmp";
+
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("failed to open virtual texture for writing: " + tempPath.string());
+        }
+
+        std::vector<char> headerBytes(PAGE_DATA_OFFSET);
+        std::memcpy(headerBytes.data(), &header, sizeof(header));
+        out.write(headerBytes.data(), static_cast<std::streamsize>(headerBytes.size()));
+
+        constexpr std::size_t pageBytes = (PAGE_SIZE + 2 * PAGE_BORDER) * (PAGE_SIZE + 2 * PAGE_BORDER) * TEXEL_SIZE;
+        std::vector<std::byte> levelPages;
+
+        for (std::uint32_t level = 0; level < header.levelCount; level++) {
+            const VirtualTextureLevel &layout = header.levels[level];
+            levelPages.resize(std::size_t{layout.pageCountX} * layout.pageCountY * pageBytes);
+
+            threadPool.parallelFor(layout.pageCountX * layout.pageCountY, 1,
+                                   [&](const std::size_t begin, const std::size_t end) {
+                for (std::size_t page = begin; page < end; page++) {
+                    copyPage(levels[level], page % layout.pageCountX, page / layout.pageCountX,
+                             levelPages.data() + page * pageBytes);
+                }
+            });
+
+            out.write(reinterpret_cast<const char *>(levelPages.data()),
+                      static_cast<std::streamsize>(levelPages.size()));
+        }
+
+        if (!out) {
+            throw std::runtime_error("failed to write virtual texture: " + tempPath.string());
+        }
+    }
+
+    std::filesystem::rename(tempPath, path);
+}
+
+std::size_t VirtualTextureFile::getPageBytes() const {
+    const std::size_t side = header->pageSize + 2 * header->pageBorder;
+    return side * side * TEXEL_SIZE;
+}
+
+bool VirtualTextureFile::hasPage(const std::uint32_t level, const std::uint32_t x, const std::uint32_t y) const {
+    return level < header->levelCount && x < header->levels[level].pageCountX && y < header->levels[level].pageCountY;
+}
+
+std::span<const std::byte> VirtualTextureFile::getPage(const std::uint32_t level, const std::uint32_t x,
+                                                       const std::uint32_t y) const {
+    if (!hasPage(level, x, y)) {
+        throw std::runtime_error("virtual texture page out of range");
+    }
+
+    const VirtualTextureLevel &layout = header->levels[level];
+    const std::uint64_t page = layout.firstPage + std::uint64_t{y} * layout.pageCountX + x;
+    return file.getData().subspan(PAGE_DATA_OFFSET + page * getPageBytes(), getPageBytes());
+}
+
+bool VirtualTextureFile::isValid(const std::filesystem::path &sourcePath) const {
+    const std::span<const std::byte> data = file.getData();
+
+    if (data.size() < PAGE_DATA_OFFSET) {
+        return false;
+    }
+
+    if (header->magic != VirtualTextureHeader::MAGIC || header->version != VirtualTextureHeader::VERSION) {
+        return false;
+    }
+
+    if (header->sourceSize != std::filesystem::file_size(sourcePath)
+        || header->sourceWriteTime != getWriteTime(sourcePath)) {
+        return false;
+    }
+
+    // the physical page cache is laid out for pages of exactly this size
+    if (header->pageSize != PAGE_SIZE || header->pageBorder != PAGE_BORDER) {
+        return false;
+    }
+
+    if (header->levelCount == 0 || header->levelCount > VirtualTextureHeader::MAX_LEVEL_COUNT
+        || header->pageCount != 1u << (header->levelCount - 1)) {
+        return false;
+    }
+
+    const VirtualTextureLevel &last = header->levels[header->levelCount - 1];
+    const std::uint64_t pageTotal = last.firstPage + std::uint64_t{last.pageCountX} * last.pageCountY;
+    return data.size() >= PAGE_DATA_OFFSET + pageTotal * getPageBytes();
+}
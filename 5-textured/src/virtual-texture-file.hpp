@@ -0,0 +1,105 @@
+#ifndef VIRTUAL_TEXTURE_FILE_HPP
+#define VIRTUAL_TEXTURE_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+#include "utilities/mapped-file.hpp"
+#include "utilities/thread-pool.hpp"
+
+/**
+ * Where the pages of one mip level are stored in a virtual texture file. Only pages which overlap the image are
+ * stored, row by row.
+ */
+struct VirtualTextureLevel {
+    std::uint32_t pageCountX;
+    std::uint32_t pageCountY;
+    std::uint64_t firstPage; // index of the level's first page among all the pages in the file
+};
+
+/**
+ * Header at the start of a virtual texture file, followed by the pages of every level, finest level first.
+ *
+ * The image sits in the top left corner of the virtual texture, which is a square grid of pages with a power of two
+ * pages along each side, so that every coarser level has exactly half as many. Its coarsest level is a single page.
+ */
+struct VirtualTextureHeader {
+    static constexpr std::uint32_t MAGIC = 0x58455456; // "VTEX"
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr std::size_t MAX_LEVEL_COUNT = 16;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t sourceSize;     // size and modification time of the image the file was cooked from, to tell
+    std::int64_t sourceWriteTime; // when it's stale
+    std::uint32_t width;          // of the image, in texels
+    std::uint32_t height;
+    std::uint32_t pageSize;       // texels along a side of a page, not counting its border
+    std::uint32_t pageBorder;     // texels copied from the neighbouring pages around each page, for filtering
+    std::uint32_t pageCount;      // pages along a side of the finest level of the virtual texture
+    std::uint32_t levelCount;
+    VirtualTextureLevel levels[MAX_LEVEL_COUNT];
+};
+
+/**
+ * A virtual texture cooked into fixed-size pages on disk, so that any page of any mip level can be read on its own
+ * without decoding the whole image. Every page is stored as RGBA8 texels together with its border.
+ *
+ * The file is memory-mapped, so reading a page only touches the part of the file it's stored in.
+ */
+class VirtualTextureFile {
+    MappedFile file;
+    const VirtualTextureHeader *header;
+
+public:
+    static constexpr std::uint32_t PAGE_SIZE = 128;
+    static constexpr std::uint32_t PAGE_BORDER = 4;
+
+    VirtualTextureFile(const VirtualTextureFile &other) = delete;
+
+    VirtualTextureFile &operator=(const VirtualTextureFile &other) = delete;
+
+    /**
+     * Maps the virtual texture file at the given path. Returns nullptr if there's no such file, or if it wasn't
+     * cooked from the current version of the source image.
+     */
+    static std::unique_ptr<VirtualTextureFile> open(const std::filesystem::path &path,
+                                                    const std::filesystem::path &sourcePath);
+
+    /**
+     * Decodes the source image, builds its mip chain and writes all of its pages into a virtual texture file at the
+     * given path. The image is only ever loaded whole here.
+     */
+    static void cook(ThreadPool &threadPool, const std::filesystem::path &sourcePath,
+                     const std::filesystem::path &path);
+
+    [[nodiscard]] const VirtualTextureHeader &getHeader() const { return *header; }
+
+    [[nodiscard]] std::uint32_t getLevelCount() const { return header->levelCount; }
+
+    /**
+     * Bytes taken by a single page, border included.
+     */
+    [[nodiscard]] std::size_t getPageBytes() const;
+
+    /**
+     * Returns whether the page at the given position of the level holds any of the image. Pages which don't are
+     * never stored, and never sampled from either.
+     */
+    [[nodiscard]] bool hasPage(std::uint32_t level, std::uint32_t x, std::uint32_t y) const;
+
+    /**
+     * Returns the texels of the page at the given position of the level, which `hasPage` has to be true for.
+     */
+    [[nodiscard]] std::span<const std::byte> getPage(std::uint32_t level, std::uint32_t x, std::uint32_t y) const;
+
+private:
+    explicit VirtualTextureFile(const std::filesystem::path &path);
+
+    [[nodiscard]] bool isValid(const std::filesystem::path &sourcePath) const;
+};
+
+#endif //VIRTUAL_TEXTURE_FILE_HPP
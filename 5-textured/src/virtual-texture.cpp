@@ -0,0 +1,415 @@
+#include "virtual-texture.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+
+#include "utilities/gl-state.hpp"
+
+VirtualTexture::VirtualTexture(ThreadPool &threadPool, std::unique_ptr<VirtualTextureFile> file,
+                               const int slotsPerSide)
+    : threadPool(threadPool), file(std::move(file)), slotsPerSide(slotsPerSide) {
+    const VirtualTextureHeader &header = this->file->getHeader();
+    const int slotSide = static_cast<int>(header.pageSize + 2 * header.pageBorder);
+
+    // page table entries hold slot coordinates in 8 bits each
+    if (slotsPerSide < 1 || slotsPerSide > 256) {
+        throw std::runtime_error("virtual texture slot count out of range");
+    }
+
+    glGenTextures(1, &physicalTexture);
+    getGLState().bindTexture(GL_TEXTURE_2D, physicalTexture);
+
+    // wrapping and filtering -- for a plain texture, feel free to experiment with these 4! GL_REPEAT,
+    // GL_MIRRORED_REPEAT, GL_CLAMP_TO_EDGE and GL_CLAMP_TO_BORDER are the wrap modes; GL_NEAREST and GL_LINEAR (plus
+    // GL_*_MIPMAP_* for minification) the filters. here they're constrained though: pages sit next to each other in
+    // this texture, so wrapping around its edges would make no sense, and it has no mipmaps of its own -- every level
+    // of the virtual texture has its own pages instead, and the shader picks the level itself
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+    // border color used when we set either of the GL_TEXTURE_WRAP_* to GL_CLAMP_TO_BORDER. the texels each page
+    // carries around its edges keep filtering from ever reaching past the slot grid here, but on a plain texture
+    // sampled outside of [0, 1] this is the color that shows up
+    constexpr float borderColor[] = { 1.0f, 1.0f, 0.0f, 1.0f };
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+    glTexImage2D(
+        GL_TEXTURE_2D,                // target bind point -- we bound the texture to GL_TEXTURE_2D, so we pick GL_TEXTURE_2D
+        0,                            // mipmap level -- this texture only has the first one
+        GL_RGBA8,                     // internal format -- 4 channels, 8 bits each
+        slotsPerSide * slotSide,      // width and height of the texture -- a grid of page slots
+        slotsPerSide * slotSide,
+        0,                            // must be 0 for legacy reasons
+        GL_RGBA,                      // format of the provided data -- pages are stored as RGBA
+        GL_UNSIGNED_BYTE,             // type of each channel's data -- typically 8-bit unsigned ints, but some are different (e.g. HDR)
+        nullptr                       // pointer to the data -- none yet, pages are uploaded into the slots as they're needed
+    );
+
+    // the page table has a level for every level of the virtual texture, each one with a texel per page
+    glGenTextures(1, &pageTableTexture);
+    getGLState().bindTexture(GL_TEXTURE_2D, pageTableTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(header.levelCount - 1));
+
+    pageTable.resize(header.levelCount);
+    for (std::uint32_t level = 0; level < header.levelCount; level++) {
+        const auto side = static_cast<GLsizei>(header.pageCount >> level);
+        pageTable[level].resize(static_cast<std::size_t>(side) * side);
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA8, side, side, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     nullptr);
+    }
+
+    // the coarsest page covers the whole texture, so with it resident every lookup resolves to something
+    uploadPage(0, this->file->getPage(header.levelCount - 1, 0, 0));
+
+    for (int slot = slotsPerSide * slotsPerSide - 1; slot > 0; slot--) {
+        freeSlots.push_back(slot);
+    }
+
+    updatePageTable();
+}
+
+VirtualTexture::~VirtualTexture() {
+    // the workers may still be reading from the file
+    for (PendingPage &page : pendingPages) {
+        page.texels.wait();
+    }
+
+    deleteFeedbackTarget();
+    getGLState().deleteTexture(pageTableTexture);
+    getGLState().deleteTexture(physicalTexture);
+}
+
+void VirtualTexture::bind(GLShaders &shaders, const GLint pageTableUnit, const GLint physicalUnit) const {
+    const VirtualTextureHeader &header = file->getHeader();
+
+    getGLState().bindTexture(static_cast<GLuint>(pageTableUnit), GL_TEXTURE_2D, pageTableTexture);
+    getGLState().bindTexture(static_cast<GLuint>(physicalUnit), GL_TEXTURE_2D, physicalTexture);
+
+    shaders.setUniform("pageTable", pageTableUnit);
+    shaders.setUniform("physicalPages", physicalUnit);
+    shaders.setUniform("pageBorder", static_cast<float>(header.pageBorder));
+    setLayoutUniforms(shaders);
+}
+
+void VirtualTexture::bindFeedback(GLShaders &shaders) const {
+    // derivatives are that many times larger in the smaller feedback target, which would pick levels too coarse
+    shaders.setUniform("levelBias", std::log2(static_cast<float>(FEEDBACK_SCALE)));
+    setLayoutUniforms(shaders);
+}
+
+void VirtualTexture::setLayoutUniforms(GLShaders &shaders) const {
+    const VirtualTextureHeader &header = file->getHeader();
+    const float virtualSize = static_cast<float>(header.pageCount) * static_cast<float>(header.pageSize);
+
+    // the image only covers the top left corner of the virtual texture
+    shaders.setUniform("virtualScale", glm::vec2(header.width, header.height) / virtualSize);
+    shaders.setUniform("virtualPageCount", static_cast<float>(header.pageCount));
+    shaders.setUniform("pageSize", static_cast<float>(header.pageSize));
+    shaders.setUniform("maxLevel", static_cast<float>(header.levelCount - 1));
+}
+
+void VirtualTexture::beginFeedback(const glm::ivec2 windowSize) {
+    const glm::ivec2 size = glm::max(windowSize / FEEDBACK_SCALE, glm::ivec2(1));
+    if (size != feedbackSize) {
+        deleteFeedbackTarget();
+        createFeedbackTarget(size);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+    glViewport(0, 0, feedbackSize.x, feedbackSize.y);
+
+    // fragments with nothing drawn over them are left at zero, which doesn't ask for any page
+    constexpr GLuint clearValue[4] = { 0, 0, 0, 0 };
+    glClearBufferuiv(GL_COLOR, 0, clearValue);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTexture::endFeedback(const glm::ivec2 windowSize) {
+    if (!feedbackFences[nextFeedbackBuffer]) {
+        getGLState().bindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[nextFeedbackBuffer]);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        // with a pack buffer bound this only queues the copy, rather than waiting for the frame to be drawn
+        glReadPixels(0, 0, feedbackSize.x, feedbackSize.y, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+        getGLState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        feedbackFences[nextFeedbackBuffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextFeedbackBuffer = (nextFeedbackBuffer + 1) % feedbackBuffers.size();
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowSize.x, windowSize.y);
+}
+
+void VirtualTexture::tick() {
+    // read backs are processed in the order they were issued, the oldest one being the next to be reused
+    for (std::size_t i = 0; i < feedbackBuffers.size(); i++) {
+        const std::size_t index = (nextFeedbackBuffer + i) % feedbackBuffers.size();
+        if (!feedbackFences[index]) {
+            continue;
+        }
+
+        const GLenum status = glClientWaitSync(feedbackFences[index], 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        glDeleteSync(feedbackFences[index]);
+        feedbackFences[index] = nullptr;
+
+        const std::size_t texelCount = static_cast<std::size_t>(feedbackSize.x) * feedbackSize.y * 4;
+        getGLState().bindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[index]);
+        const auto *texels = static_cast<const std::uint16_t *>(glMapBufferRange(
+            GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(texelCount * sizeof(std::uint16_t)), GL_MAP_READ_BIT));
+
+        if (texels) {
+            processFeedback({texels, texelCount});
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+
+        getGLState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    uploadPendingPages();
+
+    if (isPageTableDirty) {
+        updatePageTable();
+    }
+}
+
+VirtualTextureStats VirtualTexture::takeStats() {
+    return std::exchange(stats, {});
+}
+
+void VirtualTexture::createFeedbackTarget(const glm::ivec2 size) {
+    feedbackSize = size;
+
+    // page coordinates can go past 255, so they're written as integers rather than normalized colors
+    glGenTextures(1, &feedbackColor);
+    getGLState().bindTexture(GL_TEXTURE_2D, feedbackColor);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16UI, size.x, size.y, 0, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+
+    glGenRenderbuffers(1, &feedbackDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size.x, size.y);
+
+    glGenFramebuffers(1, &feedbackFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackColor, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error("virtual texture feedback framebuffer is incomplete");
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glGenBuffers(static_cast<GLsizei>(feedbackBuffers.size()), feedbackBuffers.data());
+    for (const GLuint buffer : feedbackBuffers) {
+        getGLState().bindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size.x) * size.y * 4 * sizeof(std::uint16_t),
+                     nullptr, GL_STREAM_READ);
+    }
+
+    getGLState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void VirtualTexture::deleteFeedbackTarget() {
+    if (!feedbackFramebuffer) {
+        return;
+    }
+
+    // whatever was being read back was sized for the old target
+    for (GLsync &fence : feedbackFences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    for (const GLuint buffer : feedbackBuffers) {
+        getGLState().deleteBuffer(buffer);
+    }
+    glDeleteFramebuffers(1, &feedbackFramebuffer);
+    glDeleteRenderbuffers(1, &feedbackDepth);
+    getGLState().deleteTexture(feedbackColor);
+
+    feedbackFramebuffer = 0;
+    feedbackSize = {0, 0};
+}
+
+void VirtualTexture::processFeedback(const std::span<const std::uint16_t> texels) {
+    feedbackFrame++;
+    stats.feedbackCount++;
+
+    const std::uint32_t coarsestLevel = file->getLevelCount() - 1;
+
+    // neighbouring fragments almost always ask for the same page, so most texels are dropped right here
+    std::unordered_set<std::uint64_t> requestedKeys;
+    std::vector<std::uint64_t> missingKeys;
+
+    for (std::size_t i = 0; i < texels.size(); i += 4) {
+        const std::uint32_t x = texels[i];
+        const std::uint32_t y = texels[i + 1];
+        const std::uint32_t level = texels[i + 2];
+
+        if (!texels[i + 3] || level >= coarsestLevel || !file->hasPage(level, x, y)) {
+            continue;
+        }
+
+        const std::uint64_t key = getPageKey(level, x, y);
+        if (!requestedKeys.insert(key).second) {
+            continue;
+        }
+
+        const auto resident = residentPages.find(key);
+        if (resident == residentPages.end()) {
+            stats.missCount++;
+            missingKeys.push_back(key);
+            continue;
+        }
+
+        stats.hitCount++;
+        resident->second.lastUsedFeedback = feedbackFrame;
+        leastRecentlyUsed.splice(leastRecentlyUsed.end(), leastRecentlyUsed, resident->second.lruPosition);
+    }
+
+    // coarser pages first, as each one stands in for a whole block of the finer ones until they're loaded
+    std::ranges::sort(missingKeys, std::greater{});
+
+    for (const std::uint64_t key : missingKeys) {
+        if (pendingPages.size() >= MAX_PENDING_PAGES) {
+            break; // the rest will be asked for again by the next feedback frame
+        }
+
+        const bool isPending = std::ranges::any_of(pendingPages, [&](const PendingPage &page) {
+            return page.key == key;
+        });
+
+        if (isPending) {
+            continue;
+        }
+
+        const std::span<const std::byte> page = file->getPage(key >> 48, key >> 24 & 0xFFFFFF, key & 0xFFFFFF);
+
+        // touching the mapping is what actually reads the page from disk, which is kept off the render thread
+        pendingPages.push_back({
+            .key = key,
+            .texels = threadPool.submit([page] { return std::vector<std::byte>(page.begin(), page.end()); }),
+        });
+    }
+}
+
+void VirtualTexture::uploadPendingPages() {
+    std::size_t uploadCount = 0;
+
+    for (auto it = pendingPages.begin(); it != pendingPages.end() && uploadCount < MAX_UPLOADS_PER_FRAME;) {
+        if (it->texels.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
+
+        const std::vector<std::byte> texels = it->texels.get();
+        const std::uint64_t key = it->key;
+        it = pendingPages.erase(it);
+
+        int slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            const std::uint64_t evictedKey = leastRecentlyUsed.front();
+            const ResidentPage &evicted = residentPages.at(evictedKey);
+
+            // every resident page is in view, so there's no room for this one until some of them aren't
+            if (evicted.lastUsedFeedback == feedbackFrame) {
+                continue;
+            }
+
+            slot = evicted.slot;
+            leastRecentlyUsed.pop_front();
+            residentPages.erase(evictedKey);
+            stats.evictedPageCount++;
+        }
+
+        uploadPage(slot, texels);
+        leastRecentlyUsed.push_back(key);
+        residentPages.emplace(key, ResidentPage{
+            .slot = slot,
+            .lastUsedFeedback = feedbackFrame,
+            .lruPosition = std::prev(leastRecentlyUsed.end()),
+        });
+
+        isPageTableDirty = true;
+        stats.loadedPageCount++;
+        uploadCount++;
+    }
+}
+
+void VirtualTexture::uploadPage(const int slot, const std::span<const std::byte> texels) const {
+    const VirtualTextureHeader &header = file->getHeader();
+    const int slotSide = static_cast<int>(header.pageSize + 2 * header.pageBorder);
+
+    getGLState().bindTexture(GL_TEXTURE_2D, physicalTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, slot % slotsPerSide * slotSide, slot / slotsPerSide * slotSide, slotSide,
+                    slotSide, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+}
+
+void VirtualTexture::updatePageTable() {
+    const VirtualTextureHeader &header = file->getHeader();
+    const std::uint32_t coarsestLevel = header.levelCount - 1;
+
+    getGLState().bindTexture(GL_TEXTURE_2D, pageTableTexture);
+
+    // from the coarsest level down, so every page which isn't resident can take its parent's entry
+    for (std::uint32_t level = coarsestLevel + 1; level-- > 0;) {
+        const std::uint32_t side = header.pageCount >> level;
+        std::vector<std::array<std::uint8_t, 4>> &entries = pageTable[level];
+
+        for (std::uint32_t y = 0; y < side; y++) {
+            for (std::uint32_t x = 0; x < side; x++) {
+                std::array<std::uint8_t, 4> &entry = entries[y * side + x];
+
+                if (level == coarsestLevel) {
+                    entry = { 0, 0, static_cast<std::uint8_t>(level), 255 };
+                    continue;
+                }
+
+                const auto resident = residentPages.find(getPageKey(level, x, y));
+                if (resident == residentPages.end()) {
+                    entry = pageTable[level + 1][y / 2 * (side / 2) + x / 2];
+                    continue;
+                }
+
+                const int slot = resident->second.slot;
+                entry = {
+                    static_cast<std::uint8_t>(slot % slotsPerSide),
+                    static_cast<std::uint8_t>(slot / slotsPerSide),
+                    static_cast<std::uint8_t>(level),
+                    255
+                };
+            }
+        }
+
+        glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, static_cast<GLsizei>(side),
+                        static_cast<GLsizei>(side), GL_RGBA, GL_UNSIGNED_BYTE, entries.data());
+    }
+
+    isPageTableDirty = false;
+}
+
+std::uint64_t VirtualTexture::getPageKey(const std::uint32_t level, const std::uint32_t x, const std::uint32_t y) {
+    // the level goes in the top bits, so sorting keys sorts pages by level
+    return static_cast<std::uint64_t>(level) << 48 | static_cast<std::uint64_t>(y) << 24 | x;
+}
@@ -0,0 +1,175 @@
+#ifndef VIRTUAL_TEXTURE_HPP
+#define VIRTUAL_TEXTURE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "utilities/gl-shader.hpp"
+#include "utilities/thread-pool.hpp"
+#include "virtual-texture-file.hpp"
+
+/**
+ * What the virtual texture has been doing since the counters were last taken.
+ */
+struct VirtualTextureStats {
+    std::size_t feedbackCount = 0;  // feedback frames read back
+    std::size_t hitCount = 0;       // pages asked for by the feedback which were already resident
+    std::size_t missCount = 0;      // pages asked for which weren't
+    std::size_t loadedPageCount = 0;
+    std::size_t evictedPageCount = 0;
+};
+
+/**
+ * Samples a texture far larger than it could ever be uploaded whole, by keeping only the pages which are actually
+ * visible resident in a small physical texture.
+ *
+ * Every frame, the scene is also drawn into a small feedback target with the feedback shaders, which write out which
+ * page at which level every fragment wants. The feedback is read back asynchronously a couple of frames later, and the
+ * pages missing from it are read from the virtual texture file by the workers. Once a page is read it's uploaded into
+ * a free slot of the physical texture, or into the slot of the least recently used page which the latest feedback
+ * didn't ask for.
+ *
+ * The page table is a texture with a texel for every page of every level. Each one points at the slot holding that
+ * page or, if it isn't resident, at the finest resident page covering it -- the coarsest page is always resident, so
+ * there's always one. Shaders look the page up with `texelFetch` and sample the slot with plain bilinear filtering,
+ * which the page borders make seamless.
+ */
+class VirtualTexture {
+    struct ResidentPage {
+        int slot;
+        std::uint64_t lastUsedFeedback; // the feedback frame which last asked for the page
+        std::list<std::uint64_t>::iterator lruPosition;
+    };
+
+    struct PendingPage {
+        std::uint64_t key;
+        std::future<std::vector<std::byte>> texels;
+    };
+
+    ThreadPool &threadPool;
+    std::unique_ptr<VirtualTextureFile> file;
+
+    GLuint pageTableTexture = 0;
+    GLuint physicalTexture = 0;
+    int slotsPerSide;
+
+    // the page table as it's uploaded, one array of RGBA8 texels per level
+    std::vector<std::vector<std::array<std::uint8_t, 4>>> pageTable;
+    bool isPageTableDirty = true;
+
+    // the coarsest page isn't tracked here, as it's loaded into slot 0 up front and never evicted
+    std::unordered_map<std::uint64_t, ResidentPage> residentPages;
+    std::list<std::uint64_t> leastRecentlyUsed; // keys of resident pages, least recently used first
+    std::vector<int> freeSlots;
+    std::vector<PendingPage> pendingPages;
+
+    glm::ivec2 feedbackSize{0, 0};
+    GLuint feedbackFramebuffer = 0;
+    GLuint feedbackColor = 0;
+    GLuint feedbackDepth = 0;
+    std::array<GLuint, 2> feedbackBuffers{};
+    std::array<GLsync, 2> feedbackFences{}; // set while a read back into the buffer hasn't been processed yet
+    std::size_t nextFeedbackBuffer = 0;
+    std::uint64_t feedbackFrame = 0;
+
+    VirtualTextureStats stats;
+
+public:
+    // the feedback target is this many times smaller than the window along each side
+    static constexpr int FEEDBACK_SCALE = 8;
+
+    // pages being read by the workers at once, and uploaded per frame once they're read
+    static constexpr std::size_t MAX_PENDING_PAGES = 16;
+    static constexpr std::size_t MAX_UPLOADS_PER_FRAME = 8;
+
+    VirtualTexture(ThreadPool &threadPool, std::unique_ptr<VirtualTextureFile> file, int slotsPerSide);
+
+    ~VirtualTexture();
+
+    VirtualTexture(const VirtualTexture &other) = delete;
+
+    VirtualTexture &operator=(const VirtualTexture &other) = delete;
+
+    [[nodiscard]] const VirtualTextureFile &getFile() const { return *file; }
+
+    [[nodiscard]] std::size_t getSlotCount() const { return static_cast<std::size_t>(slotsPerSide * slotsPerSide); }
+
+    [[nodiscard]] std::size_t getResidentPageCount() const { return residentPages.size() + 1; }
+
+    [[nodiscard]] std::size_t getPendingPageCount() const { return pendingPages.size(); }
+
+    /**
+     * Binds the page table and the physical texture to the given texture units and sets the uniforms the shaders
+     * sample through, which have to be enabled.
+     */
+    void bind(GLShaders &shaders, GLint pageTableUnit, GLint physicalUnit) const;
+
+    /**
+     * Sets the uniforms the feedback shaders need, which have to be enabled.
+     */
+    void bindFeedback(GLShaders &shaders) const;
+
+    /**
+     * Binds and clears the feedback target, sized for the given window. The scene should be drawn with the feedback
+     * shaders until `endFeedback`.
+     */
+    void beginFeedback(glm::ivec2 windowSize);
+
+    /**
+     * Starts reading the feedback back without waiting for it, and restores the default framebuffer and viewport.
+     * The read back is skipped if the previous ones haven't been processed by `tick` yet.
+     */
+    void endFeedback(glm::ivec2 windowSize);
+
+    /**
+     * Processes feedback which has finished reading back, starts reading the pages it asks for, uploads the pages
+     * which have been read and updates the page table. Should be called once every frame, before drawing.
+     */
+    void tick();
+
+    /**
+     * Returns the counters gathered since the previous call, and resets them.
+     */
+    VirtualTextureStats takeStats();
+
+private:
+    /**
+     * Sets the uniforms describing the layout of the virtual texture, which both kinds of shaders need.
+     */
+    void setLayoutUniforms(GLShaders &shaders) const;
+
+    void createFeedbackTarget(glm::ivec2 size);
+
+    void deleteFeedbackTarget();
+
+    /**
+     * Collects the pages asked for by a read back feedback frame, and marks the resident ones as used.
+     */
+    void processFeedback(std::span<const std::uint16_t> texels);
+
+    /**
+     * Uploads pages which the workers are done reading, evicting others if there are no free slots left.
+     */
+    void uploadPendingPages();
+
+    void uploadPage(int slot, std::span<const std::byte> texels) const;
+
+    /**
+     * Points every texel of the page table at the finest resident page covering it, and uploads the whole table.
+     */
+    void updatePageTable();
+
+    static std::uint64_t getPageKey(std::uint32_t level, std::uint32_t x, std::uint32_t y);
+};
+
+#endif //VIRTUAL_TEXTURE_HPP
@@ -4,8 +4,11 @@ in vec2 tex_coords;
 
 out vec4 out_color;
 
-uniform sampler2D colorTexture;
+// textures are packed into arrays by format and size, so each material picks its layer
+uniform sampler2DArray colorTexture;
+uniform int colorLayer;
+uniform vec3 diffuseColor;
 
 void main() {
-    out_color = texture(colorTexture, tex_coords);
+    out_color = texture(colorTexture, vec3(tex_coords, colorLayer)) * vec4(diffuseColor, 1.0);
 }
@@ -0,0 +1,47 @@
+#version 410
+
+in vec2 tex_coords;
+in vec3 world_position;
+in vec3 world_normal;
+in vec4 world_tangent;
+
+out vec4 out_color;
+
+// textures are packed into arrays by format and size, so each material picks its layers
+uniform sampler2DArray colorTexture;
+uniform sampler2DArray normalTexture;
+uniform int colorLayer;
+uniform int normalLayer;
+uniform vec3 diffuseColor;
+
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 lightDirection; // towards the light
+    vec4 cameraPosition;
+};
+
+const float AMBIENT = 0.15;
+const float SPECULAR = 0.3;
+const float SHININESS = 32.0;
+
+void main() {
+    // MikkTSpace expects the bitangent to be rebuilt per fragment from the interpolated, unnormalized
+    // normal and tangent, and the sampled normal to be transformed without normalizing the frame first
+    vec3 bitangent = world_tangent.w * cross(world_normal, world_tangent.xyz);
+    // only x and y are stored, so that normal maps can be compressed into two channels. z is always positive
+    vec2 tangent_normal_xy = texture(normalTexture, vec3(tex_coords, normalLayer)).xy * 2.0 - 1.0;
+    vec3 tangent_normal = vec3(tangent_normal_xy, sqrt(max(1.0 - dot(tangent_normal_xy, tangent_normal_xy), 0.0)));
+    vec3 normal = normalize(tangent_normal.x * world_tangent.xyz + tangent_normal.y * bitangent
+                            + tangent_normal.z * world_normal);
+
+    // blinn-phong with a single directional light
+    vec3 light_direction = lightDirection.xyz;
+    vec3 view_direction = normalize(cameraPosition.xyz - world_position);
+    vec3 half_direction = normalize(light_direction + view_direction);
+    float diffuse = max(dot(normal, light_direction), 0.0);
+    float specular = diffuse > 0.0 ? pow(max(dot(normal, half_direction), 0.0), SHININESS) : 0.0;
+
+    vec4 albedo = texture(colorTexture, vec3(tex_coords, colorLayer)) * vec4(diffuseColor, 1.0);
+    out_color = vec4(albedo.rgb * (AMBIENT + diffuse) + SPECULAR * specular, albedo.a);
+}
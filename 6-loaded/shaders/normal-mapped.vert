@@ -0,0 +1,37 @@
+#version 410
+
+layout (location = 0) in vec3 in_position;
+layout (location = 1) in vec2 in_tex_coords;
+layout (location = 2) in vec3 in_normal;
+layout (location = 3) in vec4 in_tangent;
+
+out vec2 tex_coords;
+out vec3 world_position;
+out vec3 world_normal;
+out vec4 world_tangent;
+
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 lightDirection; // towards the light
+    vec4 cameraPosition;
+};
+
+layout (std140) uniform ObjectUniforms {
+    mat4 model;
+    mat4 normalMatrix;
+};
+
+void main() {
+    vec4 position = model * vec4(in_position, 1.0);
+    gl_Position = projection * view * position;
+
+    tex_coords = in_tex_coords;
+    world_position = position.xyz;
+
+    // the model matrix only scales uniformly, so the normal matrix works for tangents as well
+    world_normal = mat3(normalMatrix) * in_normal;
+    // the bitangent's sign may come in packed into 2 bits, which GL before 4.2 decodes -1 from as -1/3, so only
+    // its sign is kept
+    world_tangent = vec4(mat3(normalMatrix) * in_tangent.xyz, in_tangent.w < 0.0 ? -1.0 : 1.0);
+}
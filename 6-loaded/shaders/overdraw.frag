@@ -0,0 +1,8 @@
+#version 410
+
+out float out_count;
+
+void main() {
+    // with additive blending, the result is the number of fragments that reached each pixel
+    out_count = 1.0;
+}
@@ -0,0 +1,720 @@
+#include "block-compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+static constexpr int BLOCK_SIZE = 4;
+static constexpr std::size_t BLOCK_TEXELS = BLOCK_SIZE * BLOCK_SIZE;
+
+// rows of blocks are compressed in chunks of at least this many, spread over the thread pool
+static constexpr std::size_t MIN_BLOCK_ROWS_PER_CHUNK = 4;
+
+// the best quality refines BC1 endpoints at most this many times, stopping once the error no longer drops
+static constexpr int MAX_BC1_REFINEMENTS = 8;
+
+// the best quality tries BC4 endpoints up to this far inside the range of the block's values
+static constexpr int BC4_SEARCH_RADIUS = 3;
+
+/**
+ * Colors of a block's texels, one array per channel so that loops over the texels vectorize.
+ */
+struct ColorBlock {
+    int channels[3][BLOCK_TEXELS];
+};
+
+struct Bc1Block {
+    std::uint16_t color0;
+    std::uint16_t color1;
+    std::uint32_t indices;
+    std::uint32_t error;
+};
+
+struct Bc4Block {
+    std::uint8_t endpoint0;
+    std::uint8_t endpoint1;
+    std::uint64_t indices;
+    std::uint32_t error;
+};
+
+/**
+ * A pair of quantized endpoints whose color two thirds of the way from the first to the second is as close as
+ * possible to a given 8-bit value.
+ */
+struct SingleColorMatch {
+    std::uint8_t endpoint0;
+    std::uint8_t endpoint1;
+};
+
+const char *getTextureFormatName(const TextureFormat format) {
+    switch (format) {
+        case TextureFormat::RGBA8: return "RGBA8";
+        case TextureFormat::BC1: return "BC1";
+        case TextureFormat::BC3: return "BC3";
+        case TextureFormat::BC4: return "BC4";
+        case TextureFormat::BC5: return "BC5";
+    }
+
+    return "unknown";
+}
+
+const char *getBlockQualityName(const BlockQuality quality) {
+    switch (quality) {
+        case BlockQuality::FAST: return "fast";
+        case BlockQuality::BALANCED: return "balanced";
+        case BlockQuality::BEST: return "best";
+    }
+
+    return "unknown";
+}
+
+int getBlockSize(const TextureFormat format) {
+    return format == TextureFormat::RGBA8 ? 1 : BLOCK_SIZE;
+}
+
+std::size_t getBlockBytes(const TextureFormat format) {
+    switch (format) {
+        case TextureFormat::RGBA8: return 4;
+        case TextureFormat::BC1: return 8;
+        case TextureFormat::BC3: return 16;
+        case TextureFormat::BC4: return 8;
+        case TextureFormat::BC5: return 16;
+    }
+
+    throw std::runtime_error("unknown texture format");
+}
+
+std::size_t getBlockRowBytes(const TextureFormat format, const int width) {
+    const int blockSize = getBlockSize(format);
+    return static_cast<std::size_t>((width + blockSize - 1) / blockSize) * getBlockBytes(format);
+}
+
+int getBlockRowCount(const TextureFormat format, const int height) {
+    const int blockSize = getBlockSize(format);
+    return (height + blockSize - 1) / blockSize;
+}
+
+std::size_t getLevelSize(const TextureFormat format, const int width, const int height) {
+    return getBlockRowBytes(format, width) * getBlockRowCount(format, height);
+}
+
+static int expand5(const int value) {
+    return value << 3 | value >> 2;
+}
+
+static int expand6(const int value) {
+    return value << 2 | value >> 4;
+}
+
+static std::uint16_t packRgb565(const float color[3]) {
+    const auto quantize = [](const float value, const int maxValue) {
+        return static_cast<int>(std::clamp(value, 0.0f, 255.0f) * static_cast<float>(maxValue) / 255.0f + 0.5f);
+    };
+
+    return static_cast<std::uint16_t>(quantize(color[0], 31) << 11 | quantize(color[1], 63) << 5
+                                      | quantize(color[2], 31));
+}
+
+static void unpackRgb565(const std::uint16_t color, int rgb[3]) {
+    rgb[0] = expand5(color >> 11);
+    rgb[1] = expand6(color >> 5 & 63);
+    rgb[2] = expand5(color & 31);
+}
+
+static void getBc1Palette(const std::uint16_t color0, const std::uint16_t color1, int palette[4][3]) {
+    unpackRgb565(color0, palette[0]);
+    unpackRgb565(color1, palette[1]);
+
+    for (int channel = 0; channel < 3; channel++) {
+        const int first = palette[0][channel];
+        const int second = palette[1][channel];
+
+        // the order of the endpoints picks the mode -- the three-color one has transparent black as its last entry
+        if (color0 > color1) {
+            palette[2][channel] = (2 * first + second) / 3;
+            palette[3][channel] = (first + 2 * second) / 3;
+        } else {
+            palette[2][channel] = (first + second) / 2;
+            palette[3][channel] = 0;
+        }
+    }
+}
+
+static std::uint32_t getSquaredDistance(const ColorBlock &block, const std::size_t texel, const int color[3]) {
+    std::uint32_t distance = 0;
+    for (int channel = 0; channel < 3; channel++) {
+        const int difference = block.channels[channel][texel] - color[channel];
+        distance += static_cast<std::uint32_t>(difference * difference);
+    }
+
+    return distance;
+}
+
+/**
+ * Picks the nearest palette entry for every texel of the block, given its endpoints.
+ */
+static Bc1Block fitBc1Block(const ColorBlock &texels, const float endpoint0[3], const float endpoint1[3]) {
+    Bc1Block block{packRgb565(endpoint0), packRgb565(endpoint1), 0, 0};
+
+    // the four-color mode needs the first endpoint to be the greater one, which doesn't change the palette
+    if (block.color0 < block.color1) {
+        std::swap(block.color0, block.color1);
+    }
+
+    int palette[4][3];
+    getBc1Palette(block.color0, block.color1, palette);
+
+    // equal endpoints would select the three-color mode, so the block is left at the first one
+    const int paletteSize = block.color0 == block.color1 ? 1 : 4;
+
+    for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+        std::uint32_t bestDistance = std::numeric_limits<std::uint32_t>::max();
+        std::uint32_t bestIndex = 0;
+
+        for (int index = 0; index < paletteSize; index++) {
+            const std::uint32_t distance = getSquaredDistance(texels, i, palette[index]);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                bestIndex = index;
+            }
+        }
+
+        block.indices |= bestIndex << (2 * i);
+        block.error += bestDistance;
+    }
+
+    return block;
+}
+
+/**
+ * Moves the endpoints to where they minimize the squared error of the block, keeping every texel at the palette
+ * entry it was assigned to. Returns false if the texels all use the same entry, so the endpoints can't be solved for.
+ */
+static bool refineBc1Endpoints(const ColorBlock &texels, const Bc1Block &block, float endpoint0[3],
+                               float endpoint1[3]) {
+    // how much of the first endpoint goes into each palette entry
+    static constexpr float WEIGHTS[] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+    float weight00 = 0, weight01 = 0, weight11 = 0;
+    float target0[3] = {}, target1[3] = {};
+
+    for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+        const float weight0 = WEIGHTS[block.indices >> (2 * i) & 3];
+        const float weight1 = 1.0f - weight0;
+
+        weight00 += weight0 * weight0;
+        weight01 += weight0 * weight1;
+        weight11 += weight1 * weight1;
+
+        for (int channel = 0; channel < 3; channel++) {
+            target0[channel] += weight0 * static_cast<float>(texels.channels[channel][i]);
+            target1[channel] += weight1 * static_cast<float>(texels.channels[channel][i]);
+        }
+    }
+
+    const float determinant = weight00 * weight11 - weight01 * weight01;
+    if (std::abs(determinant) < 1e-6f) {
+        return false;
+    }
+
+    for (int channel = 0; channel < 3; channel++) {
+        endpoint0[channel] = (target0[channel] * weight11 - target1[channel] * weight01) / determinant;
+        endpoint1[channel] = (target1[channel] * weight00 - target0[channel] * weight01) / determinant;
+    }
+
+    return true;
+}
+
+/**
+ * Takes the endpoints from the corners of the block's bounding box, inset a little, as the extremes are usually
+ * outliers. The box's diagonal only runs along channels which grow together, so the ends of channels which fall as
+ * green grows are swapped.
+ */
+static void getBoundingBoxEndpoints(const ColorBlock &texels, float endpoint0[3], float endpoint1[3]) {
+    float means[3];
+    for (int channel = 0; channel < 3; channel++) {
+        const int *values = texels.channels[channel];
+        const auto [minValue, maxValue] = std::minmax_element(values, values + BLOCK_TEXELS);
+        const float inset = static_cast<float>(*maxValue - *minValue) / 16.0f;
+
+        endpoint0[channel] = static_cast<float>(*maxValue) - inset;
+        endpoint1[channel] = static_cast<float>(*minValue) + inset;
+
+        int sum = 0;
+        for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+            sum += values[i];
+        }
+
+        means[channel] = static_cast<float>(sum) / BLOCK_TEXELS;
+    }
+
+    for (const int channel : {0, 2}) {
+        float covariance = 0;
+        for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+            covariance += (static_cast<float>(texels.channels[channel][i]) - means[channel])
+                          * (static_cast<float>(texels.channels[1][i]) - means[1]);
+        }
+
+        if (covariance < 0) {
+            std::swap(endpoint0[channel], endpoint1[channel]);
+        }
+    }
+}
+
+/**
+ * Takes the endpoints from the texels furthest apart along the block's principal axis, found by power iteration
+ * over the covariance of its colors.
+ */
+static void getPrincipalAxisEndpoints(const ColorBlock &texels, float endpoint0[3], float endpoint1[3]) {
+    float means[3] = {};
+    for (int channel = 0; channel < 3; channel++) {
+        for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+            means[channel] += static_cast<float>(texels.channels[channel][i]);
+        }
+
+        means[channel] /= BLOCK_TEXELS;
+    }
+
+    float covariance[3][3] = {};
+    for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+        float centered[3];
+        for (int channel = 0; channel < 3; channel++) {
+            centered[channel] = static_cast<float>(texels.channels[channel][i]) - means[channel];
+        }
+
+        for (int row = 0; row < 3; row++) {
+            for (int column = 0; column < 3; column++) {
+                covariance[row][column] += centered[row] * centered[column];
+            }
+        }
+    }
+
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[3];
+        for (int row = 0; row < 3; row++) {
+            next[row] = covariance[row][0] * axis[0] + covariance[row][1] * axis[1] + covariance[row][2] * axis[2];
+        }
+
+        const float scale = std::max({std::abs(next[0]), std::abs(next[1]), std::abs(next[2])});
+        if (scale < 1e-6f) {
+            break;
+        }
+
+        for (int channel = 0; channel < 3; channel++) {
+            axis[channel] = next[channel] / scale;
+        }
+    }
+
+    std::size_t minTexel = 0, maxTexel = 0;
+    float minProjection = std::numeric_limits<float>::max();
+    float maxProjection = std::numeric_limits<float>::lowest();
+
+    for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+        float projection = 0;
+        for (int channel = 0; channel < 3; channel++) {
+            projection += static_cast<float>(texels.channels[channel][i]) * axis[channel];
+        }
+
+        if (projection < minProjection) {
+            minProjection = projection;
+            minTexel = i;
+        }
+
+        if (projection > maxProjection) {
+            maxProjection = projection;
+            maxTexel = i;
+        }
+    }
+
+    for (int channel = 0; channel < 3; channel++) {
+        endpoint0[channel] = static_cast<float>(texels.channels[channel][maxTexel]);
+        endpoint1[channel] = static_cast<float>(texels.channels[channel][minTexel]);
+    }
+}
+
+static std::array<SingleColorMatch, 256> buildSingleColorTable(const int bits) {
+    const int valueCount = 1 << bits;
+    const auto expand = bits == 5 ? expand5 : expand6;
+    std::array<SingleColorMatch, 256> table{};
+
+    for (int value = 0; value < 256; value++) {
+        int bestError = std::numeric_limits<int>::max();
+
+        for (int first = 0; first < valueCount; first++) {
+            for (int second = 0; second < valueCount; second++) {
+                // decoders are allowed to round the interpolation differently, so endpoints close to each other
+                // are preferred, which keeps that from making a visible difference
+                const int interpolated = (2 * expand(first) + expand(second)) / 3;
+                const int error = 256 * std::abs(interpolated - value) + std::abs(expand(first) - expand(second));
+
+                if (error < bestError) {
+                    bestError = error;
+                    table[value] = {static_cast<std::uint8_t>(first), static_cast<std::uint8_t>(second)};
+                }
+            }
+        }
+    }
+
+    return table;
+}
+
+/**
+ * Encodes a block of a single color, which a pair of endpoints can usually represent more closely through their
+ * interpolated color than through either endpoint on its own.
+ */
+static Bc1Block encodeSingleColorBc1(const ColorBlock &texels) {
+    static const std::array<SingleColorMatch, 256> matches5 = buildSingleColorTable(5);
+    static const std::array<SingleColorMatch, 256> matches6 = buildSingleColorTable(6);
+
+    const SingleColorMatch &red = matches5[texels.channels[0][0]];
+    const SingleColorMatch &green = matches6[texels.channels[1][0]];
+    const SingleColorMatch &blue = matches5[texels.channels[2][0]];
+
+    const float endpoint0[3] = {
+        static_cast<float>(expand5(red.endpoint0)),
+        static_cast<float>(expand6(green.endpoint0)),
+        static_cast<float>(expand5(blue.endpoint0))
+    };
+    const float endpoint1[3] = {
+        static_cast<float>(expand5(red.endpoint1)),
+        static_cast<float>(expand6(green.endpoint1)),
+        static_cast<float>(expand5(blue.endpoint1))
+    };
+
+    return fitBc1Block(texels, endpoint0, endpoint1);
+}
+
+static void encodeBc1Block(const ColorBlock &texels, const BlockQuality quality, std::uint8_t *output) {
+    bool isSingleColor = true;
+    for (int channel = 0; channel < 3; channel++) {
+        isSingleColor &= std::all_of(texels.channels[channel], texels.channels[channel] + BLOCK_TEXELS,
+                                     [&](const int value) { return value == texels.channels[channel][0]; });
+    }
+
+    Bc1Block best;
+
+    if (isSingleColor) {
+        best = encodeSingleColorBc1(texels);
+    } else if (quality == BlockQuality::FAST) {
+        float endpoint0[3], endpoint1[3];
+        getBoundingBoxEndpoints(texels, endpoint0, endpoint1);
+        best = fitBc1Block(texels, endpoint0, endpoint1);
+    } else {
+        float endpoint0[3], endpoint1[3];
+        getPrincipalAxisEndpoints(texels, endpoint0, endpoint1);
+        best = fitBc1Block(texels, endpoint0, endpoint1);
+
+        const int refinementCount = quality == BlockQuality::BEST ? MAX_BC1_REFINEMENTS : 1;
+        for (int refinement = 0; refinement < refinementCount && best.error > 0; refinement++) {
+            if (!refineBc1Endpoints(texels, best, endpoint0, endpoint1)) {
+                break;
+            }
+
+            const Bc1Block candidate = fitBc1Block(texels, endpoint0, endpoint1);
+            if (candidate.error >= best.error) {
+                break;
+            }
+
+            best = candidate;
+        }
+    }
+
+    std::memcpy(output, &best.color0, sizeof(best.color0));
+    std::memcpy(output + 2, &best.color1, sizeof(best.color1));
+    std::memcpy(output + 4, &best.indices, sizeof(best.indices));
+}
+
+static void getBc4Palette(const int endpoint0, const int endpoint1, int palette[8]) {
+    palette[0] = endpoint0;
+    palette[1] = endpoint1;
+
+    // like with BC1, the order of the endpoints picks the mode -- the six-value one also has exact 0 and 255
+    if (endpoint0 > endpoint1) {
+        for (int i = 1; i <= 6; i++) {
+            palette[i + 1] = ((7 - i) * endpoint0 + i * endpoint1 + 3) / 7;
+        }
+    } else {
+        for (int i = 1; i <= 4; i++) {
+            palette[i + 1] = ((5 - i) * endpoint0 + i * endpoint1 + 2) / 5;
+        }
+
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static Bc4Block fitBc4Block(const std::uint8_t values[BLOCK_TEXELS], const int endpoint0, const int endpoint1) {
+    Bc4Block block{static_cast<std::uint8_t>(endpoint0), static_cast<std::uint8_t>(endpoint1), 0, 0};
+
+    int palette[8];
+    getBc4Palette(endpoint0, endpoint1, palette);
+
+    for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+        std::uint32_t bestDistance = std::numeric_limits<std::uint32_t>::max();
+        std::uint64_t bestIndex = 0;
+
+        for (int index = 0; index < 8; index++) {
+            const int difference = values[i] - palette[index];
+            const auto distance = static_cast<std::uint32_t>(difference * difference);
+
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                bestIndex = index;
+            }
+        }
+
+        block.indices |= bestIndex << (3 * i);
+        block.error += bestDistance;
+    }
+
+    return block;
+}
+
+static void encodeBc4Block(const std::uint8_t values[BLOCK_TEXELS], const BlockQuality quality,
+                           std::uint8_t *output) {
+    const auto [minValue, maxValue] = std::minmax_element(values, values + BLOCK_TEXELS);
+    Bc4Block best = fitBc4Block(values, *maxValue, *minValue);
+
+    const auto tryEndpoints = [&](const int endpoint0, const int endpoint1) {
+        const Bc4Block candidate = fitBc4Block(values, endpoint0, endpoint1);
+        if (candidate.error < best.error) {
+            best = candidate;
+        }
+    };
+
+    // blocks with some texels at exactly 0 or 255 can leave those to the six-value mode, and spend its endpoints
+    // on the range of the others
+    if (quality != BlockQuality::FAST && best.error > 0 && (*minValue == 0 || *maxValue == 255)) {
+        int innerMin = 255, innerMax = 0;
+        for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+            if (values[i] != 0 && values[i] != 255) {
+                innerMin = std::min<int>(innerMin, values[i]);
+                innerMax = std::max<int>(innerMax, values[i]);
+            }
+        }
+
+        if (innerMin <= innerMax) {
+            tryEndpoints(innerMin, innerMax);
+        }
+    }
+
+    if (quality == BlockQuality::BEST && best.error > 0) {
+        for (int inset0 = 0; inset0 <= BC4_SEARCH_RADIUS; inset0++) {
+            for (int inset1 = 0; inset1 <= BC4_SEARCH_RADIUS; inset1++) {
+                if (*maxValue - inset0 > *minValue + inset1) {
+                    tryEndpoints(*maxValue - inset0, *minValue + inset1);
+                }
+            }
+        }
+    }
+
+    output[0] = best.endpoint0;
+    output[1] = best.endpoint1;
+    for (int i = 0; i < 6; i++) {
+        output[2 + i] = static_cast<std::uint8_t>(best.indices >> (8 * i));
+    }
+}
+
+static void decodeBc1Block(const std::uint8_t *input, int colors[BLOCK_TEXELS][3]) {
+    std::uint16_t color0, color1;
+    std::uint32_t indices;
+    std::memcpy(&color0, input, sizeof(color0));
+    std::memcpy(&color1, input + 2, sizeof(color1));
+    std::memcpy(&indices, input + 4, sizeof(indices));
+
+    int palette[4][3];
+    getBc1Palette(color0, color1, palette);
+
+    for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+        std::copy(palette[indices >> (2 * i) & 3], palette[indices >> (2 * i) & 3] + 3, colors[i]);
+    }
+}
+
+static void decodeBc4Block(const std::uint8_t *input, int values[BLOCK_TEXELS]) {
+    std::uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) {
+        indices |= static_cast<std::uint64_t>(input[2 + i]) << (8 * i);
+    }
+
+    int palette[8];
+    getBc4Palette(input[0], input[1], palette);
+
+    for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+        values[i] = palette[indices >> (3 * i) & 7];
+    }
+}
+
+/**
+ * Calls the given function with the RGBA8 texels of every block in the given rows of blocks, padding partial blocks
+ * at the edges by repeating the last row and column.
+ */
+template<typename F>
+static void forEachBlock(const std::uint8_t *texels, const int width, const int height, const std::size_t beginRow,
+                         const std::size_t endRow, const F &function) {
+    const int blocksPerRow = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    std::uint8_t block[BLOCK_TEXELS][4];
+
+    for (std::size_t blockY = beginRow; blockY < endRow; blockY++) {
+        for (int blockX = 0; blockX < blocksPerRow; blockX++) {
+            for (int y = 0; y < BLOCK_SIZE; y++) {
+                const int sourceY = std::min(static_cast<int>(blockY) * BLOCK_SIZE + y, height - 1);
+
+                for (int x = 0; x < BLOCK_SIZE; x++) {
+                    const int sourceX = std::min(blockX * BLOCK_SIZE + x, width - 1);
+                    const std::size_t texel = static_cast<std::size_t>(sourceY) * width + sourceX;
+                    std::memcpy(block[y * BLOCK_SIZE + x], texels + texel * 4, 4);
+                }
+            }
+
+            function(blockY, blockX, block);
+        }
+    }
+}
+
+void compressLevel(ThreadPool &threadPool, const std::uint8_t *texels, const int width, const int height,
+                   const TextureFormat format, const BlockQuality quality, std::uint8_t *blocks) {
+    if (format == TextureFormat::RGBA8) {
+        throw std::runtime_error("can't compress into an uncompressed format");
+    }
+
+    const std::size_t blockBytes = getBlockBytes(format);
+    const std::size_t rowBytes = getBlockRowBytes(format, width);
+    const auto rowCount = static_cast<std::size_t>(getBlockRowCount(format, height));
+
+    threadPool.parallelFor(rowCount, MIN_BLOCK_ROWS_PER_CHUNK, [&](const std::size_t begin, const std::size_t end) {
+        forEachBlock(texels, width, height, begin, end, [&](const std::size_t blockY, const int blockX,
+                                                             const std::uint8_t block[BLOCK_TEXELS][4]) {
+            std::uint8_t *output = blocks + blockY * rowBytes + blockX * blockBytes;
+
+            const auto getChannel = [&](const int channel, std::uint8_t values[BLOCK_TEXELS]) {
+                for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+                    values[i] = block[i][channel];
+                }
+            };
+
+            std::uint8_t values[BLOCK_TEXELS];
+            ColorBlock colors;
+
+            switch (format) {
+                case TextureFormat::BC3:
+                    getChannel(3, values);
+                    encodeBc4Block(values, quality, output);
+                    output += 8;
+                    [[fallthrough]];
+                case TextureFormat::BC1:
+                    for (int channel = 0; channel < 3; channel++) {
+                        for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+                            colors.channels[channel][i] = block[i][channel];
+                        }
+                    }
+
+                    encodeBc1Block(colors, quality, output);
+                    break;
+                case TextureFormat::BC5:
+                    getChannel(1, values);
+                    encodeBc4Block(values, quality, output + 8);
+                    [[fallthrough]];
+                case TextureFormat::BC4:
+                    getChannel(0, values);
+                    encodeBc4Block(values, quality, output);
+                    break;
+                default:
+                    break;
+            }
+        });
+    });
+}
+
+double measurePsnr(ThreadPool &threadPool, const std::uint8_t *texels, const int width, const int height,
+                   const TextureFormat format, const std::uint8_t *blocks) {
+    if (format == TextureFormat::RGBA8) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    const std::size_t blockBytes = getBlockBytes(format);
+    const std::size_t rowBytes = getBlockRowBytes(format, width);
+    const auto rowCount = static_cast<std::size_t>(getBlockRowCount(format, height));
+    const int channelCount = format == TextureFormat::BC1 ? 3
+                             : format == TextureFormat::BC3 ? 4
+                             : format == TextureFormat::BC5 ? 2
+                             : 1;
+
+    // every row of blocks sums up its own error, so no two threads ever write to the same place
+    std::vector<std::uint64_t> rowErrors(rowCount);
+
+    threadPool.parallelFor(rowCount, MIN_BLOCK_ROWS_PER_CHUNK, [&](const std::size_t begin, const std::size_t end) {
+        forEachBlock(texels, width, height, begin, end, [&](const std::size_t blockY, const int blockX,
+                                                             const std::uint8_t block[BLOCK_TEXELS][4]) {
+            const std::uint8_t *input = blocks + blockY * rowBytes + blockX * blockBytes;
+            int decoded[BLOCK_TEXELS][4] = {};
+            int values[BLOCK_TEXELS];
+            int colors[BLOCK_TEXELS][3];
+
+            switch (format) {
+                case TextureFormat::BC3:
+                    decodeBc4Block(input, values);
+                    for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+                        decoded[i][3] = values[i];
+                    }
+
+                    input += 8;
+                    [[fallthrough]];
+                case TextureFormat::BC1:
+                    decodeBc1Block(input, colors);
+                    for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+                        std::copy(colors[i], colors[i] + 3, decoded[i]);
+                    }
+
+                    break;
+                case TextureFormat::BC5:
+                    decodeBc4Block(input + 8, values);
+                    for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+                        decoded[i][1] = values[i];
+                    }
+
+                    [[fallthrough]];
+                case TextureFormat::BC4:
+                    decodeBc4Block(input, values);
+                    for (std::size_t i = 0; i < BLOCK_TEXELS; i++) {
+                        decoded[i][0] = values[i];
+                    }
+
+                    break;
+                default:
+                    break;
+            }
+
+            // padding texels of partial blocks aren't part of the image
+            const int blockWidth = std::min(BLOCK_SIZE, width - blockX * BLOCK_SIZE);
+            const int blockHeight = std::min(BLOCK_SIZE, height - static_cast<int>(blockY) * BLOCK_SIZE);
+
+            for (int y = 0; y < blockHeight; y++) {
+                for (int x = 0; x < blockWidth; x++) {
+                    for (int channel = 0; channel < channelCount; channel++) {
+                        const int difference = decoded[y * BLOCK_SIZE + x][channel]
+                                               - block[y * BLOCK_SIZE + x][channel];
+                        rowErrors[blockY] += static_cast<std::uint64_t>(difference * difference);
+                    }
+                }
+            }
+        });
+    });
+
+    std::uint64_t totalError = 0;
+    for (const std::uint64_t error : rowErrors) {
+        totalError += error;
+    }
+
+    if (totalError == 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    const double meanError = static_cast<double>(totalError)
+                             / (static_cast<double>(width) * height * channelCount);
+    return 10.0 * std::log10(255.0 * 255.0 / meanError);
+}
@@ -0,0 +1,81 @@
+#ifndef BLOCK_COMPRESSION_HPP
+#define BLOCK_COMPRESSION_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "utilities/thread-pool.hpp"
+
+/**
+ * How the texels of a texture level are stored. Block-compressed formats store every 4x4 block of texels in a fixed
+ * number of bytes, in rows of blocks, with partial blocks at the right and top edges padded.
+ */
+enum class TextureFormat : std::uint32_t {
+    // uncompressed, 4 bytes per texel
+    RGBA8 = 0,
+    // opaque colors, 8 bytes per block -- two RGB565 endpoints and 4 colors between them
+    BC1 = 1,
+    // colors with alpha, 16 bytes per block -- a BC4 block of alpha followed by a BC1 block of colors
+    BC3 = 2,
+    // a single channel, 8 bytes per block -- two 8-bit endpoints and 8 values between them
+    BC4 = 3,
+    // two channels, 16 bytes per block -- two BC4 blocks, for red and green
+    BC5 = 4,
+};
+
+/**
+ * How much time the encoder may spend looking for the best endpoints of each block.
+ */
+enum class BlockQuality : std::uint32_t {
+    // endpoints straight from the block's bounding box
+    FAST = 0,
+    // endpoints along the block's principal axis, refined once by least squares
+    BALANCED = 1,
+    // like balanced, but refined until the error stops dropping, and with a wider endpoint search for BC4
+    BEST = 2,
+};
+
+const char *getTextureFormatName(TextureFormat format);
+
+const char *getBlockQualityName(BlockQuality quality);
+
+/**
+ * Returns the width and height of the blocks of the given format, which is 1 for uncompressed formats.
+ */
+int getBlockSize(TextureFormat format);
+
+/**
+ * Returns the number of bytes a single block (or texel, for uncompressed formats) takes.
+ */
+std::size_t getBlockBytes(TextureFormat format);
+
+/**
+ * Returns the number of bytes a single row of blocks of a level takes.
+ */
+std::size_t getBlockRowBytes(TextureFormat format, int width);
+
+/**
+ * Returns the number of rows of blocks a level has.
+ */
+int getBlockRowCount(TextureFormat format, int height);
+
+/**
+ * Returns the number of bytes a whole level takes.
+ */
+std::size_t getLevelSize(TextureFormat format, int width, int height);
+
+/**
+ * Compresses a level of tightly packed RGBA8 texels into the given block-compressed format. BC4 takes the red
+ * channel, BC5 red and green. Rows of blocks are spread over the thread pool.
+ */
+void compressLevel(ThreadPool &threadPool, const std::uint8_t *texels, int width, int height, TextureFormat format,
+                   BlockQuality quality, std::uint8_t *blocks);
+
+/**
+ * Decompresses a level and compares it against the texels it was compressed from. Returns the peak signal-to-noise
+ * ratio in decibels over the channels stored by the format, which is infinite for a lossless result.
+ */
+double measurePsnr(ThreadPool &threadPool, const std::uint8_t *texels, int width, int height, TextureFormat format,
+                   const std::uint8_t *blocks);
+
+#endif //BLOCK_COMPRESSION_HPP
@@ -0,0 +1,529 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+// SAH is evaluated at the boundaries between this many bins along each axis -- or fewer for nodes with fewer
+// triangles, as more bins than triangles hardly ever find a better split but cost just as much to evaluate
+static constexpr int BIN_COUNT = 16;
+
+// leaves never hold more triangles than this, even where SAH says splitting doesn't pay off
+static constexpr std::size_t MAX_LEAF_TRIANGLES = 8;
+
+// cost of visiting a node, relative to the cost of testing a ray against a triangle
+static constexpr float TRAVERSAL_COST = 1.0f;
+
+// ranges of at most this many triangles are built as independent subtrees, one thread pool task each
+static constexpr std::size_t SUBTREE_TRIANGLES = 32768;
+
+// triangles handled by a single thread pool task when measuring or binning the top of the tree
+static constexpr std::size_t MIN_BUILD_CHUNK = 16384;
+
+// below this depth nodes are split in the middle instead of by SAH, which keeps the tree shallow enough for
+// the fixed-size traversal stack no matter how pathological the mesh is
+static constexpr std::size_t MAX_SAH_DEPTH = 64;
+static constexpr std::size_t TRAVERSAL_STACK_SIZE = 128;
+
+static constexpr float INFINITE_DISTANCE = std::numeric_limits<float>::infinity();
+
+struct Bounds {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    void grow(const glm::vec3 &point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void grow(const Bounds &other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    // SAH only ever compares areas, so halving them all changes nothing
+    [[nodiscard]] float getHalfArea() const {
+        const glm::vec3 extent = glm::max(max - min, glm::vec3(0.0f));
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+};
+
+/**
+ * Bounds of a range of triangles, and of their centroids, which are what the triangles are binned by.
+ */
+struct RangeBounds {
+    Bounds bounds;
+    Bounds centroidBounds;
+
+    void grow(const RangeBounds &other) {
+        bounds.grow(other.bounds);
+        centroidBounds.grow(other.centroidBounds);
+    }
+};
+
+struct Bin {
+    Bounds bounds;
+    std::size_t count = 0;
+};
+
+struct Bins {
+    int count;
+    Bin bins[3][BIN_COUNT];
+
+    explicit Bins(const std::size_t triangleCount)
+        : count(static_cast<int>(std::clamp<std::size_t>(triangleCount, 2, BIN_COUNT))) {}
+
+    void grow(const Bins &other) {
+        for (int axis = 0; axis < 3; axis++) {
+            for (int i = 0; i < count; i++) {
+                bins[axis][i].bounds.grow(other.bins[axis][i].bounds);
+                bins[axis][i].count += other.bins[axis][i].count;
+            }
+        }
+    }
+};
+
+struct Split {
+    int axis = -1; // -1 if no split is better than making a leaf
+    int bin = 0;   // triangles in bins before this one go to the first child
+};
+
+/**
+ * Builds the hierarchy's nodes, reordering `order` -- a permutation of the triangles -- so that every node
+ * covers a contiguous range of it.
+ */
+class BvhBuilder {
+    using Node = Bvh::Node;
+
+    // marks a leaf of the top of the tree which stands for a whole subtree, its offset being the subtree's index
+    static constexpr GLuint SUBTREE_MARKER = std::numeric_limits<GLuint>::max();
+
+    struct Subtree {
+        std::size_t begin;
+        std::size_t end;
+        std::size_t depth;
+        std::vector<Node> nodes;
+    };
+
+    ThreadPool &threadPool;
+    std::vector<Bounds> triangleBounds;
+    std::vector<glm::vec3> centroids;
+    std::vector<GLuint> order;
+
+    std::vector<Node> topNodes;
+    std::vector<Subtree> subtrees;
+
+public:
+    BvhBuilder(ThreadPool &threadPool, const std::span<const GLuint> indices, const std::span<const Vertex> vertices)
+        : threadPool(threadPool) {
+        const std::size_t triangleCount = indices.size() / 3;
+        triangleBounds.resize(triangleCount);
+        centroids.resize(triangleCount);
+        order.resize(triangleCount);
+
+        threadPool.parallelFor(triangleCount, MIN_BUILD_CHUNK, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t t = begin; t < end; t++) {
+                Bounds bounds;
+                for (int k = 0; k < 3; k++) {
+                    bounds.grow(vertices[indices[3 * t + k]].position);
+                }
+
+                triangleBounds[t] = bounds;
+                centroids[t] = (bounds.min + bounds.max) * 0.5f;
+                order[t] = static_cast<GLuint>(t);
+            }
+        });
+    }
+
+    /**
+     * Builds all the nodes, in their final depth-first order.
+     */
+    std::vector<Node> build() {
+        std::vector<Node> nodes;
+        if (order.empty()) {
+            return nodes;
+        }
+
+        buildTop(0, order.size(), 0);
+
+        threadPool.parallelFor(subtrees.size(), 1, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                Subtree &subtree = subtrees[i];
+                buildSubtree(subtree.begin, subtree.end, subtree.depth, subtree.nodes);
+            }
+        });
+
+        appendTopNode(0, nodes);
+        return nodes;
+    }
+
+    [[nodiscard]] std::span<const GLuint> getOrder() const { return order; }
+
+private:
+    /**
+     * Builds the nodes above the subtrees into `topNodes`, measuring and binning the large ranges they cover
+     * in parallel. Ranges small enough become subtrees, to be built later.
+     */
+    void buildTop(const std::size_t begin, const std::size_t end, const std::size_t depth) {
+        if (end - begin <= SUBTREE_TRIANGLES) {
+            topNodes.push_back({glm::vec3(0.0f), static_cast<GLuint>(subtrees.size()), glm::vec3(0.0f),
+                                SUBTREE_MARKER});
+            subtrees.push_back({begin, end, depth, {}});
+            return;
+        }
+
+        std::mutex mutex;
+        RangeBounds range;
+        threadPool.parallelFor(end - begin, MIN_BUILD_CHUNK, [&](const std::size_t chunkBegin,
+                                                                  const std::size_t chunkEnd) {
+            const RangeBounds chunkRange = measure(begin + chunkBegin, begin + chunkEnd);
+            const std::lock_guard lock(mutex);
+            range.grow(chunkRange);
+        });
+
+        Bins bins(end - begin);
+        threadPool.parallelFor(end - begin, MIN_BUILD_CHUNK, [&](const std::size_t chunkBegin,
+                                                                  const std::size_t chunkEnd) {
+            Bins chunkBins(end - begin);
+            bin(begin + chunkBegin, begin + chunkEnd, range.centroidBounds, chunkBins);
+            const std::lock_guard lock(mutex);
+            bins.grow(chunkBins);
+        });
+
+        const std::size_t middle = split(begin, end, depth, range, bins);
+
+        const std::size_t nodeIndex = topNodes.size();
+        topNodes.push_back({range.bounds.min, 0, range.bounds.max, 0});
+        buildTop(begin, middle, depth + 1);
+        topNodes[nodeIndex].offset = static_cast<GLuint>(topNodes.size());
+        buildTop(middle, end, depth + 1);
+    }
+
+    /**
+     * Builds the nodes covering a range of triangles, depth-first.
+     */
+    void buildSubtree(const std::size_t begin, const std::size_t end, const std::size_t depth,
+                      std::vector<Node> &nodes) {
+        const RangeBounds range = measure(begin, end);
+        const std::size_t nodeIndex = nodes.size();
+        nodes.push_back({range.bounds.min, static_cast<GLuint>(begin), range.bounds.max,
+                         static_cast<GLuint>(end - begin)});
+
+        Bins bins(end - begin);
+        bin(begin, end, range.centroidBounds, bins);
+
+        const std::size_t middle = split(begin, end, depth, range, bins);
+        if (middle == begin) {
+            return;
+        }
+
+        nodes[nodeIndex].triangleCount = 0;
+        buildSubtree(begin, middle, depth + 1, nodes);
+        nodes[nodeIndex].offset = static_cast<GLuint>(nodes.size());
+        buildSubtree(middle, end, depth + 1, nodes);
+    }
+
+    /**
+     * Copies the node at `topIndex` of the top of the tree, along with everything below it, into `nodes`.
+     */
+    void appendTopNode(const std::size_t topIndex, std::vector<Node> &nodes) const {
+        const Node &node = topNodes[topIndex];
+
+        if (node.triangleCount == SUBTREE_MARKER) {
+            // links between the subtree's nodes are relative to its start, triangle offsets are already final
+            const auto base = static_cast<GLuint>(nodes.size());
+            for (Node subtreeNode : subtrees[node.offset].nodes) {
+                if (subtreeNode.triangleCount == 0) {
+                    subtreeNode.offset += base;
+                }
+                nodes.push_back(subtreeNode);
+            }
+            return;
+        }
+
+        const std::size_t nodeIndex = nodes.size();
+        nodes.push_back(node);
+        appendTopNode(topIndex + 1, nodes);
+        nodes[nodeIndex].offset = static_cast<GLuint>(nodes.size());
+        appendTopNode(node.offset, nodes);
+    }
+
+    [[nodiscard]] RangeBounds measure(const std::size_t begin, const std::size_t end) const {
+        RangeBounds range;
+        for (std::size_t i = begin; i < end; i++) {
+            range.bounds.grow(triangleBounds[order[i]]);
+            range.centroidBounds.grow(centroids[order[i]]);
+        }
+        return range;
+    }
+
+    void bin(const std::size_t begin, const std::size_t end, const Bounds &centroidBounds, Bins &bins) const {
+        for (std::size_t i = begin; i < end; i++) {
+            const GLuint triangle = order[i];
+            for (int axis = 0; axis < 3; axis++) {
+                Bin &bin = bins.bins[axis][getBin(centroids[triangle], axis, centroidBounds, bins.count)];
+                bin.bounds.grow(triangleBounds[triangle]);
+                bin.count++;
+            }
+        }
+    }
+
+    static int getBin(const glm::vec3 &centroid, const int axis, const Bounds &centroidBounds, const int binCount) {
+        const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+        if (extent <= 0.0f) {
+            return 0;
+        }
+
+        const auto bin = static_cast<int>((centroid[axis] - centroidBounds.min[axis])
+                                          * (static_cast<float>(binCount) / extent));
+        return std::clamp(bin, 0, binCount - 1);
+    }
+
+    /**
+     * Picks the bin boundary with the lowest SAH cost, if splitting there is cheaper than making a leaf.
+     */
+    static Split findSplit(const std::size_t triangleCount, const Bounds &bounds, const Bins &bins) {
+        Split best;
+        float bestCost = triangleCount <= MAX_LEAF_TRIANGLES ? static_cast<float>(triangleCount)
+                                                             : INFINITE_DISTANCE;
+        const float inverseArea = 1.0f / std::max(bounds.getHalfArea(), std::numeric_limits<float>::min());
+
+        for (int axis = 0; axis < 3; axis++) {
+            // areas and counts of everything right of each boundary, then swept from the left
+            float rightAreas[BIN_COUNT];
+            std::size_t rightCounts[BIN_COUNT];
+            Bounds right;
+            std::size_t rightCount = 0;
+
+            for (int i = bins.count - 1; i > 0; i--) {
+                right.grow(bins.bins[axis][i].bounds);
+                rightCount += bins.bins[axis][i].count;
+                rightAreas[i] = right.getHalfArea();
+                rightCounts[i] = rightCount;
+            }
+
+            Bounds left;
+            std::size_t leftCount = 0;
+
+            for (int i = 1; i < bins.count; i++) {
+                left.grow(bins.bins[axis][i - 1].bounds);
+                leftCount += bins.bins[axis][i - 1].count;
+                if (leftCount == 0 || rightCounts[i] == 0) {
+                    continue;
+                }
+
+                const float cost = TRAVERSAL_COST + (left.getHalfArea() * static_cast<float>(leftCount)
+                                                     + rightAreas[i] * static_cast<float>(rightCounts[i]))
+                                                    * inverseArea;
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    best = {axis, i};
+                }
+            }
+        }
+
+        return best;
+    }
+
+    /**
+     * Partitions a range of triangles between two children and returns where the second one starts, or `begin`
+     * if the range should become a leaf.
+     */
+    std::size_t split(const std::size_t begin, const std::size_t end, const std::size_t depth,
+                      const RangeBounds &range, const Bins &bins) {
+        const std::size_t count = end - begin;
+        const Split split = depth < MAX_SAH_DEPTH ? findSplit(count, range.bounds, bins) : Split{};
+
+        if (split.axis >= 0) {
+            const auto middle = std::partition(order.begin() + static_cast<std::ptrdiff_t>(begin),
+                                               order.begin() + static_cast<std::ptrdiff_t>(end),
+                                               [&](const GLuint triangle) {
+                                                   return getBin(centroids[triangle], split.axis,
+                                                                 range.centroidBounds, bins.count) < split.bin;
+                                               });
+            return static_cast<std::size_t>(middle - order.begin());
+        }
+
+        if (count <= MAX_LEAF_TRIANGLES) {
+            return begin;
+        }
+
+        // binning can't separate the triangles (e.g. they all share a centroid), or the tree got too deep --
+        // split them in half along the widest axis instead
+        const glm::vec3 extent = range.centroidBounds.max - range.centroidBounds.min;
+        const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+        const std::size_t middle = begin + count / 2;
+
+        std::nth_element(order.begin() + static_cast<std::ptrdiff_t>(begin),
+                         order.begin() + static_cast<std::ptrdiff_t>(middle),
+                         order.begin() + static_cast<std::ptrdiff_t>(end),
+                         [&](const GLuint a, const GLuint b) { return centroids[a][axis] < centroids[b][axis]; });
+        return middle;
+    }
+};
+
+Bvh::Bvh(ThreadPool &threadPool, const std::span<const GLuint> indices, const std::span<const Vertex> vertices) {
+    BvhBuilder builder(threadPool, indices, vertices);
+    nodes = builder.build();
+
+    const std::span<const GLuint> order = builder.getOrder();
+    triangles.resize(order.size());
+
+    threadPool.parallelFor(order.size(), MIN_BUILD_CHUNK, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            const GLuint triangle = order[i];
+            const glm::vec3 &a = vertices[indices[3 * triangle]].position;
+            const glm::vec3 &b = vertices[indices[3 * triangle + 1]].position;
+            const glm::vec3 &c = vertices[indices[3 * triangle + 2]].position;
+            triangles[i] = {a, b - a, c - a, triangle};
+        }
+    });
+}
+
+/**
+ * Reciprocals of the directions of a packet's rays, so that box tests only multiply.
+ */
+struct InverseDirections {
+    float x[RAY_PACKET_SIZE], y[RAY_PACKET_SIZE], z[RAY_PACKET_SIZE];
+
+    explicit InverseDirections(const RayPacket &packet) {
+        for (std::size_t lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            x[lane] = 1.0f / packet.directionX[lane];
+            y[lane] = 1.0f / packet.directionY[lane];
+            z[lane] = 1.0f / packet.directionZ[lane];
+        }
+    }
+};
+
+/**
+ * Slab test of all the rays of a packet against a box. Returns the nearest distance at which any of the rays
+ * enters the box, or infinity if none of them hits it.
+ */
+static float intersectBounds(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const RayPacket &packet,
+                             const InverseDirections &inverse) {
+    float nearest = INFINITE_DISTANCE;
+
+    for (std::size_t lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+        const float x1 = (boundsMin.x - packet.originX[lane]) * inverse.x[lane];
+        const float x2 = (boundsMax.x - packet.originX[lane]) * inverse.x[lane];
+        const float y1 = (boundsMin.y - packet.originY[lane]) * inverse.y[lane];
+        const float y2 = (boundsMax.y - packet.originY[lane]) * inverse.y[lane];
+        const float z1 = (boundsMin.z - packet.originZ[lane]) * inverse.z[lane];
+        const float z2 = (boundsMax.z - packet.originZ[lane]) * inverse.z[lane];
+
+        const float entry = std::max(std::max(std::min(x1, x2), std::min(y1, y2)), std::max(std::min(z1, z2), 0.0f));
+        const float exit = std::min(std::min(std::max(x1, x2), std::max(y1, y2)),
+                                    std::min(std::max(z1, z2), packet.maxDistance[lane]));
+
+        nearest = std::min(nearest, entry <= exit ? entry : INFINITE_DISTANCE);
+    }
+
+    return nearest;
+}
+
+void Bvh::intersect(RayPacket &packet) const {
+    std::fill(std::begin(packet.triangles), std::end(packet.triangles), NO_HIT);
+
+    if (nodes.empty()) {
+        return;
+    }
+
+    const InverseDirections inverse(packet);
+    GLuint stack[TRAVERSAL_STACK_SIZE];
+    std::size_t stackSize = 0;
+
+    if (intersectBounds(nodes[0].boundsMin, nodes[0].boundsMax, packet, inverse) == INFINITE_DISTANCE) {
+        return;
+    }
+
+    GLuint current = 0;
+
+    while (true) {
+        const Node &node = nodes[current];
+
+        if (node.triangleCount > 0) {
+            intersectTriangles(packet, node.offset, node.triangleCount);
+        } else {
+            // both children are tested here, so that the nearer one can be visited first -- hits found in it
+            // shorten the rays, which often lets the farther one be skipped entirely
+            const GLuint first = current + 1;
+            const GLuint second = node.offset;
+            const float firstEntry = intersectBounds(nodes[first].boundsMin, nodes[first].boundsMax, packet,
+                                                     inverse);
+            const float secondEntry = intersectBounds(nodes[second].boundsMin, nodes[second].boundsMax, packet,
+                                                      inverse);
+
+            if (firstEntry != INFINITE_DISTANCE && secondEntry != INFINITE_DISTANCE) {
+                const bool isFirstNearer = firstEntry <= secondEntry;
+                stack[stackSize++] = isFirstNearer ? second : first;
+                current = isFirstNearer ? first : second;
+                continue;
+            }
+
+            if (firstEntry != INFINITE_DISTANCE || secondEntry != INFINITE_DISTANCE) {
+                current = firstEntry != INFINITE_DISTANCE ? first : second;
+                continue;
+            }
+        }
+
+        // rays may have been shortened since a node was pushed, so it's tested again before visiting it
+        do {
+            if (stackSize == 0) {
+                return;
+            }
+            current = stack[--stackSize];
+        } while (intersectBounds(nodes[current].boundsMin, nodes[current].boundsMax, packet, inverse)
+                 == INFINITE_DISTANCE);
+    }
+}
+
+RayHit Bvh::intersect(const glm::vec3 &origin, const glm::vec3 &direction, const float maxDistance) const {
+    RayPacket packet;
+
+    for (std::size_t lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+        packet.originX[lane] = origin.x;
+        packet.originY[lane] = origin.y;
+        packet.originZ[lane] = origin.z;
+        packet.directionX[lane] = direction.x;
+        packet.directionY[lane] = direction.y;
+        packet.directionZ[lane] = direction.z;
+        packet.maxDistance[lane] = lane == 0 ? maxDistance : -1.0f;
+    }
+
+    intersect(packet);
+    return {packet.triangles[0], packet.maxDistance[0]};
+}
+
+void Bvh::intersectBruteForce(RayPacket &packet) const {
+    std::fill(std::begin(packet.triangles), std::end(packet.triangles), NO_HIT);
+    intersectTriangles(packet, 0, triangles.size());
+}
+
+void Bvh::intersectTriangles(RayPacket &packet, const std::size_t first, const std::size_t count) const {
+    for (std::size_t i = first; i < first + count; i++) {
+        const Triangle &triangle = triangles[i];
+        const glm::vec3 &e1 = triangle.edge1;
+        const glm::vec3 &e2 = triangle.edge2;
+
+        // Moller-Trumbore, one triangle against all the rays at once. rays parallel to the triangle get an
+        // infinite or NaN inverse determinant, which fails the comparisons below
+        for (std::size_t lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            const float dx = packet.directionX[lane], dy = packet.directionY[lane], dz = packet.directionZ[lane];
+
+            const float px = dy * e2.z - dz * e2.y, py = dz * e2.x - dx * e2.z, pz = dx * e2.y - dy * e2.x;
+            const float inverseDeterminant = 1.0f / (e1.x * px + e1.y * py + e1.z * pz);
+
+            const float sx = packet.originX[lane] - triangle.vertex.x;
+            const float sy = packet.originY[lane] - triangle.vertex.y;
+            const float sz = packet.originZ[lane] - triangle.vertex.z;
+            const float u = (sx * px + sy * py + sz * pz) * inverseDeterminant;
+
+            const float qx = sy * e1.z - sz * e1.y, qy = sz * e1.x - sx * e1.z, qz = sx * e1.y - sy * e1.x;
+            const float v = (dx * qx + dy * qy + dz * qz) * inverseDeterminant;
+            const float t = (e2.x * qx + e2.y * qy + e2.z * qz) * inverseDeterminant;
+
+            const bool isHit = u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < packet.maxDistance[lane];
+            packet.maxDistance[lane] = isHit ? t : packet.maxDistance[lane];
+            packet.triangles[lane] = isHit ? triangle.index : packet.triangles[lane];
+        }
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "utilities/thread-pool.hpp"
+#include "vertex.hpp"
+
+/**
+ * Number of rays traced together by `Bvh::intersect`.
+ */
+static constexpr std::size_t RAY_PACKET_SIZE = 8;
+
+/**
+ * A bundle of rays which are traced through the hierarchy together, in structure-of-arrays form. Every step of the
+ * traversal is done for all the rays with a branchless loop, which compilers turn into SIMD code. Works best for
+ * coherent rays, e.g. ones going through neighbouring pixels.
+ */
+struct RayPacket {
+    float originX[RAY_PACKET_SIZE], originY[RAY_PACKET_SIZE], originZ[RAY_PACKET_SIZE];
+    float directionX[RAY_PACKET_SIZE], directionY[RAY_PACKET_SIZE], directionZ[RAY_PACKET_SIZE];
+
+    // how far along its direction each ray reaches -- replaced by the distance to the nearest hit, if there is one.
+    // rays with a negative distance are inactive and never hit anything
+    float maxDistance[RAY_PACKET_SIZE];
+
+    // set by the traversal to the nearest hit triangle, i.e. its first index divided by 3, or `Bvh::NO_HIT`
+    GLuint triangles[RAY_PACKET_SIZE];
+};
+
+/**
+ * Result of tracing a single ray.
+ */
+struct RayHit {
+    GLuint triangle; // its first index divided by 3, or `Bvh::NO_HIT`
+    float distance;  // in units of the ray direction's length
+};
+
+/**
+ * Bounding volume hierarchy over the triangles of a mesh, for ray queries on the CPU, e.g. picking.
+ *
+ * The hierarchy is built top-down, splitting nodes where the surface area heuristic says rays will find the fewest
+ * triangles to test, evaluated over a fixed number of bins along each axis. The top of the tree is built with
+ * binning spread over the thread pool, and the subtrees below it are built in parallel.
+ *
+ * Nodes are stored depth-first in a single array, each one taking half a cache line -- an interior node's first
+ * child directly follows it, so only the second one needs a link. Triangles are copied into the order in which the
+ * leaves reference them, already in the form the intersection test needs.
+ */
+class Bvh {
+    friend class BvhBuilder;
+
+    struct Node {
+        glm::vec3 boundsMin;
+        GLuint offset; // first triangle of a leaf, or the second child of an interior node
+        glm::vec3 boundsMax;
+        GLuint triangleCount; // 0 for interior nodes
+    };
+
+    struct Triangle {
+        glm::vec3 vertex;
+        glm::vec3 edge1;
+        glm::vec3 edge2;
+        GLuint index;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Triangle> triangles;
+
+public:
+    static constexpr GLuint NO_HIT = std::numeric_limits<GLuint>::max();
+
+    /**
+     * Builds the hierarchy over a triangle list, using the positions of the vertices.
+     */
+    Bvh(ThreadPool &threadPool, std::span<const GLuint> indices, std::span<const Vertex> vertices);
+
+    [[nodiscard]] std::size_t getNodeCount() const { return nodes.size(); }
+
+    [[nodiscard]] std::size_t getTriangleCount() const { return triangles.size(); }
+
+    /**
+     * Finds the nearest triangle hit by each ray of the packet, within its maximum distance.
+     */
+    void intersect(RayPacket &packet) const;
+
+    /**
+     * Finds the nearest triangle hit by a single ray, within the given distance.
+     */
+    [[nodiscard]] RayHit intersect(const glm::vec3 &origin, const glm::vec3 &direction,
+                                   float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    /**
+     * Same as `intersect`, but tests every triangle against every ray. Only meant as a reference for benchmarks.
+     */
+    void intersectBruteForce(RayPacket &packet) const;
+
+private:
+    void intersectTriangles(RayPacket &packet, std::size_t first, std::size_t count) const;
+};
+
+#endif //BVH_HPP
@@ -0,0 +1,456 @@
+#include "entropy-coder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+// longest code the encoder produces -- the decoder looks codes up in a table with an entry for every bit pattern
+// of this length, so this keeps it at 4 KB. a refilled bit buffer always holds 5 codes of this length
+static constexpr unsigned MAX_CODE_LENGTH = 11;
+static constexpr std::size_t DECODE_TABLE_SIZE = std::size_t{1} << MAX_CODE_LENGTH;
+static constexpr std::size_t SYMBOLS_PER_REFILL = 5;
+
+// streams are only Huffman-coded if that saves at least 1/16 of their size
+static constexpr std::size_t MIN_SAVING_DIVISOR = 16;
+
+static constexpr std::size_t SYMBOL_COUNT = 256;
+static constexpr std::size_t BITSTREAM_COUNT = 4;
+
+enum class StreamMode : std::uint8_t {
+    RAW = 0,
+    CONSTANT = 1,
+    HUFFMAN = 2,
+};
+
+using CodeLengths = std::array<std::uint8_t, SYMBOL_COUNT>;
+
+// all segments but the last have this size, the last one takes the rest
+static std::size_t getSegmentSize(const std::size_t streamSize) {
+    return streamSize / BITSTREAM_COUNT;
+}
+
+static void appendWord(std::vector<std::uint8_t> &output, const std::uint32_t word) {
+    for (std::size_t i = 0; i < sizeof(word); i++) {
+        output.push_back(static_cast<std::uint8_t>(word >> (8 * i)));
+    }
+}
+
+static std::uint32_t readWord(const std::uint8_t *data) {
+    std::uint32_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+static std::uint32_t reverseBits(std::uint32_t code, const unsigned length) {
+    std::uint32_t reversed = 0;
+    for (unsigned i = 0; i < length; i++) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+
+    return reversed;
+}
+
+/**
+ * Computes optimal code lengths with the two-queue Huffman construction, then limits them to `MAX_CODE_LENGTH`.
+ * Needs at least two symbols to occur.
+ */
+static CodeLengths buildCodeLengths(const std::array<std::size_t, SYMBOL_COUNT> &counts) {
+    struct Node {
+        std::size_t count;
+        std::size_t parent;
+    };
+
+    std::vector<std::uint8_t> symbols;
+    for (std::size_t symbol = 0; symbol < SYMBOL_COUNT; symbol++) {
+        if (counts[symbol]) {
+            symbols.push_back(static_cast<std::uint8_t>(symbol));
+        }
+    }
+
+    std::ranges::stable_sort(symbols, {}, [&](const std::uint8_t symbol) { return counts[symbol]; });
+
+    // leaves come first, sorted by count. interior nodes are created with non-decreasing counts, so they form a
+    // second sorted queue, and the two lightest nodes are always at the front of one of them
+    std::vector<Node> nodes;
+    nodes.reserve(2 * symbols.size() - 1);
+    for (const std::uint8_t symbol : symbols) {
+        nodes.push_back({counts[symbol], 0});
+    }
+
+    std::size_t nextLeaf = 0;
+    std::size_t nextInterior = symbols.size();
+
+    const auto takeLightest = [&] {
+        const bool takeLeaf = nextLeaf < symbols.size()
+                              && (nextInterior == nodes.size() || nodes[nextLeaf].count <= nodes[nextInterior].count);
+        return takeLeaf ? nextLeaf++ : nextInterior++;
+    };
+
+    while (nodes.size() < 2 * symbols.size() - 1) {
+        const std::size_t first = takeLightest();
+        const std::size_t second = takeLightest();
+        nodes[first].parent = nodes[second].parent = nodes.size();
+        nodes.push_back({nodes[first].count + nodes[second].count, 0});
+    }
+
+    // parents are created after their children, so walking backwards from the root visits every parent first
+    std::vector<unsigned> depths(nodes.size(), 0);
+    for (std::size_t i = nodes.size() - 1; i-- > 0;) {
+        depths[i] = depths[nodes[i].parent] + 1;
+    }
+
+    CodeLengths lengths{};
+    for (std::size_t i = 0; i < symbols.size(); i++) {
+        lengths[symbols[i]] = static_cast<std::uint8_t>(std::min(depths[i], MAX_CODE_LENGTH));
+    }
+
+    // clamping breaks the Kraft inequality if any code was too long. lengthen the longest codes which are still
+    // below the limit -- those free up the least code space each, so the fewest bits are wasted -- until it holds
+    constexpr std::size_t codeSpace = DECODE_TABLE_SIZE;
+    std::size_t usedSpace = 0;
+    for (const std::uint8_t symbol : symbols) {
+        usedSpace += codeSpace >> lengths[symbol];
+    }
+
+    while (usedSpace > codeSpace) {
+        std::uint8_t longest = symbols.front();
+        for (const std::uint8_t symbol : symbols) {
+            if (lengths[symbol] < MAX_CODE_LENGTH
+                && (lengths[longest] == MAX_CODE_LENGTH || lengths[symbol] >= lengths[longest])) {
+                longest = symbol;
+            }
+        }
+
+        usedSpace -= codeSpace >> (lengths[longest] + 1);
+        lengths[longest]++;
+    }
+
+    return lengths;
+}
+
+/**
+ * Assigns canonical codes -- ordered by length, then by symbol -- with bits reversed, as the bitstreams are read
+ * starting from the least significant bit. Fails if the lengths oversubscribe the code space.
+ */
+static bool assignCodes(const CodeLengths &lengths, std::array<std::uint32_t, SYMBOL_COUNT> &codes) {
+    std::array<std::uint32_t, MAX_CODE_LENGTH + 1> lengthCounts{};
+    for (const std::uint8_t length : lengths) {
+        lengthCounts[length]++;
+    }
+
+    lengthCounts[0] = 0;
+    std::array<std::uint32_t, MAX_CODE_LENGTH + 1> nextCodes{};
+    std::uint32_t code = 0;
+
+    for (unsigned length = 1; length <= MAX_CODE_LENGTH; length++) {
+        code = (code + lengthCounts[length - 1]) << 1;
+        nextCodes[length] = code;
+        if (code + lengthCounts[length] > (1u << length)) {
+            return false;
+        }
+    }
+
+    for (std::size_t symbol = 0; symbol < SYMBOL_COUNT; symbol++) {
+        if (lengths[symbol]) {
+            codes[symbol] = reverseBits(nextCodes[lengths[symbol]]++, lengths[symbol]);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Writes codes into a byte stream, least significant bit first.
+ */
+class BitWriter {
+    std::vector<std::uint8_t> &output;
+    std::uint64_t bits = 0;
+    unsigned bitCount = 0;
+
+public:
+    explicit BitWriter(std::vector<std::uint8_t> &output) : output(output) {}
+
+    void write(const std::uint32_t code, const unsigned length) {
+        bits |= static_cast<std::uint64_t>(code) << bitCount;
+        bitCount += length;
+
+        if (bitCount >= 32) {
+            appendWord(output, static_cast<std::uint32_t>(bits));
+            bits >>= 32;
+            bitCount -= 32;
+        }
+    }
+
+    void flush() {
+        for (; bitCount > 0; bitCount = bitCount > 8 ? bitCount - 8 : 0) {
+            output.push_back(static_cast<std::uint8_t>(bits));
+            bits >>= 8;
+        }
+    }
+};
+
+void entropyEncode(const std::span<const std::uint8_t> input, std::vector<std::uint8_t> &output) {
+    std::array<std::size_t, SYMBOL_COUNT> counts{};
+    for (const std::uint8_t byte : input) {
+        counts[byte]++;
+    }
+
+    const std::size_t distinctCount = SYMBOL_COUNT - static_cast<std::size_t>(std::ranges::count(counts, 0));
+
+    if (distinctCount == 1) {
+        output.push_back(static_cast<std::uint8_t>(StreamMode::CONSTANT));
+        output.push_back(input[0]);
+        return;
+    }
+
+    const auto storeRaw = [&] {
+        output.push_back(static_cast<std::uint8_t>(StreamMode::RAW));
+        output.insert(output.end(), input.begin(), input.end());
+    };
+
+    if (distinctCount == 0) {
+        storeRaw();
+        return;
+    }
+
+    const CodeLengths lengths = buildCodeLengths(counts);
+
+    // lengths are stored as nibbles, up to the last symbol which occurs -- deltas and high bytes rarely get far
+    std::size_t tableSymbolCount = SYMBOL_COUNT;
+    while (!lengths[tableSymbolCount - 1]) {
+        tableSymbolCount--;
+    }
+
+    std::size_t codedBits = 0;
+    for (std::size_t symbol = 0; symbol < SYMBOL_COUNT; symbol++) {
+        codedBits += counts[symbol] * lengths[symbol];
+    }
+
+    // decoding a Huffman-coded stream is several times slower than copying a raw one, so it has to pay for itself
+    const std::size_t headerSize = 2 + (tableSymbolCount + 1) / 2 + BITSTREAM_COUNT * sizeof(std::uint32_t);
+    const std::size_t codedSize = headerSize + codedBits / 8 + BITSTREAM_COUNT;
+    if (codedSize > input.size() - input.size() / MIN_SAVING_DIVISOR) {
+        storeRaw();
+        return;
+    }
+
+    std::array<std::uint32_t, SYMBOL_COUNT> codes{};
+    assignCodes(lengths, codes);
+
+    output.push_back(static_cast<std::uint8_t>(StreamMode::HUFFMAN));
+    output.push_back(static_cast<std::uint8_t>(tableSymbolCount - 1));
+    for (std::size_t symbol = 0; symbol < tableSymbolCount; symbol += 2) {
+        const std::uint8_t next = symbol + 1 < tableSymbolCount ? lengths[symbol + 1] : 0;
+        output.push_back(static_cast<std::uint8_t>(lengths[symbol] | (next << 4)));
+    }
+
+    // the sizes of the bitstreams are only known once they're written, so leave space for them
+    const std::size_t sizesOffset = output.size();
+    output.resize(output.size() + BITSTREAM_COUNT * sizeof(std::uint32_t));
+
+    const std::size_t segmentSize = getSegmentSize(input.size());
+
+    for (std::size_t stream = 0; stream < BITSTREAM_COUNT; stream++) {
+        const std::size_t streamStart = output.size();
+        const std::size_t first = stream * segmentSize;
+        const std::size_t last = stream + 1 < BITSTREAM_COUNT ? first + segmentSize : input.size();
+
+        BitWriter writer(output);
+        for (std::size_t i = first; i < last; i++) {
+            writer.write(codes[input[i]], lengths[input[i]]);
+        }
+        writer.flush();
+
+        const auto streamSize = static_cast<std::uint32_t>(output.size() - streamStart);
+        std::memcpy(output.data() + sizesOffset + stream * sizeof(std::uint32_t), &streamSize, sizeof(streamSize));
+    }
+}
+
+namespace {
+    struct DecodeEntry {
+        std::uint8_t symbol;
+        std::uint8_t length;
+    };
+
+    /**
+     * Reads codes from a bitstream, least significant bit first, keeping up to 64 bits buffered.
+     */
+    struct BitReader {
+        const std::uint8_t *position;
+        const std::uint8_t *end;
+        std::uint64_t bits = 0;
+        unsigned bitCount = 0;
+
+        [[nodiscard]] bool canRefillFast() const {
+            return end - position >= static_cast<std::ptrdiff_t>(sizeof(std::uint64_t));
+        }
+
+        // tops the buffer up to at least 56 bits with a single unaligned load. needs 8 readable bytes
+        void refillFast() {
+            std::uint64_t word;
+            std::memcpy(&word, position, sizeof(word));
+            bits |= word << bitCount;
+            position += (63 - bitCount) >> 3;
+            bitCount |= 56;
+        }
+
+        // same, a byte at a time, as if the stream was followed by zeros. these can only be decoded from a
+        // corrupted stream, and just produce garbage rather than reading out of bounds
+        void refillSafe() {
+            for (; bitCount <= 56; bitCount += 8) {
+                const std::uint64_t byte = position < end ? *position++ : 0;
+                bits |= byte << bitCount;
+            }
+        }
+
+        std::uint8_t decode(const DecodeEntry *table, const std::uint64_t tableMask) {
+            const DecodeEntry entry = table[bits & tableMask];
+            bits >>= entry.length;
+            bitCount -= entry.length;
+            return entry.symbol;
+        }
+    };
+}
+
+static void decodeHuffman(const std::span<const std::uint8_t> input, const std::span<std::uint8_t> output,
+                          const CodeLengths &lengths) {
+    std::array<std::uint32_t, SYMBOL_COUNT> codes{};
+    if (!assignCodes(lengths, codes)) {
+        throw std::runtime_error("malformed entropy-coded stream: invalid code lengths");
+    }
+
+    // the table only needs to be as large as the longest code, which saves filling it for skewed streams. every
+    // code fills all entries whose low bits match it. entries which no code fills can only be hit by a corrupted
+    // stream
+    const std::size_t tableSize = std::size_t{1} << *std::ranges::max_element(lengths);
+    const std::uint64_t tableMask = tableSize - 1;
+    std::array<DecodeEntry, DECODE_TABLE_SIZE> table;
+    std::fill_n(table.begin(), tableSize, DecodeEntry{0, 1});
+
+    for (std::size_t symbol = 0; symbol < SYMBOL_COUNT; symbol++) {
+        const std::uint8_t length = lengths[symbol];
+        if (!length) {
+            continue;
+        }
+
+        for (std::size_t entry = codes[symbol]; entry < tableSize; entry += std::size_t{1} << length) {
+            table[entry] = {static_cast<std::uint8_t>(symbol), length};
+        }
+    }
+
+    std::array<BitReader, BITSTREAM_COUNT> readers;
+    std::array<std::uint8_t *, BITSTREAM_COUNT> segments{};
+    const std::uint8_t *streamStart = input.data() + BITSTREAM_COUNT * sizeof(std::uint32_t);
+
+    for (std::size_t stream = 0; stream < BITSTREAM_COUNT; stream++) {
+        const std::uint32_t streamSize = readWord(input.data() + stream * sizeof(std::uint32_t));
+        readers[stream] = {streamStart, streamStart + streamSize};
+        streamStart += streamSize;
+    }
+
+    const std::size_t segmentSize = getSegmentSize(output.size());
+    const std::size_t lastSegmentSize = output.size() - (BITSTREAM_COUNT - 1) * segmentSize;
+    for (std::size_t stream = 0; stream < BITSTREAM_COUNT; stream++) {
+        segments[stream] = output.data() + stream * segmentSize;
+    }
+
+    // decode all segments in lockstep while every one of them has room and every bitstream can be refilled with a
+    // single load. the four readers don't depend on each other, so their table lookups overlap. they're copied into
+    // separate locals, which compilers keep in registers -- kept in the array, they'd be reloaded after every store
+    // to the output, which may alias anything
+    static_assert(BITSTREAM_COUNT == 4);
+    BitReader reader0 = readers[0], reader1 = readers[1], reader2 = readers[2], reader3 = readers[3];
+    std::uint8_t *out0 = segments[0], *out1 = segments[1], *out2 = segments[2], *out3 = segments[3];
+    std::size_t i = 0;
+
+    for (; i + SYMBOLS_PER_REFILL <= segmentSize; i += SYMBOLS_PER_REFILL) {
+        if (!reader0.canRefillFast() || !reader1.canRefillFast()
+            || !reader2.canRefillFast() || !reader3.canRefillFast()) {
+            break;
+        }
+
+        reader0.refillFast();
+        reader1.refillFast();
+        reader2.refillFast();
+        reader3.refillFast();
+
+        for (std::size_t j = 0; j < SYMBOLS_PER_REFILL; j++) {
+            out0[i + j] = reader0.decode(table.data(), tableMask);
+            out1[i + j] = reader1.decode(table.data(), tableMask);
+            out2[i + j] = reader2.decode(table.data(), tableMask);
+            out3[i + j] = reader3.decode(table.data(), tableMask);
+        }
+    }
+
+    readers = {reader0, reader1, reader2, reader3};
+
+    for (std::size_t stream = 0; stream < BITSTREAM_COUNT; stream++) {
+        const std::size_t size = stream + 1 < BITSTREAM_COUNT ? segmentSize : lastSegmentSize;
+        BitReader &reader = readers[stream];
+
+        for (std::size_t j = i; j < size; j++) {
+            if (reader.bitCount < MAX_CODE_LENGTH) {
+                reader.refillSafe();
+            }
+
+            segments[stream][j] = reader.decode(table.data(), tableMask);
+        }
+    }
+}
+
+std::size_t entropyDecode(const std::span<const std::uint8_t> input, const std::span<std::uint8_t> output) {
+    if (input.empty()) {
+        throw std::runtime_error("malformed entropy-coded stream: missing header");
+    }
+
+    switch (static_cast<StreamMode>(input[0])) {
+        case StreamMode::RAW:
+            if (input.size() < 1 + output.size()) {
+                throw std::runtime_error("malformed entropy-coded stream: truncated raw stream");
+            }
+
+            std::ranges::copy(input.subspan(1, output.size()), output.begin());
+            return 1 + output.size();
+
+        case StreamMode::CONSTANT:
+            if (input.size() < 2) {
+                throw std::runtime_error("malformed entropy-coded stream: truncated constant stream");
+            }
+
+            std::ranges::fill(output, input[1]);
+            return 2;
+
+        case StreamMode::HUFFMAN: {
+            const std::size_t tableSymbolCount = input.size() > 1 ? input[1] + std::size_t{1} : 0;
+            const std::size_t tableSize = (tableSymbolCount + 1) / 2;
+            const std::size_t headerSize = 2 + tableSize + BITSTREAM_COUNT * sizeof(std::uint32_t);
+            if (input.size() < headerSize) {
+                throw std::runtime_error("malformed entropy-coded stream: truncated header");
+            }
+
+            CodeLengths lengths{};
+            for (std::size_t symbol = 0; symbol < tableSymbolCount; symbol++) {
+                lengths[symbol] = (input[2 + symbol / 2] >> (4 * (symbol % 2))) & 0xF;
+                if (lengths[symbol] > MAX_CODE_LENGTH) {
+                    throw std::runtime_error("malformed entropy-coded stream: code too long");
+                }
+            }
+
+            std::size_t streamsSize = 0;
+            for (std::size_t stream = 0; stream < BITSTREAM_COUNT; stream++) {
+                streamsSize += readWord(input.data() + 2 + tableSize + stream * sizeof(std::uint32_t));
+            }
+
+            if (input.size() - headerSize < streamsSize || output.size() < BITSTREAM_COUNT) {
+                throw std::runtime_error("malformed entropy-coded stream: truncated bitstreams");
+            }
+
+            decodeHuffman(input.subspan(2 + tableSize), output, lengths);
+            return headerSize + streamsSize;
+        }
+    }
+
+    throw std::runtime_error("malformed entropy-coded stream: unknown mode");
+}
@@ -0,0 +1,25 @@
+#ifndef ENTROPY_CODER_HPP
+#define ENTROPY_CODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * Appends the entropy-coded form of a byte stream to `output`.
+ *
+ * Bytes are coded with a canonical Huffman code built for this stream alone, with code lengths limited so that
+ * the decoding table fits comfortably in L1 cache. The stream is split into four parts coded into separate
+ * bitstreams, which lets the decoder work on four independent dependency chains at once. Streams which wouldn't
+ * get any smaller are stored as-is, and ones made of a single repeated byte as just that byte.
+ */
+void entropyEncode(std::span<const std::uint8_t> input, std::vector<std::uint8_t> &output);
+
+/**
+ * Decodes a stream written by `entropyEncode`, filling the whole of `output`, whose size must be that of the
+ * original stream. Returns how many bytes of `input` the encoded stream took. Throws if the input is malformed.
+ */
+std::size_t entropyDecode(std::span<const std::uint8_t> input, std::span<std::uint8_t> output);
+
+#endif //ENTROPY_CODER_HPP
@@ -0,0 +1,182 @@
+#include "index-buffer.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "utilities/gl-state.hpp"
+
+static constexpr std::size_t SHORT_INDEX_RANGE = std::numeric_limits<GLushort>::max() + std::size_t{1};
+
+// every segment costs an extra draw call, so below this many indices per segment 32-bit indices win
+static constexpr std::size_t MIN_SEGMENT_INDICES = 16384;
+
+IndexBuffer::IndexBuffer(const std::span<const GLuint> indices, const std::size_t vertexCount,
+                         const bool isUploadDeferred)
+    : indexCount(indices.size()) {
+    bool useShortIndices = true;
+
+    if (vertexCount <= SHORT_INDEX_RANGE) {
+        segments.push_back({0, indices.size(), 0});
+    } else {
+        // greedily extend the current segment as long as its vertices still fit in a 16-bit range
+        std::size_t segmentStart = 0;
+        GLuint minVertex = std::numeric_limits<GLuint>::max();
+        GLuint maxVertex = 0;
+        bool hasWideTriangle = false;
+
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const GLuint triangleMin = std::min({indices[i], indices[i + 1], indices[i + 2]});
+            const GLuint triangleMax = std::max({indices[i], indices[i + 1], indices[i + 2]});
+
+            // a triangle spanning more vertices than 16 bits can reach doesn't fit in any segment, which can happen
+            // e.g. in coarse LODs, whose triangles may reach across the whole mesh
+            if (triangleMax - triangleMin >= SHORT_INDEX_RANGE) {
+                hasWideTriangle = true;
+                break;
+            }
+
+            if (std::max(maxVertex, triangleMax) - std::min(minVertex, triangleMin) >= SHORT_INDEX_RANGE) {
+                segments.push_back({segmentStart, i - segmentStart, static_cast<GLint>(minVertex)});
+                segmentStart = i;
+                minVertex = triangleMin;
+                maxVertex = triangleMax;
+            } else {
+                minVertex = std::min(minVertex, triangleMin);
+                maxVertex = std::max(maxVertex, triangleMax);
+            }
+        }
+
+        if (segmentStart < indices.size()) {
+            segments.push_back({segmentStart, indices.size() - segmentStart, static_cast<GLint>(minVertex)});
+        }
+
+        if (hasWideTriangle || segments.size() * MIN_SEGMENT_INDICES > indices.size()) {
+            segments = {{0, indices.size(), 0}};
+            useShortIndices = false;
+        }
+    }
+
+    indexType = useShortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    indexSize = useShortIndices ? sizeof(GLushort) : sizeof(GLuint);
+
+    glGenBuffers(1, &ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(getSizeBytes()), nullptr, GL_STATIC_DRAW);
+
+    if (!isUploadDeferred) {
+        upload(indices, 0, indices.size());
+    }
+}
+
+void IndexBuffer::upload(const std::span<const GLuint> indices, const std::size_t firstIndex,
+                         const std::size_t count) const {
+    if (count == 0) {
+        return;
+    }
+
+    // the copy target leaves the element buffer binding of whatever vertex array is bound alone
+    getGLState().bindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+
+    const auto offset = static_cast<GLintptr>(firstIndex * indexSize);
+    const auto sizeBytes = static_cast<GLsizeiptr>(count * indexSize);
+
+    if (indexType == GL_UNSIGNED_INT) {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, sizeBytes, indices.data() + firstIndex);
+        return;
+    }
+
+    // narrow the indices straight into the buffer's memory instead of going through a temporary copy
+    auto *mapped = static_cast<GLushort *>(glMapBufferRange(
+        GL_COPY_WRITE_BUFFER, offset, sizeBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+    if (!mapped) {
+        throw std::runtime_error("failed to map index buffer");
+    }
+
+    const std::size_t lastIndex = firstIndex + count;
+
+    for (const Segment &segment : segments) {
+        const std::size_t begin = std::max(firstIndex, segment.firstIndex);
+        const std::size_t end = std::min(lastIndex, segment.firstIndex + segment.indexCount);
+        const auto baseVertex = static_cast<GLuint>(segment.baseVertex);
+
+        for (std::size_t i = begin; i < end; i++) {
+            mapped[i - firstIndex] = static_cast<GLushort>(indices[i] - baseVertex);
+        }
+    }
+
+    if (!glUnmapBuffer(GL_COPY_WRITE_BUFFER)) {
+        throw std::runtime_error("index buffer contents were lost while mapped");
+    }
+}
+
+IndexBuffer::~IndexBuffer() {
+    getGLState().deleteBuffer(ebo);
+}
+
+void IndexBuffer::draw(const std::size_t firstIndex, const std::size_t count) const {
+    const std::size_t lastIndex = firstIndex + count;
+
+    // find the last segment starting at or before `firstIndex` -- segments are sorted and cover all indices
+    auto it = std::upper_bound(segments.begin(), segments.end(), firstIndex,
+                               [](const std::size_t index, const Segment &segment) {
+                                   return index < segment.firstIndex;
+                               });
+    if (it != segments.begin()) --it;
+
+    for (; it != segments.end() && it->firstIndex < lastIndex; ++it) {
+        const std::size_t begin = std::max(firstIndex, it->firstIndex);
+        const std::size_t end = std::min(lastIndex, it->firstIndex + it->indexCount);
+        if (begin >= end) continue;
+
+        const auto offset = reinterpret_cast<void *>(begin * indexSize);
+
+        if (it->baseVertex == 0) {
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(end - begin), indexType, offset);
+        } else {
+            glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(end - begin), indexType, offset,
+                                     it->baseVertex);
+        }
+    }
+}
+
+void IndexBuffer::multiDraw(const std::span<const DrawRange> ranges) const {
+    auto range = ranges.begin();
+
+    for (const Segment &segment : segments) {
+        const std::size_t segmentEnd = segment.firstIndex + segment.indexCount;
+
+        drawCounts.clear();
+        drawOffsets.clear();
+        drawBaseVertices.clear();
+
+        // a range crossing into the next segment contributes a piece to each of them, so it's only
+        // consumed once it has been fully covered
+        for (; range != ranges.end() && range->firstIndex < segmentEnd; ++range) {
+            const std::size_t begin = std::max(range->firstIndex, segment.firstIndex);
+            const std::size_t end = std::min(range->firstIndex + range->indexCount, segmentEnd);
+
+            if (begin < end) {
+                drawCounts.push_back(static_cast<GLsizei>(end - begin));
+                drawOffsets.push_back(reinterpret_cast<void *>(begin * indexSize));
+                drawBaseVertices.push_back(segment.baseVertex);
+            }
+
+            if (range->firstIndex + range->indexCount > segmentEnd) {
+                break;
+            }
+        }
+
+        if (drawCounts.empty()) {
+            continue;
+        }
+
+        if (segment.baseVertex == 0) {
+            glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), indexType, drawOffsets.data(),
+                                static_cast<GLsizei>(drawCounts.size()));
+        } else {
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), indexType, drawOffsets.data(),
+                                          static_cast<GLsizei>(drawCounts.size()), drawBaseVertices.data());
+        }
+    }
+}
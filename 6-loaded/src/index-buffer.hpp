@@ -0,0 +1,93 @@
+#ifndef INDEX_BUFFER_HPP
+#define INDEX_BUFFER_HPP
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <GL/glew.h>
+
+/**
+ * Range of a triangle list to be drawn, in indices.
+ */
+struct DrawRange {
+    std::size_t firstIndex;
+    std::size_t indexCount;
+};
+
+/**
+ * Element buffer that stores a triangle list using the narrowest index type that fits.
+ *
+ * Meshes with at most 65536 vertices simply get 16-bit indices. Larger meshes are cut into consecutive
+ * segments of triangles whose vertices span at most 65536 consecutive ids, each stored relative to its lowest
+ * vertex and drawn with that vertex as the base vertex. This only works well for meshes whose index buffer
+ * references vertices mostly in order (which `optimizeVertexFetch` guarantees), so if the mesh would need too
+ * many segments, or has a triangle which doesn't fit in any, it falls back to 32-bit indices.
+ */
+class IndexBuffer {
+    struct Segment {
+        std::size_t firstIndex;
+        std::size_t indexCount;
+        GLint baseVertex;
+    };
+
+    GLuint ebo = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    std::size_t indexSize = sizeof(GLuint);
+    std::size_t indexCount = 0;
+    std::vector<Segment> segments;
+
+    // reused between calls to `multiDraw` to avoid allocating every frame
+    mutable std::vector<GLsizei> drawCounts;
+    mutable std::vector<void *> drawOffsets;
+    mutable std::vector<GLint> drawBaseVertices;
+
+public:
+    /**
+     * Creates the buffer and uploads the indices. Element buffer bindings are part of the vertex array state,
+     * so the vertex array which will be used to draw the mesh has to be bound.
+     *
+     * If `isUploadDeferred` is set, the buffer's storage is only allocated, and the indices have to be uploaded
+     * with `upload` before drawing them.
+     */
+    IndexBuffer(std::span<const GLuint> indices, std::size_t vertexCount, bool isUploadDeferred = false);
+
+    ~IndexBuffer();
+
+    IndexBuffer(const IndexBuffer &other) = delete;
+
+    IndexBuffer &operator=(const IndexBuffer &other) = delete;
+
+    [[nodiscard]] GLenum getIndexType() const { return indexType; }
+
+    [[nodiscard]] std::size_t getIndexCount() const { return indexCount; }
+
+    [[nodiscard]] std::size_t getSegmentCount() const { return segments.size(); }
+
+    [[nodiscard]] std::size_t getSizeBytes() const { return indexCount * indexSize; }
+
+    /**
+     * Uploads a range of the indices, which have to be the same ones the buffer was created with. Lets the upload
+     * of a large buffer be spread over multiple frames. Doesn't depend on any vertex array being bound.
+     */
+    void upload(std::span<const GLuint> indices, std::size_t firstIndex, std::size_t count) const;
+
+    /**
+     * Draws all triangles.
+     */
+    void draw() const { draw(0, indexCount); }
+
+    /**
+     * Draws a range of triangles, given in terms of the original index list. Ranges crossing segment boundaries
+     * are split into one draw call per segment.
+     */
+    void draw(std::size_t firstIndex, std::size_t count) const;
+
+    /**
+     * Draws multiple ranges of triangles with as few draw calls as possible -- a single one per segment.
+     * The ranges have to be sorted by their first index and must not overlap.
+     */
+    void multiDraw(std::span<const DrawRange> ranges) const;
+};
+
+#endif //INDEX_BUFFER_HPP
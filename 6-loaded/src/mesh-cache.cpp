@@ -0,0 +1,428 @@
+#include "mesh-cache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "record-codec.hpp"
+
+// large files are read and copied in blocks of this size, rather than all at once
+static constexpr std::size_t IO_BLOCK_BYTES = 1024 * 1024;
+
+static constexpr std::uint64_t alignUp(const std::uint64_t value, const std::uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+namespace {
+    /**
+     * Placement of one of the arrays within a cache file.
+     */
+    struct MeshCacheSection {
+        std::uint64_t offset;
+        std::uint64_t count;
+        std::size_t recordSize;
+
+        [[nodiscard]] std::uint64_t getEnd() const { return offset + count * recordSize; }
+
+        /**
+         * Whether the section lies behind the header and within the given number of bytes. The offset and count may
+         * come from a corrupted file, so this is checked without overflowing.
+         */
+        [[nodiscard]] bool isWithin(const std::uint64_t size) const {
+            return offset >= sizeof(MeshCacheHeader) && offset <= size && count <= (size - offset) / recordSize;
+        }
+    };
+}
+
+static std::array<MeshCacheSection, MeshPackHeader::SECTION_COUNT> getSections(const MeshCacheHeader &header) {
+    return {
+        {
+            {header.vertexOffset, header.vertexCount, sizeof(Vertex)},
+            {header.indexOffset, header.indexCount, sizeof(GLuint)},
+            {header.meshletOffset, header.meshletCount, sizeof(Meshlet)},
+            {header.lodOffset, header.lodCount, sizeof(MeshLod)},
+            {header.submeshOffset, header.submeshCount, sizeof(MeshSubmesh)},
+            {header.materialOffset, header.materialCount, sizeof(MeshMaterial)},
+        }
+    };
+}
+
+std::unique_ptr<CachedMesh> CachedMesh::open(const std::filesystem::path &path, const std::uint64_t sourceHash,
+                                             const std::uint32_t cookFlags) {
+    if (!std::filesystem::exists(path)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<CachedMesh> mesh(new CachedMesh());
+    mesh->file.emplace(path);
+    mesh->data = mesh->file->getData();
+
+    if (!mesh->isValid(sourceHash, cookFlags)) {
+        return nullptr;
+    }
+
+    mesh->mapArrays();
+    return mesh;
+}
+
+std::unique_ptr<CachedMesh> CachedMesh::openCompressed(ThreadPool &threadPool, const std::filesystem::path &path,
+                                                       const std::optional<std::uint64_t> sourceHash,
+                                                       const std::uint32_t cookFlags) {
+    if (!std::filesystem::exists(path)) {
+        return nullptr;
+    }
+
+    const MappedFile packFile(path);
+    const std::span<const std::byte> packData = packFile.getData();
+    if (packData.size() < sizeof(MeshPackHeader)) {
+        return nullptr;
+    }
+
+    MeshPackHeader header;
+    std::memcpy(&header, packData.data(), sizeof(header));
+
+    if (header.magic != MeshPackHeader::MAGIC
+        || header.version != MeshPackHeader::VERSION
+        || !isCompatible(header.cache, sourceHash, cookFlags)) {
+        return nullptr;
+    }
+
+    // the arrays are decoded behind the header, and must not send us writing past the end of the buffer
+    const auto sections = getSections(header.cache);
+    std::uint64_t decodedSize = sizeof(MeshCacheHeader);
+    std::uint64_t packedSize = sizeof(MeshPackHeader);
+
+    for (std::size_t i = 0; i < sections.size(); i++) {
+        const MeshCacheSection &section = sections[i];
+        if (!section.isWithin(std::numeric_limits<std::uint64_t>::max())) {
+            return nullptr;
+        }
+
+        decodedSize = std::max(decodedSize, sections[i].getEnd());
+        packedSize += header.sectionSizes[i];
+    }
+
+    if (packedSize > packData.size()) {
+        return nullptr;
+    }
+
+    std::unique_ptr<CachedMesh> mesh(new CachedMesh());
+    mesh->decodedData.reset(new std::byte[decodedSize]);
+    mesh->data = {mesh->decodedData.get(), static_cast<std::size_t>(decodedSize)};
+    std::memcpy(mesh->decodedData.get(), &header.cache, sizeof(header.cache));
+
+    const auto *packed = reinterpret_cast<const std::uint8_t *>(packData.data()) + sizeof(MeshPackHeader);
+
+    for (std::size_t i = 0; i < sections.size(); i++) {
+        const MeshCacheSection &section = sections[i];
+        const std::span<std::byte> records(mesh->decodedData.get() + section.offset,
+                                           static_cast<std::size_t>(section.count * section.recordSize));
+        decodeRecords(threadPool, {packed, static_cast<std::size_t>(header.sectionSizes[i])}, records,
+                      section.recordSize);
+        packed += header.sectionSizes[i];
+    }
+
+    mesh->mapArrays();
+    return mesh;
+}
+
+void CachedMesh::mapArrays() {
+    const MeshCacheHeader &header = getHeader();
+    const std::byte *base = data.data();
+
+    vertices = {
+        reinterpret_cast<const Vertex *>(base + header.vertexOffset),
+        static_cast<std::size_t>(header.vertexCount)
+    };
+    indices = {
+        reinterpret_cast<const GLuint *>(base + header.indexOffset),
+        static_cast<std::size_t>(header.indexCount)
+    };
+    meshlets = {
+        reinterpret_cast<const Meshlet *>(base + header.meshletOffset),
+        static_cast<std::size_t>(header.meshletCount)
+    };
+    lods = {
+        reinterpret_cast<const MeshLod *>(base + header.lodOffset),
+        static_cast<std::size_t>(header.lodCount)
+    };
+    submeshes = {
+        reinterpret_cast<const MeshSubmesh *>(base + header.submeshOffset),
+        static_cast<std::size_t>(header.submeshCount)
+    };
+    materials = {
+        reinterpret_cast<const MeshMaterial *>(base + header.materialOffset),
+        static_cast<std::size_t>(header.materialCount)
+    };
+}
+
+void CachedMesh::write(const std::filesystem::path &path, const std::uint64_t sourceHash,
+                       const std::uint32_t cookFlags, const std::span<const Vertex> vertices,
+                       const std::span<const GLuint> indices, const std::span<const Meshlet> meshlets,
+                       const std::span<const MeshLod> lods, const std::span<const MeshSubmesh> submeshes,
+                       const std::span<const MeshMaterial> materials) {
+    MeshCacheHeader header{};
+    header.magic         = MeshCacheHeader::MAGIC;
+    header.version       = MeshCacheHeader::VERSION;
+    header.sourceHash    = sourceHash;
+    header.vertexSize    = sizeof(Vertex);
+    header.indexSize     = sizeof(GLuint);
+    header.cookFlags     = cookFlags;
+    header.vertexCount   = vertices.size();
+    header.vertexOffset  = alignUp(sizeof(MeshCacheHeader), 16);
+    header.indexCount    = indices.size();
+    header.indexOffset   = alignUp(header.vertexOffset + vertices.size_bytes(), 16);
+    header.meshletCount  = meshlets.size();
+    header.meshletOffset = alignUp(header.indexOffset + indices.size_bytes(), 16);
+    header.lodCount      = lods.size();
+    header.lodOffset     = alignUp(header.meshletOffset + meshlets.size_bytes(), 16);
+    header.submeshCount  = submeshes.size();
+    header.submeshOffset = alignUp(header.lodOffset + lods.size_bytes(), 16);
+    header.materialCount = materials.size();
+    header.materialOffset = alignUp(header.submeshOffset + submeshes.size_bytes(), 16);
+
+    const std::filesystem::path tempPath = path.string() + ".tmp";
+
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("failed to open mesh cache for writing: " + tempPath.string());
+        }
+
+        constexpr char padding[16] {};
+
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(padding, static_cast<std::streamsize>(header.vertexOffset - sizeof(header)));
+        out.write(reinterpret_cast<const char *>(vertices.data()), static_cast<std::streamsize>(vertices.size_bytes()));
+        out.write(padding, static_cast<std::streamsize>(
+                      header.indexOffset - header.vertexOffset - vertices.size_bytes()));
+        out.write(reinterpret_cast<const char *>(indices.data()), static_cast<std::streamsize>(indices.size_bytes()));
+        out.write(padding, static_cast<std::streamsize>(
+                      header.meshletOffset - header.indexOffset - indices.size_bytes()));
+        out.write(reinterpret_cast<const char *>(meshlets.data()), static_cast<std::streamsize>(meshlets.size_bytes()));
+        out.write(padding, static_cast<std::streamsize>(
+                      header.lodOffset - header.meshletOffset - meshlets.size_bytes()));
+        out.write(reinterpret_cast<const char *>(lods.data()), static_cast<std::streamsize>(lods.size_bytes()));
+        out.write(padding, static_cast<std::streamsize>(
+                      header.submeshOffset - header.lodOffset - lods.size_bytes()));
+        out.write(reinterpret_cast<const char *>(submeshes.data()),
+                  static_cast<std::streamsize>(submeshes.size_bytes()));
+        out.write(padding, static_cast<std::streamsize>(
+                      header.materialOffset - header.submeshOffset - submeshes.size_bytes()));
+        out.write(reinterpret_cast<const char *>(materials.data()),
+                  static_cast<std::streamsize>(materials.size_bytes()));
+
+        if (!out.good()) {
+            throw std::runtime_error("failed to write mesh cache: " + tempPath.string());
+        }
+    }
+
+    std::filesystem::rename(tempPath, path);
+}
+
+void CachedMesh::writeCompressed(ThreadPool &threadPool, const std::filesystem::path &path, const CachedMesh &mesh) {
+    MeshPackHeader header{};
+    header.magic   = MeshPackHeader::MAGIC;
+    header.version = MeshPackHeader::VERSION;
+    header.cache   = mesh.getHeader();
+
+    const auto sections = getSections(header.cache);
+    std::vector<std::uint8_t> packed;
+
+    for (std::size_t i = 0; i < sections.size(); i++) {
+        const std::size_t sectionStart = packed.size();
+        encodeRecords(threadPool, mesh.data.subspan(sections[i].offset, sections[i].count * sections[i].recordSize),
+                      sections[i].recordSize, packed);
+        header.sectionSizes[i] = packed.size() - sectionStart;
+    }
+
+    const std::filesystem::path tempPath = path.string() + ".tmp";
+
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("failed to open mesh cache for writing: " + tempPath.string());
+        }
+
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(packed.data()), static_cast<std::streamsize>(packed.size()));
+
+        if (!out.good()) {
+            throw std::runtime_error("failed to write mesh cache: " + tempPath.string());
+        }
+    }
+
+    std::filesystem::rename(tempPath, path);
+}
+
+std::uint64_t CachedMesh::hashSourceFile(const std::filesystem::path &path) {
+    std::ifstream source(path, std::ios::binary);
+    if (!source.is_open()) {
+        throw std::runtime_error("failed to open source asset: " + path.string());
+    }
+
+    // simple 64-bit multiply-rotate hash over 8-byte words -- we only need to notice when the file changes,
+    // and this is fast enough that it's dwarfed by simply reading the file. the file is read in blocks rather
+    // than mapped, so hashing a huge asset doesn't pull all of it into our resident memory
+    constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87ull;
+    constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+
+    std::uint64_t hash = prime1 ^ std::filesystem::file_size(path);
+    std::vector<char> block(IO_BLOCK_BYTES);
+
+    while (source) {
+        source.read(block.data(), static_cast<std::streamsize>(block.size()));
+        const auto blockSize = static_cast<std::size_t>(source.gcount());
+        std::size_t i = 0;
+
+        // blocks are a multiple of the word size, so only the very last one can have a tail
+        for (; i + sizeof(std::uint64_t) <= blockSize; i += sizeof(std::uint64_t)) {
+            std::uint64_t word;
+            std::memcpy(&word, block.data() + i, sizeof(word));
+            hash ^= word * prime2;
+            hash = ((hash << 31) | (hash >> 33)) * prime1;
+        }
+
+        for (; i < blockSize; i++) {
+            hash ^= static_cast<std::uint64_t>(static_cast<std::uint8_t>(block[i])) * prime1;
+            hash = ((hash << 11) | (hash >> 53)) * prime2;
+        }
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+
+    return hash;
+}
+
+const MeshCacheHeader &CachedMesh::getHeader() const {
+    return *reinterpret_cast<const MeshCacheHeader *>(data.data());
+}
+
+bool CachedMesh::isCompatible(const MeshCacheHeader &header, const std::optional<std::uint64_t> sourceHash,
+                              const std::uint32_t cookFlags) {
+    return header.magic == MeshCacheHeader::MAGIC
+           && header.version == MeshCacheHeader::VERSION
+           && (!sourceHash || header.sourceHash == *sourceHash)
+           && header.cookFlags == cookFlags
+           && header.vertexSize == sizeof(Vertex)
+           && header.indexSize == sizeof(GLuint);
+}
+
+bool CachedMesh::isValid(const std::uint64_t sourceHash, const std::uint32_t cookFlags) const {
+    if (data.size() < sizeof(MeshCacheHeader)) {
+        return false;
+    }
+
+    const MeshCacheHeader &header = getHeader();
+    if (!isCompatible(header, sourceHash, cookFlags)) {
+        return false;
+    }
+
+    // make sure a truncated or corrupted file doesn't send us reading past the end of the mapping
+    return std::ranges::all_of(getSections(header), [&](const MeshCacheSection &section) {
+        return section.isWithin(data.size());
+    });
+}
+
+MeshCacheStreamWriter::MeshCacheStreamWriter(const std::filesystem::path &path, const std::uint64_t sourceHash,
+                                             const std::uint32_t cookFlags)
+    : path(path), tempPath(path.string() + ".tmp"), indexSpoolPath(path.string() + ".indices.tmp") {
+    header.magic        = MeshCacheHeader::MAGIC;
+    header.version      = MeshCacheHeader::VERSION;
+    header.sourceHash   = sourceHash;
+    header.vertexSize   = sizeof(Vertex);
+    header.indexSize    = sizeof(GLuint);
+    header.cookFlags    = cookFlags;
+    header.vertexOffset = alignUp(sizeof(MeshCacheHeader), 16);
+
+    out.open(tempPath, std::ios::binary | std::ios::trunc);
+    indexSpool.open(indexSpoolPath, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+    if (!out.is_open() || !indexSpool.is_open()) {
+        throw std::runtime_error("failed to open mesh cache for writing: " + tempPath.string());
+    }
+
+    // the header is only known at the end, for now just reserve space for it
+    constexpr char padding[alignUp(sizeof(MeshCacheHeader), 16)] {};
+    out.write(padding, sizeof(padding));
+}
+
+MeshCacheStreamWriter::~MeshCacheStreamWriter() {
+    out.close();
+    indexSpool.close();
+
+    std::error_code error;
+    std::filesystem::remove(indexSpoolPath, error);
+    std::filesystem::remove(tempPath, error);
+}
+
+void MeshCacheStreamWriter::append(const std::span<const Vertex> vertices, const std::span<const GLuint> indices) {
+    out.write(reinterpret_cast<const char *>(vertices.data()), static_cast<std::streamsize>(vertices.size_bytes()));
+    indexSpool.write(reinterpret_cast<const char *>(indices.data()), static_cast<std::streamsize>(indices.size_bytes()));
+
+    if (!out.good() || !indexSpool.good()) {
+        throw std::runtime_error("failed to write mesh cache: " + tempPath.string());
+    }
+
+    header.vertexCount += vertices.size();
+    header.indexCount += indices.size();
+}
+
+void MeshCacheStreamWriter::finish() {
+    if (header.indexCount > std::numeric_limits<GLuint>::max()) {
+        throw std::runtime_error("mesh has too many indices for a single LOD: " + path.string());
+    }
+
+    header.indexOffset   = alignUp(header.vertexOffset + header.vertexCount * sizeof(Vertex), 16);
+    header.meshletCount  = 0;
+    header.meshletOffset = alignUp(header.indexOffset + header.indexCount * sizeof(GLuint), 16);
+    header.lodCount      = 1;
+    header.lodOffset     = header.meshletOffset;
+    header.submeshCount  = 1;
+    header.submeshOffset = alignUp(header.lodOffset + sizeof(MeshLod), 16);
+    header.materialCount = 1;
+    header.materialOffset = alignUp(header.submeshOffset + sizeof(MeshSubmesh), 16);
+
+    constexpr char padding[16] {};
+    out.write(padding, static_cast<std::streamsize>(
+                  header.indexOffset - header.vertexOffset - header.vertexCount * sizeof(Vertex)));
+
+    // copy the spooled indices over in blocks, so they're never all in memory at once
+    indexSpool.seekg(0);
+    std::vector<char> block(IO_BLOCK_BYTES);
+
+    while (indexSpool) {
+        indexSpool.read(block.data(), static_cast<std::streamsize>(block.size()));
+        out.write(block.data(), indexSpool.gcount());
+    }
+
+    out.write(padding, static_cast<std::streamsize>(
+                  header.meshletOffset - header.indexOffset - header.indexCount * sizeof(GLuint)));
+
+    const MeshLod lod{0, static_cast<GLuint>(header.indexCount), 0.0f, 0, 1};
+    out.write(reinterpret_cast<const char *>(&lod), sizeof(lod));
+    out.write(padding, static_cast<std::streamsize>(header.submeshOffset - header.lodOffset - sizeof(lod)));
+
+    const MeshSubmesh submesh{0, 0, static_cast<GLuint>(header.indexCount), 0, 0};
+    out.write(reinterpret_cast<const char *>(&submesh), sizeof(submesh));
+    out.write(padding, static_cast<std::streamsize>(
+                  header.materialOffset - header.submeshOffset - sizeof(submesh)));
+
+    const MeshMaterial material{glm::vec3(1.0f), {}, {}};
+    out.write(reinterpret_cast<const char *>(&material), sizeof(material));
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.close();
+
+    if (!out.good()) {
+        throw std::runtime_error("failed to write mesh cache: " + tempPath.string());
+    }
+
+    std::filesystem::rename(tempPath, path);
+}
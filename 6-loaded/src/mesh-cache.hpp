@@ -0,0 +1,241 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <span>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "utilities/mapped-file.hpp"
+#include "utilities/thread-pool.hpp"
+#include "meshlet.hpp"
+#include "vertex.hpp"
+
+/**
+ * Optional steps of the cooking pipeline. They're recorded in the cache, so changing them triggers a recook.
+ */
+enum MeshCookFlags : std::uint32_t {
+    MESH_COOK_OPTIMIZE_OVERDRAW = 1 << 0,
+    // the mesh was streamed straight into the cache, skipping all optimizations, meshlets, coarser LODs and
+    // tangent frames -- its vertices have zero normals and tangents
+    MESH_COOK_STREAMED = 1 << 1,
+};
+
+/**
+ * Material of a cooked mesh.
+ */
+struct MeshMaterial {
+    static constexpr std::size_t MAX_TEXTURE_PATH_LENGTH = 249;
+
+    // texture paths are null-terminated, and empty if the material has no such texture
+    glm::vec3 diffuseColor;
+    char diffuseTexture[MAX_TEXTURE_PATH_LENGTH + 1];
+    char normalTexture[MAX_TEXTURE_PATH_LENGTH + 1];
+};
+
+/**
+ * Part of a LOD of a cooked mesh which uses a single material -- a range of its index buffer and, in the
+ * full-detail LOD, the range of meshlets covering it.
+ */
+struct MeshSubmesh {
+    GLuint materialIndex;
+    GLuint firstIndex;
+    GLuint indexCount;
+    GLuint firstMeshlet;
+    GLuint meshletCount;
+};
+
+/**
+ * A level of detail of a cooked mesh -- a range of its index buffer, drawn with the mesh's shared vertex buffer.
+ * The range is split into the LOD's submeshes, which are sorted by material.
+ */
+struct MeshLod {
+    GLuint firstIndex;
+    GLuint indexCount;
+    float error; // approximate geometric deviation from the full-detail mesh, in object-space units
+    GLuint firstSubmesh;
+    GLuint submeshCount;
+};
+
+/**
+ * Header of a cooked mesh file. The header is followed by the raw `Vertex` array, the raw index array, the raw
+ * `Meshlet` array, the raw `MeshLod` array, the raw `MeshSubmesh` array and the raw `MeshMaterial` array, all stored
+ * exactly as they're laid out in memory, so a mapped file can be handed straight to `glBufferData`.
+ *
+ * The index array holds all the LODs one after another, starting with the full-detail mesh. Meshlets only cover
+ * the full-detail mesh.
+ */
+struct MeshCacheHeader {
+    static constexpr std::uint32_t MAGIC = 0x4853454D; // "MESH" in little-endian
+    // bump this whenever either the format or the cooking pipeline changes, so old caches get recooked
+    static constexpr std::uint32_t VERSION = 7;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t sourceHash;  // hash of the source file's contents, used to detect stale caches
+    std::uint32_t vertexSize;  // sizeof(Vertex) at the time of writing, guards against layout changes
+    std::uint32_t indexSize;   // sizeof(GLuint) at the time of writing
+    std::uint32_t cookFlags;   // combination of `MeshCookFlags` the mesh was cooked with
+    std::uint32_t reserved;
+    std::uint64_t vertexCount;
+    std::uint64_t vertexOffset; // in bytes, from the start of the file
+    std::uint64_t indexCount;
+    std::uint64_t indexOffset;  // in bytes, from the start of the file
+    std::uint64_t meshletCount;
+    std::uint64_t meshletOffset; // in bytes, from the start of the file
+    std::uint64_t lodCount;
+    std::uint64_t lodOffset;     // in bytes, from the start of the file
+    std::uint64_t submeshCount;
+    std::uint64_t submeshOffset; // in bytes, from the start of the file
+    std::uint64_t materialCount;
+    std::uint64_t materialOffset; // in bytes, from the start of the file
+};
+
+/**
+ * Header of a compressed cooked mesh file, written by `CachedMesh::writeCompressed`. It's followed by the arrays of
+ * a cache file, in the same order, each compressed with `encodeRecords`. Decoding them into place behind a copy of
+ * `cache` recreates the cache file exactly, apart from the padding between the arrays.
+ */
+struct MeshPackHeader {
+    static constexpr std::uint32_t MAGIC = 0x4B43504D; // "MPCK" in little-endian
+    // bump this whenever the compressed format changes. changes to the cooked data itself bump the cache's version
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr std::size_t SECTION_COUNT = 6;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    MeshCacheHeader cache;
+    std::uint64_t sectionSizes[SECTION_COUNT]; // compressed sizes of the arrays, in bytes
+};
+
+/**
+ * A cooked mesh, either memory-mapped from a cache file written by `CachedMesh::write`, or decoded from a
+ * compressed one written by `CachedMesh::writeCompressed`.
+ */
+class CachedMesh {
+    // contents of the cache file -- either the mapped file itself, or the buffer it was decoded into
+    std::optional<MappedFile> file;
+    std::unique_ptr<std::byte[]> decodedData;
+    std::span<const std::byte> data;
+
+    std::span<const Vertex> vertices;
+    std::span<const GLuint> indices;
+    std::span<const Meshlet> meshlets;
+    std::span<const MeshLod> lods;
+    std::span<const MeshSubmesh> submeshes;
+    std::span<const MeshMaterial> materials;
+
+    CachedMesh() = default;
+
+public:
+    /**
+     * Maps the cache file at the given path, if it exists and was cooked from a source file with the given hash
+     * using the given cook flags. Returns nullptr if the cache is missing, stale or was written by an incompatible version.
+     */
+    static std::unique_ptr<CachedMesh> open(const std::filesystem::path &path, std::uint64_t sourceHash,
+                                            std::uint32_t cookFlags);
+
+    /**
+     * Writes a cache file containing the given mesh data. The file is written to a temporary path first
+     * and then renamed, so a crash mid-write never leaves a corrupted cache behind.
+     */
+    static void write(const std::filesystem::path &path, std::uint64_t sourceHash, std::uint32_t cookFlags,
+                      std::span<const Vertex> vertices, std::span<const GLuint> indices,
+                      std::span<const Meshlet> meshlets, std::span<const MeshLod> lods,
+                      std::span<const MeshSubmesh> submeshes, std::span<const MeshMaterial> materials);
+
+    /**
+     * Decodes the compressed cache file at the given path, if it exists and was cooked from a source file with
+     * the given hash using the given cook flags, spreading the work over the thread pool. Without a hash, a file
+     * cooked from any version of the source is accepted. Returns nullptr if the file is missing, stale or was
+     * written by an incompatible version.
+     */
+    static std::unique_ptr<CachedMesh> openCompressed(ThreadPool &threadPool, const std::filesystem::path &path,
+                                                      std::optional<std::uint64_t> sourceHash,
+                                                      std::uint32_t cookFlags);
+
+    /**
+     * Writes a compressed cache file containing the given mesh, which is a fraction of the size of the plain one.
+     * Like `write`, goes through a temporary file.
+     */
+    static void writeCompressed(ThreadPool &threadPool, const std::filesystem::path &path, const CachedMesh &mesh);
+
+    /**
+     * Hashes the contents of a source asset file, for cache invalidation purposes.
+     */
+    static std::uint64_t hashSourceFile(const std::filesystem::path &path);
+
+    std::span<const Vertex> getVertices() const { return vertices; }
+
+    std::span<const GLuint> getIndices() const { return indices; }
+
+    std::span<const Meshlet> getMeshlets() const { return meshlets; }
+
+    std::span<const MeshLod> getLods() const { return lods; }
+
+    std::span<const MeshSubmesh> getSubmeshes() const { return submeshes; }
+
+    std::span<const MeshMaterial> getMaterials() const { return materials; }
+
+    std::uint32_t getCookFlags() const { return getHeader().cookFlags; }
+
+    /**
+     * Size of the cache file this mesh was read from, or decoded into.
+     */
+    std::size_t getSizeBytes() const { return data.size(); }
+
+private:
+    const MeshCacheHeader &getHeader() const;
+
+    static bool isCompatible(const MeshCacheHeader &header, std::optional<std::uint64_t> sourceHash,
+                             std::uint32_t cookFlags);
+
+    bool isValid(std::uint64_t sourceHash, std::uint32_t cookFlags) const;
+
+    void mapArrays();
+};
+
+/**
+ * Writes a cache file incrementally, for meshes too large to be held in memory while cooking. Vertices are written
+ * straight into the cache, while indices are spooled into a separate temporary file and appended after the last
+ * vertex. The resulting mesh has no meshlets and a single LOD covering all indices, drawn with a single plain white
+ * material.
+ */
+class MeshCacheStreamWriter {
+    std::filesystem::path path;
+    std::filesystem::path tempPath;
+    std::filesystem::path indexSpoolPath;
+    std::ofstream out;
+    std::fstream indexSpool;
+    MeshCacheHeader header{};
+
+public:
+    MeshCacheStreamWriter(const std::filesystem::path &path, std::uint64_t sourceHash, std::uint32_t cookFlags);
+
+    ~MeshCacheStreamWriter();
+
+    MeshCacheStreamWriter(const MeshCacheStreamWriter &other) = delete;
+
+    MeshCacheStreamWriter &operator=(const MeshCacheStreamWriter &other) = delete;
+
+    /**
+     * Appends vertices and indices to the mesh. Indices refer to all vertices appended so far.
+     */
+    void append(std::span<const Vertex> vertices, std::span<const GLuint> indices);
+
+    /**
+     * Completes the cache file and moves it into place. Nothing is left behind if this isn't called.
+     */
+    void finish();
+
+    [[nodiscard]] std::uint64_t getVertexCount() const { return header.vertexCount; }
+
+    [[nodiscard]] std::uint64_t getIndexCount() const { return header.indexCount; }
+};
+
+#endif //MESH_CACHE_HPP
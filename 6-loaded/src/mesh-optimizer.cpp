@@ -0,0 +1,437 @@
+#include "mesh-optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+// tuning constants straight from Forsyth's article
+static constexpr std::size_t FORSYTH_CACHE_SIZE = 32;
+static constexpr float CACHE_DECAY_POWER = 1.5f;
+static constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+static constexpr float VALENCE_BOOST_SCALE = 2.0f;
+static constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+// cache size used when measuring ACMR for overdraw clustering, same as in `analyzeVertexCache`
+static constexpr std::size_t FIFO_CACHE_SIZE = 16;
+
+// overdraw clusters are never split below this size, so there's a reasonable amount of geometry to sort
+static constexpr std::size_t MIN_CLUSTER_TRIANGLES = 16;
+
+static constexpr GLuint NO_VERTEX = std::numeric_limits<GLuint>::max();
+static constexpr std::size_t NO_TRIANGLE = std::numeric_limits<std::size_t>::max();
+
+/**
+ * Score of a vertex, given its position in the simulated LRU cache (-1 if it's not in it) and the number
+ * of not yet emitted triangles using it. Triangles with a high total score of their vertices are emitted first.
+ */
+static float getVertexScore(const int cachePosition, const std::size_t remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.0f; // the vertex isn't used by anything anymore
+    }
+
+    float score = 0.0f;
+
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // the vertices of the last emitted triangle get a fixed score, so the algorithm doesn't
+            // prefer to simply reuse the last edge over and over
+            score = LAST_TRIANGLE_SCORE;
+        } else {
+            constexpr float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+
+    // boost vertices with few triangles left, so lone triangles don't get left behind
+    score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+
+    return score;
+}
+
+/**
+ * Incrementally simulated FIFO vertex cache. With a FIFO cache, a vertex stays cached for exactly
+ * `cacheSize` misses after being loaded, so it's enough to remember when each vertex was loaded.
+ */
+class FifoCacheSimulator {
+    static constexpr std::size_t NEVER = std::numeric_limits<std::size_t>::max();
+
+    std::vector<std::size_t> loadTimestamps;
+    std::size_t cacheSize;
+    std::size_t misses = 0;
+
+public:
+    FifoCacheSimulator(const std::size_t vertexCount, const std::size_t size)
+        : loadTimestamps(vertexCount, NEVER), cacheSize(size) {}
+
+    std::size_t getMisses() const { return misses; }
+
+    /**
+     * Simulates a single vertex being fetched. Returns 1 if it missed the cache, 0 otherwise.
+     */
+    std::size_t fetch(const GLuint vertex) {
+        if (loadTimestamps[vertex] == NEVER || misses - loadTimestamps[vertex] >= cacheSize) {
+            loadTimestamps[vertex] = misses++;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    std::size_t fetchTriangle(const GLuint *triangle) {
+        return fetch(triangle[0]) + fetch(triangle[1]) + fetch(triangle[2]);
+    }
+
+    /**
+     * Empties the cache. Starting over with a new timestamp range is cheaper than resetting every vertex.
+     */
+    void flush() {
+        misses += cacheSize;
+    }
+};
+
+VertexCacheStats analyzeVertexCache(const std::span<const GLuint> indices, const std::size_t vertexCount,
+                                    const std::size_t cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty()) {
+        return stats;
+    }
+
+    FifoCacheSimulator cache(vertexCount, cacheSize);
+    for (const GLuint index : indices) {
+        cache.fetch(index);
+    }
+
+    stats.transformedVertices = cache.getMisses();
+
+    stats.acmr = static_cast<float>(stats.transformedVertices) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(stats.transformedVertices) / static_cast<float>(vertexCount);
+
+    return stats;
+}
+
+void optimizeVertexCache(const std::span<GLuint> indices, const std::size_t vertexCount) {
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // vertex -> triangles adjacency, in compressed form. each vertex's live triangles are kept at the front
+    // of its range, so removing an emitted triangle is a swap with the last live one
+    std::vector<std::size_t> remainingTriangles(vertexCount, 0);
+    for (const GLuint index : indices) {
+        remainingTriangles[index]++;
+    }
+
+    std::vector<std::size_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (std::size_t v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+    }
+
+    std::vector<std::size_t> adjacency(indices.size());
+    {
+        std::vector<std::size_t> cursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (std::size_t i = 0; i < indices.size(); i++) {
+            adjacency[cursors[indices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (std::size_t v = 0; v < vertexCount; v++) {
+        vertexScores[v] = getVertexScore(-1, remainingTriangles[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> isEmitted(triangleCount, false);
+
+    std::size_t bestTriangle = 0;
+    for (std::size_t t = 0; t < triangleCount; t++) {
+        triangleScores[t] = vertexScores[indices[3 * t]]
+                            + vertexScores[indices[3 * t + 1]]
+                            + vertexScores[indices[3 * t + 2]];
+
+        if (triangleScores[t] > triangleScores[bestTriangle]) {
+            bestTriangle = t;
+        }
+    }
+
+    // the cache is allowed to temporarily overflow by up to 3 vertices, so we know which ones just got evicted
+    std::vector<GLuint> cache, newCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    std::vector<GLuint> output;
+    output.reserve(indices.size());
+
+    std::size_t inputCursor = 0;
+
+    for (std::size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        if (bestTriangle == NO_TRIANGLE) {
+            // nothing in the cache is connected to any remaining triangle -- just continue from the next
+            // unemitted triangle in input order. the cursor only moves forward, so this is linear overall
+            while (isEmitted[inputCursor]) inputCursor++;
+            bestTriangle = inputCursor;
+        }
+
+        const GLuint *triangle = &indices[3 * bestTriangle];
+        output.insert(output.end(), triangle, triangle + 3);
+        isEmitted[bestTriangle] = true;
+
+        // move the triangle's vertices to the front of the cache
+        newCache.assign(triangle, triangle + 3);
+        for (const GLuint v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                newCache.push_back(v);
+            }
+        }
+
+        for (int k = 0; k < 3; k++) {
+            const GLuint v = triangle[k];
+            const auto first = adjacency.begin() + static_cast<std::ptrdiff_t>(adjacencyOffsets[v]);
+            const auto last = first + static_cast<std::ptrdiff_t>(remainingTriangles[v]) - 1;
+            std::iter_swap(std::find(first, last + 1, bestTriangle), last);
+            remainingTriangles[v]--;
+        }
+
+        // update scores of the vertices that are in the cache or just left it
+        for (std::size_t i = 0; i < newCache.size(); i++) {
+            const GLuint v = newCache[i];
+            cachePositions[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertexScores[v] = getVertexScore(cachePositions[v], remainingTriangles[v]);
+        }
+
+        // and of the triangles using them, picking the best one along the way
+        bestTriangle = NO_TRIANGLE;
+        float bestScore = -std::numeric_limits<float>::infinity();
+
+        for (const GLuint v : newCache) {
+            const std::size_t begin = adjacencyOffsets[v];
+            const std::size_t end = begin + remainingTriangles[v];
+
+            for (std::size_t i = begin; i < end; i++) {
+                const std::size_t t = adjacency[i];
+                triangleScores[t] = vertexScores[indices[3 * t]]
+                                    + vertexScores[indices[3 * t + 1]]
+                                    + vertexScores[indices[3 * t + 2]];
+
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        if (newCache.size() > FORSYTH_CACHE_SIZE) {
+            newCache.resize(FORSYTH_CACHE_SIZE);
+        }
+
+        std::swap(cache, newCache);
+    }
+
+    std::ranges::copy(output, indices.begin());
+}
+
+void optimizeOverdraw(const std::span<GLuint> indices, const std::span<const Vertex> vertices, const float threshold) {
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // hard boundaries -- triangles where all three vertices miss the cache. the cache is effectively
+    // empty at these points, so cutting the index buffer there doesn't change the number of misses.
+    // the first triangle always starts a cluster, even if it misses fewer vertices (e.g. a degenerate one),
+    // so that every triangle ends up in some cluster
+    std::vector<std::size_t> hardBoundaries = {0};
+    {
+        FifoCacheSimulator cache(vertices.size(), FIFO_CACHE_SIZE);
+        cache.fetchTriangle(&indices[0]);
+
+        for (std::size_t t = 1; t < triangleCount; t++) {
+            if (cache.fetchTriangle(&indices[3 * t]) == 3) {
+                hardBoundaries.push_back(t);
+            }
+        }
+    }
+    hardBoundaries.push_back(triangleCount);
+
+    // soft boundaries -- hard clusters are further split wherever the part since the last split, simulated
+    // with an empty cache, still has an ACMR within the threshold of the whole hard cluster's ACMR
+    std::vector<std::size_t> clusterStarts;
+    {
+        FifoCacheSimulator cache(vertices.size(), FIFO_CACHE_SIZE);
+
+        for (std::size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+            const std::size_t hardStart = hardBoundaries[h];
+            const std::size_t hardEnd = hardBoundaries[h + 1];
+
+            cache.flush();
+            std::size_t hardMisses = 0;
+            for (std::size_t t = hardStart; t < hardEnd; t++) {
+                hardMisses += cache.fetchTriangle(&indices[3 * t]);
+            }
+            const float maxAcmr = threshold * static_cast<float>(hardMisses) / static_cast<float>(hardEnd - hardStart);
+
+            cache.flush();
+            clusterStarts.push_back(hardStart);
+            std::size_t softStart = hardStart;
+            std::size_t softMisses = 0;
+
+            for (std::size_t t = hardStart; t < hardEnd; t++) {
+                softMisses += cache.fetchTriangle(&indices[3 * t]);
+
+                const std::size_t softTriangles = t + 1 - softStart;
+                const bool isLargeEnough = softTriangles >= MIN_CLUSTER_TRIANGLES
+                                           && hardEnd - (t + 1) >= MIN_CLUSTER_TRIANGLES;
+
+                if (isLargeEnough && static_cast<float>(softMisses) <= maxAcmr * static_cast<float>(softTriangles)) {
+                    cache.flush();
+                    softStart = t + 1;
+                    softMisses = 0;
+                    clusterStarts.push_back(softStart);
+                }
+            }
+        }
+    }
+    clusterStarts.push_back(triangleCount);
+
+    const std::size_t clusterCount = clusterStarts.size() - 1;
+
+    // area-weighted centroids and normals of clusters, and of the whole mesh
+    std::vector<glm::vec3> clusterCentroids(clusterCount);
+    std::vector<glm::vec3> clusterNormals(clusterCount);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (std::size_t c = 0; c < clusterCount; c++) {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+
+        for (std::size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+            const glm::vec3 &p0 = vertices[indices[3 * t]].position;
+            const glm::vec3 &p1 = vertices[indices[3 * t + 1]].position;
+            const glm::vec3 &p2 = vertices[indices[3 * t + 2]].position;
+
+            const glm::vec3 weightedNormal = glm::cross(p1 - p0, p2 - p0); // its length is twice the area
+            const float triangleArea = glm::length(weightedNormal);
+
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += weightedNormal;
+            area += triangleArea;
+        }
+
+        meshCentroid += centroid;
+        meshArea += area;
+
+        clusterCentroids[c] = area > 0.0f ? centroid / area : centroid;
+        clusterNormals[c] = glm::length(normal) > 0.0f ? glm::normalize(normal) : normal;
+    }
+
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    // clusters on the outside of the mesh, facing away from its center, go first
+    std::vector<float> occlusionPotentials(clusterCount);
+    for (std::size_t c = 0; c < clusterCount; c++) {
+        occlusionPotentials[c] = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]);
+    }
+
+    std::vector<std::size_t> clusterOrder(clusterCount);
+    for (std::size_t c = 0; c < clusterCount; c++) {
+        clusterOrder[c] = c;
+    }
+
+    std::ranges::stable_sort(clusterOrder, [&](const std::size_t a, const std::size_t b) {
+        return occlusionPotentials[a] > occlusionPotentials[b];
+    });
+
+    std::vector<GLuint> output;
+    output.reserve(indices.size());
+
+    for (const std::size_t c : clusterOrder) {
+        output.insert(output.end(), indices.begin() + 3 * clusterStarts[c], indices.begin() + 3 * clusterStarts[c + 1]);
+    }
+
+    // clusters have to cover every triangle exactly once, or the copy would drop some and leave others duplicated
+    if (output.size() != indices.size()) {
+        throw std::runtime_error("overdraw optimization lost track of some triangles");
+    }
+
+    std::ranges::copy(output, indices.begin());
+}
+
+void optimizeVertexFetch(std::vector<Vertex> &vertices, const std::span<GLuint> indices) {
+    std::vector<GLuint> remap(vertices.size(), NO_VERTEX);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (GLuint &index : indices) {
+        if (remap[index] == NO_VERTEX) {
+            remap[index] = static_cast<GLuint>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    vertices = std::move(reordered);
+}
+
+std::vector<GLuint> getPositionIds(const std::span<const Vertex> vertices, std::size_t &positionCount) {
+    std::vector<GLuint> order(vertices.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    const auto isLess = [&](const GLuint a, const GLuint b) {
+        const glm::vec3 &pa = vertices[a].position;
+        const glm::vec3 &pb = vertices[b].position;
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        return pa.z < pb.z;
+    };
+
+    std::ranges::sort(order, isLess);
+
+    std::vector<GLuint> positionIds(vertices.size());
+    positionCount = 0;
+
+    for (std::size_t i = 0; i < order.size(); i++) {
+        if (i > 0 && isLess(order[i - 1], order[i])) {
+            positionCount++;
+        }
+        positionIds[order[i]] = static_cast<GLuint>(positionCount);
+    }
+
+    if (!order.empty()) {
+        positionCount++;
+    }
+
+    return positionIds;
+}
+
+void SubmeshVertices::compact(const std::span<GLuint> indices, const std::span<const Vertex> vertices) {
+    // only the entries set by the previous part need resetting, which keeps this proportional to the part's size
+    for (const GLuint globalId : globalIds) {
+        localIds[globalId] = NO_LOCAL_ID;
+    }
+
+    globalIds.clear();
+    localVertices.clear();
+
+    for (GLuint &index : indices) {
+        if (localIds[index] == NO_LOCAL_ID) {
+            localIds[index] = static_cast<GLuint>(globalIds.size());
+            globalIds.push_back(index);
+            localVertices.push_back(vertices[index]);
+        }
+
+        index = localIds[index];
+    }
+}
+
+void SubmeshVertices::expand(const std::span<GLuint> indices) const {
+    for (GLuint &index : indices) {
+        index = globalIds[index];
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "vertex.hpp"
+
+/**
+ * Statistics of how well an index buffer makes use of the GPU's post-transform vertex cache.
+ */
+struct VertexCacheStats {
+    std::size_t transformedVertices = 0;
+
+    // average cache miss ratio -- vertex shader invocations per triangle. 0.5 is the theoretical optimum,
+    // 3.0 means no reuse at all
+    float acmr = 0.0f;
+
+    // average transform to vertex ratio -- vertex shader invocations per unique vertex. 1.0 is optimal
+    float atvr = 0.0f;
+};
+
+/**
+ * Simulates a FIFO post-transform cache of the given size (which is roughly how most hardware behaves)
+ * running over the given triangle list.
+ */
+VertexCacheStats analyzeVertexCache(std::span<const GLuint> indices, std::size_t vertexCount,
+                                    std::size_t cacheSize = 16);
+
+/**
+ * Reorders triangles to improve post-transform vertex cache utilization, using Tom Forsyth's
+ * "Linear-Speed Vertex Cache Optimisation" algorithm. Works in place, only the order of triangles changes.
+ */
+void optimizeVertexCache(std::span<GLuint> indices, std::size_t vertexCount);
+
+/**
+ * Reorders triangles to reduce overdraw, while mostly preserving vertex cache efficiency. Should be run after
+ * `optimizeVertexCache`. Based on the "Tipsify" paper by Sander, Nehab and Barczak.
+ *
+ * The index buffer is cut into clusters at points where the vertex cache is effectively flushed anyway, so
+ * reordering whole clusters doesn't cost much cache efficiency. Clusters are then sorted by a view-independent
+ * estimate of how likely they are to occlude the rest of the mesh -- clusters facing away from the mesh's center
+ * are on its outside, so drawing them first lets early depth testing reject more of the inner geometry.
+ *
+ * `threshold` limits how much worse the ACMR is allowed to get -- e.g. 1.05 allows a 5% increase.
+ */
+void optimizeOverdraw(std::span<GLuint> indices, std::span<const Vertex> vertices, float threshold = 1.05f);
+
+/**
+ * Renumbers vertices in the order in which they're first referenced by the index buffer, so that
+ * vertex fetches walk through memory mostly linearly. Vertices not referenced at all are dropped.
+ */
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::span<GLuint> indices);
+
+/**
+ * Gives every vertex the id of its position, so vertices differing only in other attributes (e.g. on texture seams)
+ * share an id. Ids are dense, `positionCount` receives their number.
+ */
+std::vector<GLuint> getPositionIds(std::span<const Vertex> vertices, std::size_t &positionCount);
+
+/**
+ * Gives a part of a mesh (e.g. a submesh) its own compact array of just the vertices it references, so that
+ * processing the part takes time proportional to its size rather than the size of the whole mesh.
+ * Meant to be reused for all the parts of one mesh.
+ */
+class SubmeshVertices {
+    static constexpr GLuint NO_LOCAL_ID = ~GLuint{0};
+
+    std::vector<GLuint> localIds;
+    std::vector<GLuint> globalIds;
+    std::vector<Vertex> localVertices;
+
+public:
+    explicit SubmeshVertices(std::size_t vertexCount) : localIds(vertexCount, NO_LOCAL_ID) {}
+
+    /**
+     * Collects the vertices referenced by the given part of the mesh, rewriting its indices to point into
+     * `getVertices()`. Replaces the previously compacted part.
+     */
+    void compact(std::span<GLuint> indices, std::span<const Vertex> vertices);
+
+    /**
+     * Rewrites indices pointing into `getVertices()` back into indices of the whole mesh.
+     */
+    void expand(std::span<GLuint> indices) const;
+
+    [[nodiscard]] std::span<const Vertex> getVertices() const { return localVertices; }
+};
+
+#endif //MESH_OPTIMIZER_HPP
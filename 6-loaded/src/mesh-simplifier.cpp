@@ -0,0 +1,460 @@
+#include "mesh-simplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+#include "mesh-optimizer.hpp"
+
+static constexpr GLuint NO_VERTEX = std::numeric_limits<GLuint>::max();
+
+// how strongly borders are kept in place, relative to the surface itself
+static constexpr double BORDER_WEIGHT = 10.0;
+
+/**
+ * Sum of squared distances to a set of planes, each weighted by the area of the triangle it came from.
+ * Stored as the upper triangle of the symmetric 4x4 matrix from Garland & Heckbert's paper.
+ */
+struct Quadric {
+    double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+    double b2 = 0.0, bc = 0.0, bd = 0.0;
+    double c2 = 0.0, cd = 0.0;
+    double d2 = 0.0;
+    double weight = 0.0;
+
+    static Quadric fromPlane(const glm::dvec3 &normal, const glm::dvec3 &point, const double weight) {
+        const double d = -glm::dot(normal, point);
+
+        Quadric quadric;
+        quadric.a2 = weight * normal.x * normal.x;
+        quadric.ab = weight * normal.x * normal.y;
+        quadric.ac = weight * normal.x * normal.z;
+        quadric.ad = weight * normal.x * d;
+        quadric.b2 = weight * normal.y * normal.y;
+        quadric.bc = weight * normal.y * normal.z;
+        quadric.bd = weight * normal.y * d;
+        quadric.c2 = weight * normal.z * normal.z;
+        quadric.cd = weight * normal.z * d;
+        quadric.d2 = weight * d * d;
+        quadric.weight = weight;
+        return quadric;
+    }
+
+    static Quadric fromTriangle(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2) {
+        const glm::dvec3 normal = glm::cross(glm::dvec3(p1 - p0), glm::dvec3(p2 - p0));
+        const double area = glm::length(normal); // twice the actual area, but only the ratios matter
+
+        return area > 0.0 ? fromPlane(normal / area, glm::dvec3(p0), area) : Quadric{};
+    }
+
+    /**
+     * Quadric of the plane perpendicular to a triangle, going through its edge from `p0` to `p1`.
+     * Keeps vertices on open borders from sliding away from the border.
+     */
+    static Quadric fromBorderEdge(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2) {
+        const glm::dvec3 edge = glm::dvec3(p1 - p0);
+        const glm::dvec3 normal = glm::cross(edge, glm::cross(edge, glm::dvec3(p2 - p0)));
+        const double length = glm::length(normal);
+        const double edgeLengthSquared = glm::dot(edge, edge);
+
+        return length > 0.0
+                   ? fromPlane(normal / length, glm::dvec3(p0), BORDER_WEIGHT * edgeLengthSquared)
+                   : Quadric{};
+    }
+
+    Quadric &operator+=(const Quadric &other) {
+        a2 += other.a2;
+        ab += other.ab;
+        ac += other.ac;
+        ad += other.ad;
+        b2 += other.b2;
+        bc += other.bc;
+        bd += other.bd;
+        c2 += other.c2;
+        cd += other.cd;
+        d2 += other.d2;
+        weight += other.weight;
+        return *this;
+    }
+
+    /**
+     * Squared distance of the point from the planes, averaged over them.
+     */
+    [[nodiscard]] double getError(const glm::vec3 &point) const {
+        const double x = point.x, y = point.y, z = point.z;
+
+        const double error = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+                             + b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+                             + c2 * z * z + 2.0 * cd * z
+                             + d2;
+
+        // the sum can dip slightly below zero due to rounding
+        return weight > 0.0 ? std::max(error, 0.0) / weight : 0.0;
+    }
+};
+
+enum class VertexKind : std::uint8_t {
+    MANIFOLD, // the only vertex at its position, surrounded by triangles -- can be collapsed anywhere
+    SEAM,     // one of two vertices at a position on a texture seam -- can only be collapsed along the seam
+    BORDER,   // the only vertex at its position, on an open border -- can only be collapsed along the border
+    LOCKED,   // where seams or borders meet, or on non-manifold geometry -- never collapsed
+};
+
+/**
+ * An edge between two positions, as seen by the first two triangles using it.
+ */
+struct EdgeInfo {
+    std::uint32_t triangleCount = 0;
+
+    // ids of the vertices at the edge's ends, as used by each of the two triangles, ordered by position id.
+    // if the two triangles use different vertices, the edge lies on a seam
+    GLuint vertices[2][2] {};
+
+    [[nodiscard]] bool isBorder() const {
+        return triangleCount == 1;
+    }
+
+    [[nodiscard]] bool isSeam() const {
+        return triangleCount == 2 && (vertices[0][0] != vertices[1][0] || vertices[0][1] != vertices[1][1]);
+    }
+};
+
+/**
+ * Collapse of vertex `from` onto vertex `to`. Collapses along a seam move the vertex on the other side
+ * of the seam too.
+ */
+struct Collapse {
+    GLuint from;
+    GLuint to;
+    GLuint twinFrom;
+    GLuint twinTo;
+    double cost;
+};
+
+static std::uint64_t getEdgeKey(const GLuint positionA, const GLuint positionB) {
+    const GLuint low = std::min(positionA, positionB);
+    const GLuint high = std::max(positionA, positionB);
+    return static_cast<std::uint64_t>(low) << 32 | high;
+}
+
+static void collectEdges(const std::span<const GLuint> indices, const std::span<const GLuint> positionIds,
+                         std::unordered_map<std::uint64_t, EdgeInfo> &edges) {
+    edges.clear();
+
+    for (std::size_t i = 0; i < indices.size(); i++) {
+        const GLuint a = indices[i];
+        const GLuint b = indices[i - i % 3 + (i + 1) % 3];
+        const bool isSwapped = positionIds[a] > positionIds[b];
+
+        EdgeInfo &edge = edges[getEdgeKey(positionIds[a], positionIds[b])];
+        if (edge.triangleCount < 2) {
+            edge.vertices[edge.triangleCount][0] = isSwapped ? b : a;
+            edge.vertices[edge.triangleCount][1] = isSwapped ? a : b;
+        }
+        edge.triangleCount++;
+    }
+}
+
+/**
+ * Checks whether moving the vertices at position `from` to `newPosition` would flip (or nearly flip) any triangle
+ * around it which doesn't degenerate in the process, i.e. which doesn't also touch position `to`.
+ */
+static bool wouldFlipTriangles(const std::span<const std::size_t> triangles, const std::span<const GLuint> indices,
+                               const std::span<const Vertex> vertices, const std::span<const GLuint> positionIds,
+                               const GLuint from, const GLuint to, const glm::vec3 &newPosition) {
+    for (const std::size_t triangle : triangles) {
+        glm::vec3 corners[3], movedCorners[3];
+        bool isCollapsing = false;
+
+        for (std::size_t k = 0; k < 3; k++) {
+            const GLuint vertex = indices[3 * triangle + k];
+            isCollapsing |= positionIds[vertex] == to;
+            corners[k] = vertices[vertex].position;
+            movedCorners[k] = positionIds[vertex] == from ? newPosition : corners[k];
+        }
+
+        if (isCollapsing) {
+            continue;
+        }
+
+        const glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+        const glm::vec3 movedNormal = glm::cross(movedCorners[1] - movedCorners[0], movedCorners[2] - movedCorners[0]);
+
+        if (glm::dot(normal, movedNormal) <= 1e-2f * glm::length(normal) * glm::length(movedNormal)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::vector<GLuint> simplifyMesh(const std::span<const GLuint> indices, const std::span<const Vertex> vertices,
+                                 const std::size_t targetIndexCount, float &error) {
+    std::size_t positionCount;
+    const std::vector<GLuint> positionIds = getPositionIds(vertices, positionCount);
+
+    // quadrics are kept per position, so both sides of a seam agree on the error of moving it
+    std::vector<Quadric> quadrics(positionCount);
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const Quadric quadric = Quadric::fromTriangle(
+            vertices[indices[i]].position, vertices[indices[i + 1]].position, vertices[indices[i + 2]].position);
+
+        for (std::size_t k = 0; k < 3; k++) {
+            quadrics[positionIds[indices[i + k]]] += quadric;
+        }
+    }
+
+    std::unordered_map<std::uint64_t, EdgeInfo> edges;
+    collectEdges(indices, positionIds, edges);
+
+    for (std::size_t i = 0; i < indices.size(); i++) {
+        const GLuint a = indices[i];
+        const GLuint b = indices[i - i % 3 + (i + 1) % 3];
+        const GLuint c = indices[i - i % 3 + (i + 2) % 3];
+
+        if (edges.at(getEdgeKey(positionIds[a], positionIds[b])).isBorder()) {
+            const Quadric quadric = Quadric::fromBorderEdge(
+                vertices[a].position, vertices[b].position, vertices[c].position);
+            quadrics[positionIds[a]] += quadric;
+            quadrics[positionIds[b]] += quadric;
+        }
+    }
+
+    std::vector<GLuint> current(indices.begin(), indices.end());
+    double maxError = 0.0;
+
+    std::vector<VertexKind> kinds(vertices.size());
+    std::vector<GLuint> twins(vertices.size());
+    std::vector<bool> isVertexUsed(vertices.size());
+    std::vector<GLuint> remap(vertices.size());
+
+    std::vector<std::uint32_t> positionVertexCounts(positionCount);
+    std::vector<GLuint> positionFirstVertices(2 * positionCount);
+    std::vector<std::uint32_t> seamEdgeCounts(positionCount);
+    std::vector<std::uint32_t> borderEdgeCounts(positionCount);
+    std::vector<bool> isPositionLocked(positionCount);
+    std::vector<bool> isPositionTouched(positionCount);
+
+    std::vector<std::size_t> adjacencyOffsets(positionCount + 1);
+    std::vector<std::size_t> adjacentTriangles;
+    std::vector<Collapse> collapses;
+
+    // every pass collapses a set of edges far enough apart not to influence each other, cheapest first
+    while (current.size() > targetIndexCount) {
+        const std::size_t triangleCount = current.size() / 3;
+
+        collectEdges(current, positionIds, edges);
+
+        std::ranges::fill(positionVertexCounts, 0);
+        std::ranges::fill(seamEdgeCounts, 0);
+        std::ranges::fill(borderEdgeCounts, 0);
+        std::fill(isPositionLocked.begin(), isPositionLocked.end(), false);
+        std::fill(isVertexUsed.begin(), isVertexUsed.end(), false);
+
+        for (const GLuint vertex : current) {
+            if (isVertexUsed[vertex]) continue;
+            isVertexUsed[vertex] = true;
+
+            const GLuint position = positionIds[vertex];
+            if (positionVertexCounts[position] < 2) {
+                positionFirstVertices[2 * position + positionVertexCounts[position]] = vertex;
+            }
+            positionVertexCounts[position]++;
+        }
+
+        for (const auto &[key, edge] : edges) {
+            const auto positionA = static_cast<GLuint>(key >> 32);
+            const auto positionB = static_cast<GLuint>(key);
+
+            if (edge.triangleCount > 2) {
+                isPositionLocked[positionA] = isPositionLocked[positionB] = true;
+            } else if (edge.isBorder()) {
+                borderEdgeCounts[positionA]++;
+                borderEdgeCounts[positionB]++;
+            } else if (edge.isSeam()) {
+                seamEdgeCounts[positionA]++;
+                seamEdgeCounts[positionB]++;
+            }
+        }
+
+        for (std::size_t vertex = 0; vertex < vertices.size(); vertex++) {
+            if (!isVertexUsed[vertex]) continue;
+
+            const GLuint position = positionIds[vertex];
+            const std::uint32_t vertexCount = positionVertexCounts[position];
+            const std::uint32_t seamEdgeCount = seamEdgeCounts[position];
+            const std::uint32_t borderEdgeCount = borderEdgeCounts[position];
+
+            // borders and seams only ever continue straight through vertices which can be collapsed,
+            // anything more complicated is a corner which has to stay where it is
+            if (isPositionLocked[position]) {
+                kinds[vertex] = VertexKind::LOCKED;
+            } else if (vertexCount == 1 && seamEdgeCount == 0 && borderEdgeCount == 0) {
+                kinds[vertex] = VertexKind::MANIFOLD;
+            } else if (vertexCount == 1 && seamEdgeCount == 0 && borderEdgeCount == 2) {
+                kinds[vertex] = VertexKind::BORDER;
+            } else if (vertexCount == 2 && seamEdgeCount == 2 && borderEdgeCount == 0) {
+                kinds[vertex] = VertexKind::SEAM;
+                const GLuint first = positionFirstVertices[2 * position];
+                twins[vertex] = first == vertex ? positionFirstVertices[2 * position + 1] : first;
+            } else {
+                kinds[vertex] = VertexKind::LOCKED;
+            }
+        }
+
+        // triangles around each position, in compressed sparse row form
+        std::ranges::fill(adjacencyOffsets, 0);
+        for (const GLuint vertex : current) {
+            adjacencyOffsets[positionIds[vertex] + 1]++;
+        }
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+        adjacentTriangles.resize(current.size());
+        {
+            std::vector<std::size_t> fillCursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (std::size_t i = 0; i < current.size(); i++) {
+                adjacentTriangles[fillCursors[positionIds[current[i]]]++] = i / 3;
+            }
+        }
+
+        collapses.clear();
+        for (std::size_t i = 0; i < 3 * triangleCount; i++) {
+            const GLuint a = current[i];
+            const GLuint b = current[i - i % 3 + (i + 1) % 3];
+
+            for (const auto &[from, to] : {std::pair{a, b}, std::pair{b, a}}) {
+                const GLuint fromPosition = positionIds[from];
+                const GLuint toPosition = positionIds[to];
+
+                if (kinds[from] == VertexKind::LOCKED || fromPosition == toPosition) {
+                    continue;
+                }
+
+                Collapse collapse{from, to, NO_VERTEX, NO_VERTEX, 0.0};
+
+                if (kinds[from] == VertexKind::BORDER
+                    && !edges.at(getEdgeKey(fromPosition, toPosition)).isBorder()) {
+                    continue;
+                }
+
+                if (kinds[from] == VertexKind::SEAM) {
+                    const EdgeInfo &edge = edges.at(getEdgeKey(fromPosition, toPosition));
+                    if (!edge.isSeam()) {
+                        continue;
+                    }
+
+                    // the triangle on the other side of the seam uses the twin vertices
+                    const std::size_t fromSlot = fromPosition < toPosition ? 0 : 1;
+                    for (const auto &edgeVertices : edge.vertices) {
+                        if (edgeVertices[fromSlot] != from) {
+                            collapse.twinFrom = edgeVertices[fromSlot];
+                            collapse.twinTo = edgeVertices[1 - fromSlot];
+                        }
+                    }
+
+                    if (collapse.twinFrom != twins[from]) {
+                        continue;
+                    }
+                }
+
+                Quadric quadric = quadrics[fromPosition];
+                quadric += quadrics[toPosition];
+                collapse.cost = quadric.getError(vertices[to].position);
+
+                collapses.push_back(collapse);
+            }
+        }
+
+        std::ranges::sort(collapses, {}, &Collapse::cost);
+
+        if (collapses.empty()) {
+            break;
+        }
+
+        // most of the cheapest collapses get blocked by their neighbours, so without a limit a pass would
+        // go on to make expensive collapses which a later pass could have avoided. every collapse removes two
+        // triangles, and every directed edge is listed once by each of its two triangles
+        const std::size_t collapseGoal = (triangleCount - targetIndexCount / 3 + 1) / 2;
+        const double costLimit = collapses[std::min(collapses.size() - 1, 2 * collapseGoal * 3 / 2)].cost;
+
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(isPositionTouched.begin(), isPositionTouched.end(), false);
+        std::size_t removedTriangles = 0;
+        std::size_t appliedCollapses = 0;
+
+        for (const Collapse &collapse : collapses) {
+            if ((triangleCount - removedTriangles) * 3 <= targetIndexCount) {
+                break;
+            }
+
+            // ...unless everything below the limit turned out to flip triangles
+            if (collapse.cost > costLimit && appliedCollapses > 0) {
+                break;
+            }
+
+            const GLuint fromPosition = positionIds[collapse.from];
+            const GLuint toPosition = positionIds[collapse.to];
+
+            if (isPositionTouched[fromPosition] || isPositionTouched[toPosition]) {
+                continue;
+            }
+
+            const std::span<const std::size_t> triangles(
+                adjacentTriangles.data() + adjacencyOffsets[fromPosition],
+                adjacencyOffsets[fromPosition + 1] - adjacencyOffsets[fromPosition]);
+
+            if (wouldFlipTriangles(triangles, current, vertices, positionIds, fromPosition, toPosition,
+                                   vertices[collapse.to].position)) {
+                continue;
+            }
+
+            // everything around the collapsed vertex changes, so it's off limits for the rest of the pass
+            for (const std::size_t triangle : triangles) {
+                bool isCollapsing = false;
+                for (std::size_t k = 0; k < 3; k++) {
+                    const GLuint position = positionIds[current[3 * triangle + k]];
+                    isCollapsing |= position == toPosition;
+                    isPositionTouched[position] = true;
+                }
+                removedTriangles += isCollapsing;
+            }
+
+            remap[collapse.from] = collapse.to;
+            if (collapse.twinFrom != NO_VERTEX) {
+                remap[collapse.twinFrom] = collapse.twinTo;
+            }
+
+            quadrics[toPosition] += quadrics[fromPosition];
+            maxError = std::max(maxError, collapse.cost);
+            appliedCollapses++;
+        }
+
+        if (appliedCollapses == 0) {
+            break; // nothing left that can be collapsed without breaking the mesh
+        }
+
+        std::size_t writeIndex = 0;
+        for (std::size_t i = 0; i < 3 * triangleCount; i += 3) {
+            const GLuint a = remap[current[i]];
+            const GLuint b = remap[current[i + 1]];
+            const GLuint c = remap[current[i + 2]];
+
+            // triangles around collapsed edges degenerate
+            if (positionIds[a] == positionIds[b] || positionIds[b] == positionIds[c]
+                || positionIds[a] == positionIds[c]) {
+                continue;
+            }
+
+            current[writeIndex++] = a;
+            current[writeIndex++] = b;
+            current[writeIndex++] = c;
+        }
+        current.resize(writeIndex);
+    }
+
+    error = static_cast<float>(std::sqrt(maxError));
+    return current;
+}
@@ -0,0 +1,25 @@
+#ifndef MESH_SIMPLIFIER_HPP
+#define MESH_SIMPLIFIER_HPP
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "vertex.hpp"
+
+/**
+ * Simplifies a triangle list down to at most `targetIndexCount` indices (or as close as it gets), by collapsing
+ * edges in the order of increasing quadric error (Garland & Heckbert). Vertices are only ever collapsed onto
+ * other existing vertices, so the result references the same vertex array as the input.
+ *
+ * Texture seams and open borders are preserved: seam vertices only move along the seam, together with their twin
+ * on the other side of it, and vertices where seams meet or where the mesh has a border don't move at all.
+ *
+ * `error` receives the approximate geometric error of the result, in the mesh's object-space units.
+ */
+std::vector<GLuint> simplifyMesh(std::span<const GLuint> indices, std::span<const Vertex> vertices,
+                                 std::size_t targetIndexCount, float &error);
+
+#endif //MESH_SIMPLIFIER_HPP
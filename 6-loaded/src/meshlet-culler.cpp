@@ -0,0 +1,87 @@
+#include "meshlet-culler.hpp"
+
+#include <cmath>
+
+// meshlets culled by a single thread pool task -- culling one is only a few dozen instructions
+static constexpr std::size_t MIN_CULLING_CHUNK = 4096;
+
+MeshletCuller::MeshletCuller(ThreadPool &threadPool, const std::span<const Meshlet> meshlets)
+    : threadPool(threadPool) {
+    for (const Meshlet &meshlet : meshlets) {
+        centerX.push_back(meshlet.center.x);
+        centerY.push_back(meshlet.center.y);
+        centerZ.push_back(meshlet.center.z);
+        radii.push_back(meshlet.radius);
+        coneAxisX.push_back(meshlet.coneAxis.x);
+        coneAxisY.push_back(meshlet.coneAxis.y);
+        coneAxisZ.push_back(meshlet.coneAxis.z);
+        coneCutoffs.push_back(meshlet.coneCutoff);
+        ranges.push_back({meshlet.firstIndex, meshlet.indexCount});
+    }
+
+    visibility.resize(meshlets.size());
+}
+
+std::size_t MeshletCuller::cull(const glm::mat4 &objectToClip, const glm::vec3 &cameraPosition,
+                                std::vector<DrawRange> &visibleRanges) {
+    // frustum planes in object space, extracted from the rows of the matrix (Gribb & Hartmann),
+    // normalized so that plane distances can be compared against sphere radii
+    glm::vec4 planes[6];
+    for (int i = 0; i < 3; i++) {
+        const glm::vec4 row(objectToClip[0][i], objectToClip[1][i], objectToClip[2][i], objectToClip[3][i]);
+        const glm::vec4 lastRow(objectToClip[0][3], objectToClip[1][3], objectToClip[2][3], objectToClip[3][3]);
+        planes[2 * i] = lastRow + row;
+        planes[2 * i + 1] = lastRow - row;
+    }
+
+    for (glm::vec4 &plane : planes) {
+        plane /= glm::length(glm::vec3(plane.x, plane.y, plane.z));
+    }
+
+    threadPool.parallelFor(ranges.size(), MIN_CULLING_CHUNK, [&](const std::size_t begin, const std::size_t end) {
+        const float *__restrict cx = centerX.data();
+        const float *__restrict cy = centerY.data();
+        const float *__restrict cz = centerZ.data();
+        const float *__restrict r = radii.data();
+        const float *__restrict ax = coneAxisX.data();
+        const float *__restrict ay = coneAxisY.data();
+        const float *__restrict az = coneAxisZ.data();
+        const float *__restrict cutoff = coneCutoffs.data();
+        std::uint8_t *__restrict visible = visibility.data();
+
+        for (std::size_t i = begin; i < end; i++) {
+            bool isInFrustum = true;
+            for (const glm::vec4 &plane : planes) {
+                isInFrustum &= plane.x * cx[i] + plane.y * cy[i] + plane.z * cz[i] + plane.w >= -r[i];
+            }
+
+            // all triangles face away if the camera lies deep enough behind the normal cone's apex -- the angle
+            // between the view direction and the cone axis, widened by the bounding sphere, must leave
+            // every normal in the cone more than 90 degrees away from the direction towards the camera
+            const float dx = cx[i] - cameraPosition.x;
+            const float dy = cy[i] - cameraPosition.y;
+            const float dz = cz[i] - cameraPosition.z;
+            const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+            const bool isBackFacing = dx * ax[i] + dy * ay[i] + dz * az[i] > cutoff[i] * distance + r[i];
+
+            visible[i] = isInFrustum & !isBackFacing;
+        }
+    });
+
+    visibleRanges.clear();
+    std::size_t visibleCount = 0;
+
+    for (std::size_t i = 0; i < ranges.size(); i++) {
+        if (!visibility[i]) continue;
+        visibleCount++;
+
+        if (!visibleRanges.empty()
+            && visibleRanges.back().firstIndex + visibleRanges.back().indexCount == ranges[i].firstIndex) {
+            visibleRanges.back().indexCount += ranges[i].indexCount;
+        } else {
+            visibleRanges.push_back(ranges[i]);
+        }
+    }
+
+    return visibleCount;
+}
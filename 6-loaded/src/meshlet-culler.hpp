@@ -0,0 +1,45 @@
+#ifndef MESHLET_CULLER_HPP
+#define MESHLET_CULLER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "utilities/thread-pool.hpp"
+#include "index-buffer.hpp"
+#include "meshlet.hpp"
+
+/**
+ * Culls meshlets lying outside the view frustum or facing entirely away from the camera.
+ *
+ * Bounds are kept in structure-of-arrays form and tested with a branchless loop, which compilers turn into
+ * SIMD code for whatever the target architecture is. Large meshes are culled in parallel on the thread pool.
+ */
+class MeshletCuller {
+    ThreadPool &threadPool;
+
+    std::vector<float> centerX, centerY, centerZ, radii;
+    std::vector<float> coneAxisX, coneAxisY, coneAxisZ, coneCutoffs;
+    std::vector<DrawRange> ranges;
+
+    std::vector<std::uint8_t> visibility;
+
+public:
+    MeshletCuller(ThreadPool &threadPool, std::span<const Meshlet> meshlets);
+
+    [[nodiscard]] std::size_t getMeshletCount() const { return ranges.size(); }
+
+    /**
+     * Replaces the contents of `visibleRanges` with index ranges of the meshlets which might be visible,
+     * sorted and with neighbouring ranges merged. Returns the number of visible meshlets.
+     *
+     * The matrix maps the mesh's object space to clip space, and the camera position is given in object space.
+     */
+    std::size_t cull(const glm::mat4 &objectToClip, const glm::vec3 &cameraPosition,
+                     std::vector<DrawRange> &visibleRanges);
+};
+
+#endif //MESHLET_CULLER_HPP
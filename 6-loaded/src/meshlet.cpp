@@ -0,0 +1,197 @@
+#include "meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "mesh-optimizer.hpp"
+
+static constexpr std::size_t NO_MESHLET = std::numeric_limits<std::size_t>::max();
+static constexpr std::size_t NO_TRIANGLE = std::numeric_limits<std::size_t>::max();
+
+// how much growing meshlets prefers triangles facing the same way as the meshlet, which makes normal cones
+// narrower, over triangles sharing more vertices with it, which makes meshlets fuller
+static constexpr float CONE_WEIGHT = 2.0f;
+
+static Meshlet computeMeshletBounds(const std::span<const GLuint> meshletIndices,
+                                    const std::span<const Vertex> vertices) {
+    Meshlet meshlet{};
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (const GLuint index : meshletIndices) {
+        boundsMin = glm::min(boundsMin, vertices[index].position);
+        boundsMax = glm::max(boundsMax, vertices[index].position);
+    }
+
+    meshlet.center = (boundsMin + boundsMax) * 0.5f;
+    for (const GLuint index : meshletIndices) {
+        meshlet.radius = std::max(meshlet.radius, glm::distance(meshlet.center, vertices[index].position));
+    }
+
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshletIndices.size() / 3);
+
+    for (std::size_t i = 0; i + 2 < meshletIndices.size(); i += 3) {
+        const glm::vec3 &p0 = vertices[meshletIndices[i]].position;
+        const glm::vec3 &p1 = vertices[meshletIndices[i + 1]].position;
+        const glm::vec3 &p2 = vertices[meshletIndices[i + 2]].position;
+
+        const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(normal);
+
+        // degenerate triangles are invisible from any direction, so they can't constrain the cone
+        if (length > 0.0f) {
+            normals.push_back(normal / length);
+        }
+    }
+
+    glm::vec3 axis(0.0f);
+    for (const glm::vec3 &normal : normals) {
+        axis += normal;
+    }
+
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+
+    if (glm::length(axis) > 0.0f) {
+        axis = glm::normalize(axis);
+
+        float minDot = 1.0f;
+        for (const glm::vec3 &normal : normals) {
+            minDot = std::min(minDot, glm::dot(axis, normal));
+        }
+
+        meshlet.coneAxis = axis;
+
+        // a cone at least as wide as a hemisphere is never fully back-facing
+        if (minDot > 0.0f) {
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+    }
+
+    return meshlet;
+}
+
+std::vector<Meshlet> buildMeshlets(const std::span<GLuint> indices, const std::span<const Vertex> vertices) {
+    const std::size_t triangleCount = indices.size() / 3;
+
+    // adjacency goes through positions rather than vertices, so meshlets can grow across texture seams
+    std::size_t positionCount;
+    const std::vector<GLuint> positionIds = getPositionIds(vertices, positionCount);
+
+    // triangles using each position, in compressed sparse row form
+    std::vector<std::size_t> adjacencyOffsets(positionCount + 1, 0);
+    for (std::size_t i = 0; i < 3 * triangleCount; i++) {
+        adjacencyOffsets[positionIds[indices[i]] + 1]++;
+    }
+    std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+    std::vector<std::size_t> adjacentTriangles(3 * triangleCount);
+    {
+        std::vector<std::size_t> fillCursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (std::size_t i = 0; i < 3 * triangleCount; i++) {
+            adjacentTriangles[fillCursors[positionIds[indices[i]]]++] = i / 3;
+        }
+    }
+
+    std::vector<glm::vec3> triangleNormals(triangleCount);
+    for (std::size_t t = 0; t < triangleCount; t++) {
+        const glm::vec3 &p0 = vertices[indices[3 * t]].position;
+        const glm::vec3 &p1 = vertices[indices[3 * t + 1]].position;
+        const glm::vec3 &p2 = vertices[indices[3 * t + 2]].position;
+        const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        triangleNormals[t] = glm::length(normal) > 0.0f ? glm::normalize(normal) : normal;
+    }
+
+    std::vector<bool> isEmitted(triangleCount, false);
+    std::vector<std::size_t> vertexMeshlets(vertices.size(), NO_MESHLET); // last meshlet each vertex was added to
+
+    std::vector<GLuint> output;
+    output.reserve(indices.size());
+    std::vector<Meshlet> meshlets;
+    std::vector<std::size_t> candidates;
+
+    std::size_t seed = 0;
+
+    while (true) {
+        while (seed < triangleCount && isEmitted[seed]) seed++;
+        if (seed == triangleCount) break;
+
+        const std::size_t meshletId = meshlets.size();
+        const std::size_t firstIndex = output.size();
+        std::size_t meshletVertexCount = 0;
+        std::size_t meshletTriangleCount = 0;
+
+        glm::vec3 normalSum(0.0f);
+
+        candidates.clear();
+        candidates.push_back(seed);
+
+        while (meshletTriangleCount < Meshlet::MAX_TRIANGLES) {
+            std::size_t best = NO_TRIANGLE;
+            float bestScore = std::numeric_limits<float>::lowest();
+            const glm::vec3 coneAxis = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : normalSum;
+
+            for (std::size_t c = 0; c < candidates.size();) {
+                const std::size_t triangle = candidates[c];
+                if (isEmitted[triangle]) {
+                    candidates[c] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+
+                int sharedCount = 0;
+                for (std::size_t k = 0; k < 3; k++) {
+                    sharedCount += vertexMeshlets[indices[3 * triangle + k]] == meshletId;
+                }
+
+                const bool fits = meshletVertexCount + (3 - sharedCount) <= Meshlet::MAX_VERTICES;
+                const float score = static_cast<float>(sharedCount)
+                                    + CONE_WEIGHT * glm::dot(coneAxis, triangleNormals[triangle]);
+                if (fits && score > bestScore) {
+                    best = triangle;
+                    bestScore = score;
+                }
+
+                c++;
+            }
+
+            if (best == NO_TRIANGLE) {
+                break;
+            }
+
+            isEmitted[best] = true;
+            meshletTriangleCount++;
+            normalSum += triangleNormals[best];
+
+            for (std::size_t k = 0; k < 3; k++) {
+                const GLuint vertex = indices[3 * best + k];
+                output.push_back(vertex);
+
+                if (vertexMeshlets[vertex] != meshletId) {
+                    vertexMeshlets[vertex] = meshletId;
+                    meshletVertexCount++;
+                }
+
+                const GLuint position = positionIds[vertex];
+                for (std::size_t a = adjacencyOffsets[position]; a < adjacencyOffsets[position + 1]; a++) {
+                    if (!isEmitted[adjacentTriangles[a]]) {
+                        candidates.push_back(adjacentTriangles[a]);
+                    }
+                }
+            }
+        }
+
+        const std::span<const GLuint> meshletIndices(output.data() + firstIndex, output.size() - firstIndex);
+        Meshlet meshlet = computeMeshletBounds(meshletIndices, vertices);
+        meshlet.firstIndex = static_cast<GLuint>(firstIndex);
+        meshlet.indexCount = static_cast<GLuint>(meshletIndices.size());
+        meshlets.push_back(meshlet);
+    }
+
+    std::ranges::copy(output, indices.begin());
+
+    return meshlets;
+}
@@ -0,0 +1,43 @@
+#ifndef MESHLET_HPP
+#define MESHLET_HPP
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "vertex.hpp"
+
+/**
+ * A small cluster of triangles occupying a contiguous range of the index buffer, together with bounds that allow
+ * culling it as a whole. Stored in mesh caches as-is, so it must stay trivially copyable.
+ */
+struct Meshlet {
+    static constexpr std::size_t MAX_VERTICES = 64;
+    static constexpr std::size_t MAX_TRIANGLES = 124;
+
+    // bounding sphere of the meshlet's vertices
+    glm::vec3 center;
+    float radius;
+
+    // cone containing the normals of all the meshlet's triangles
+    glm::vec3 coneAxis;
+    float coneCutoff; // sine of the cone's half-angle, or 1 if the cone is too wide to ever cull the meshlet
+
+    GLuint firstIndex;
+    GLuint indexCount;
+};
+
+/**
+ * Partitions the mesh into meshlets of at most `Meshlet::MAX_VERTICES` unique vertices and `Meshlet::MAX_TRIANGLES`
+ * triangles, reordering triangles so every meshlet covers a contiguous range of the index buffer.
+ *
+ * Meshlets are grown greedily from seed triangles taken in the original triangle order, by repeatedly adding
+ * the adjacent triangle sharing the most vertices with the meshlet. This keeps meshlets spatially compact, which
+ * makes their bounds tight, while keeping the coarse triangle order of the previous optimization passes.
+ */
+std::vector<Meshlet> buildMeshlets(std::span<GLuint> indices, std::span<const Vertex> vertices);
+
+#endif //MESHLET_HPP
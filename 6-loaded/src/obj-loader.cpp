@@ -0,0 +1,750 @@
+#include "obj-loader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "utilities/mapped-file.hpp"
+#include "vertex-welder.hpp"
+
+// negative (relative) OBJ indices can only be resolved once we know how many elements precede the chunk
+// they're in, so until then they're stored shifted by this bias to tell them apart from absolute ones
+static constexpr std::int64_t RELATIVE_INDEX_BIAS = std::int64_t{1} << 62;
+static constexpr std::int64_t MISSING_INDEX = std::numeric_limits<std::int64_t>::min();
+
+static constexpr std::size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+// how much of the file `ObjLoader::stream` reads and parses at a time
+static constexpr std::size_t STREAM_BLOCK_BYTES = 16 * 1024 * 1024;
+
+/**
+ * A statement affecting which submesh the following faces belong to.
+ */
+struct ObjStatement {
+    enum Kind {
+        OBJECT,          // `o` or `g`
+        MATERIAL,        // `usemtl`
+        MATERIAL_LIBRARY // `mtllib`
+    };
+
+    Kind kind;
+    std::string_view value;
+    std::size_t triangleCornerOffset; // triangle corners in the chunk before this statement
+};
+
+/**
+ * Everything parsed out of a single line-aligned chunk of the file.
+ */
+struct ObjChunk {
+    std::string_view text;
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+
+    std::vector<std::uint32_t> faceSizes;
+    std::vector<std::int64_t> cornerPositions;
+    std::vector<std::int64_t> cornerUvs;
+    std::size_t triangleCornerCount = 0;
+
+    std::vector<ObjStatement> statements;
+
+    // filled in once all chunks are parsed
+    std::size_t positionBase = 0;
+    std::size_t uvBase = 0;
+    std::size_t outputBase = 0;
+};
+
+static bool isDigit(const char c) {
+    return c >= '0' && c <= '9';
+}
+
+static void skipSpaces(const char *&curr, const char *end) {
+    while (curr != end && (*curr == ' ' || *curr == '\t')) curr++;
+}
+
+/**
+ * Parses a real number the same way tinyobjloader does, so that both produce bit-identical floats.
+ */
+static float parseReal(const char *&curr, const char *end) {
+    skipSpaces(curr, end);
+
+    double sign = 1.0;
+    if (curr != end && (*curr == '+' || *curr == '-')) {
+        sign = *curr == '-' ? -1.0 : 1.0;
+        curr++;
+    }
+
+    double mantissa = 0.0;
+    while (curr != end && isDigit(*curr)) {
+        mantissa *= 10;
+        mantissa += static_cast<int>(*curr - '0');
+        curr++;
+    }
+
+    if (curr != end && *curr == '.') {
+        curr++;
+
+        static constexpr double powLut[] = {1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001};
+        constexpr int lutEntries = sizeof powLut / sizeof powLut[0];
+
+        int read = 1;
+        while (curr != end && isDigit(*curr)) {
+            mantissa += static_cast<int>(*curr - '0') * (read < lutEntries ? powLut[read] : std::pow(10.0, -read));
+            read++;
+            curr++;
+        }
+    }
+
+    int exponent = 0;
+    if (curr != end && (*curr == 'e' || *curr == 'E')) {
+        curr++;
+
+        int exponentSign = 1;
+        if (curr != end && (*curr == '+' || *curr == '-')) {
+            exponentSign = *curr == '-' ? -1 : 1;
+            curr++;
+        }
+
+        while (curr != end && isDigit(*curr)) {
+            exponent = exponent * 10 + static_cast<int>(*curr - '0');
+            curr++;
+        }
+
+        exponent *= exponentSign;
+    }
+
+    // skip whatever's left of a malformed token
+    while (curr != end && *curr != ' ' && *curr != '\t') curr++;
+
+    const double value = exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa;
+    return static_cast<float>(sign * value);
+}
+
+/**
+ * Parses a single index of a face corner, converting it to a zero-based one.
+ * `elementCount` is the number of elements of the referenced kind parsed so far in this chunk.
+ */
+static std::int64_t parseIndex(const char *&curr, const char *end, const std::size_t elementCount) {
+    bool isNegative = false;
+    if (curr != end && (*curr == '+' || *curr == '-')) {
+        isNegative = *curr == '-';
+        curr++;
+    }
+
+    std::int64_t value = 0;
+    bool hasDigits = false;
+    while (curr != end && isDigit(*curr)) {
+        value = value * 10 + (*curr - '0');
+        hasDigits = true;
+        curr++;
+    }
+
+    if (!hasDigits) {
+        return MISSING_INDEX;
+    }
+
+    if (value == 0) {
+        throw std::runtime_error("invalid zero index in OBJ face");
+    }
+
+    return isNegative
+        ? static_cast<std::int64_t>(elementCount) - value - RELATIVE_INDEX_BIAS
+        : value - 1;
+}
+
+static void parseFace(const char *curr, const char *end, ObjChunk &chunk) {
+    std::uint32_t faceSize = 0;
+
+    while (true) {
+        skipSpaces(curr, end);
+        if (curr == end) break;
+
+        const std::int64_t position = parseIndex(curr, end, chunk.positions.size());
+        std::int64_t uv = MISSING_INDEX;
+
+        if (curr != end && *curr == '/') {
+            curr++;
+            uv = parseIndex(curr, end, chunk.uvs.size());
+
+            if (curr != end && *curr == '/') {
+                curr++;
+                parseIndex(curr, end, 0); // normals are not used
+            }
+        }
+
+        // skip whatever's left of a malformed token
+        while (curr != end && *curr != ' ' && *curr != '\t') curr++;
+
+        if (position == MISSING_INDEX) {
+            throw std::runtime_error("face corner without a position index in OBJ file");
+        }
+
+        chunk.cornerPositions.push_back(position);
+        chunk.cornerUvs.push_back(uv);
+        faceSize++;
+    }
+
+    if (faceSize < 3) {
+        // degenerate face -- tinyobjloader skips these too
+        chunk.cornerPositions.resize(chunk.cornerPositions.size() - faceSize);
+        chunk.cornerUvs.resize(chunk.cornerUvs.size() - faceSize);
+        return;
+    }
+
+    chunk.faceSizes.push_back(faceSize);
+    chunk.triangleCornerCount += 3 * (faceSize - 2);
+}
+
+/**
+ * Returns the rest of the line, without surrounding whitespace.
+ */
+static std::string_view parseName(const char *curr, const char *end) {
+    skipSpaces(curr, end);
+    while (end != curr && (end[-1] == ' ' || end[-1] == '\t')) end--;
+
+    return {curr, static_cast<std::size_t>(end - curr)};
+}
+
+static bool startsWithKeyword(const char *curr, const std::size_t lineLength, const std::string_view keyword) {
+    return lineLength > keyword.size()
+           && std::string_view(curr, keyword.size()) == keyword
+           && (curr[keyword.size()] == ' ' || curr[keyword.size()] == '\t');
+}
+
+static void parseChunk(ObjChunk &chunk) {
+    const char *curr = chunk.text.data();
+    const char *const textEnd = curr + chunk.text.size();
+
+    while (curr != textEnd) {
+        const char *lineEnd = std::find(curr, textEnd, '\n');
+        const char *const nextLine = lineEnd == textEnd ? textEnd : lineEnd + 1;
+        if (lineEnd != curr && lineEnd[-1] == '\r') lineEnd--;
+
+        skipSpaces(curr, lineEnd);
+        const std::size_t lineLength = lineEnd - curr;
+
+        if (lineLength >= 2 && curr[0] == 'v' && (curr[1] == ' ' || curr[1] == '\t')) {
+            curr += 2;
+            const float x = parseReal(curr, lineEnd);
+            const float y = parseReal(curr, lineEnd);
+            const float z = parseReal(curr, lineEnd);
+            chunk.positions.emplace_back(x, y, z);
+        } else if (lineLength >= 3 && curr[0] == 'v' && curr[1] == 't' && (curr[2] == ' ' || curr[2] == '\t')) {
+            curr += 3;
+            const float u = parseReal(curr, lineEnd);
+            const float v = parseReal(curr, lineEnd);
+            chunk.uvs.emplace_back(u, v);
+        } else if (lineLength >= 2 && curr[0] == 'f' && (curr[1] == ' ' || curr[1] == '\t')) {
+            parseFace(curr + 2, lineEnd, chunk);
+        } else if (startsWithKeyword(curr, lineLength, "o") || startsWithKeyword(curr, lineLength, "g")) {
+            const std::string_view name = parseName(curr + 2, lineEnd);
+            chunk.statements.push_back({ObjStatement::OBJECT, name, chunk.triangleCornerCount});
+        } else if (startsWithKeyword(curr, lineLength, "usemtl")) {
+            const std::string_view name = parseName(curr + 7, lineEnd);
+            chunk.statements.push_back({ObjStatement::MATERIAL, name, chunk.triangleCornerCount});
+        } else if (startsWithKeyword(curr, lineLength, "mtllib")) {
+            const std::string_view name = parseName(curr + 7, lineEnd);
+            chunk.statements.push_back({ObjStatement::MATERIAL_LIBRARY, name, chunk.triangleCornerCount});
+        }
+
+        curr = nextLine;
+    }
+}
+
+static std::size_t resolveIndex(const std::int64_t index, const std::size_t base, const std::size_t count) {
+    const std::int64_t resolved = index < -RELATIVE_INDEX_BIAS / 2
+                                      ? index + RELATIVE_INDEX_BIAS + static_cast<std::int64_t>(base)
+                                      : index;
+
+    if (resolved < 0 || static_cast<std::size_t>(resolved) >= count) {
+        throw std::runtime_error("out of range index in OBJ face");
+    }
+
+    return static_cast<std::size_t>(resolved);
+}
+
+/**
+ * Triangulates the faces of a parsed chunk, calling `emitCorner(positionIndex, uvIndex)` with resolved indices
+ * for every corner of every resulting triangle, in order.
+ */
+template<typename EmitCorner>
+static void triangulateChunk(const ObjChunk &chunk, const std::span<const glm::vec3> positions,
+                             const std::span<const glm::vec2> uvs, EmitCorner &&emitCorner) {
+    const auto getPosition = [&](const std::size_t corner) {
+        return resolveIndex(chunk.cornerPositions[corner], chunk.positionBase, positions.size());
+    };
+
+    const auto getUv = [&](const std::size_t corner) {
+        const std::int64_t uvIndex = chunk.cornerUvs[corner];
+        if (uvIndex == MISSING_INDEX) {
+            throw std::runtime_error("no texcoord index in mesh");
+        }
+
+        return resolveIndex(uvIndex, chunk.uvBase, uvs.size());
+    };
+
+    const auto emitTriangle = [&](const std::size_t a, const std::size_t b, const std::size_t c) {
+        emitCorner(getPosition(a), getUv(a));
+        emitCorner(getPosition(b), getUv(b));
+        emitCorner(getPosition(c), getUv(c));
+    };
+
+    std::size_t inputCorner = 0;
+
+    for (const std::uint32_t faceSize : chunk.faceSizes) {
+        const std::size_t first = inputCorner;
+
+        if (faceSize == 4) {
+            // split quads along the shorter diagonal, exactly like tinyobjloader
+            const glm::vec3 e02 = positions[getPosition(first + 2)] - positions[getPosition(first)];
+            const glm::vec3 e13 = positions[getPosition(first + 3)] - positions[getPosition(first + 1)];
+
+            if (glm::dot(e02, e02) < glm::dot(e13, e13)) {
+                emitTriangle(first, first + 1, first + 2);
+                emitTriangle(first, first + 2, first + 3);
+            } else {
+                emitTriangle(first, first + 1, first + 3);
+                emitTriangle(first + 1, first + 2, first + 3);
+            }
+        } else {
+            // larger polygons are assumed to be convex and are simply fanned out
+            for (std::uint32_t v = 1; v + 1 < faceSize; v++) {
+                emitTriangle(first, first + v, first + v + 1);
+            }
+        }
+
+        inputCorner += faceSize;
+    }
+}
+
+/**
+ * Parses the arguments of a texture statement of a material library, resolving the texture's path relative to
+ * the library.
+ */
+static std::filesystem::path parseTexturePath(const std::filesystem::path &libraryPath, const char *curr,
+                                              const char *end) {
+    // texture options may precede the file name, which always comes last
+    std::string_view fileName = parseName(curr, end);
+    const std::size_t lastSpace = fileName.find_last_of(" \t");
+    if (lastSpace != std::string_view::npos) fileName.remove_prefix(lastSpace + 1);
+
+    return libraryPath.parent_path() / fileName;
+}
+
+/**
+ * Reads the materials defined by an MTL library, appending them to `materials`. Missing libraries are ignored --
+ * the materials they should have defined simply end up plain white.
+ */
+static void parseMaterialLibrary(const std::filesystem::path &path, std::vector<ObjMaterial> &materials) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        const char *curr = line.data();
+        const char *end = curr + line.size();
+        if (end != curr && end[-1] == '\r') end--;
+
+        skipSpaces(curr, end);
+        const std::size_t lineLength = end - curr;
+
+        if (startsWithKeyword(curr, lineLength, "newmtl")) {
+            materials.emplace_back().name = parseName(curr + 7, end);
+        } else if (materials.empty()) {
+            continue;
+        } else if (startsWithKeyword(curr, lineLength, "Kd")) {
+            curr += 3;
+            const float r = parseReal(curr, end);
+            const float g = parseReal(curr, end);
+            const float b = parseReal(curr, end);
+            materials.back().diffuseColor = {r, g, b};
+        } else if (startsWithKeyword(curr, lineLength, "map_Kd")) {
+            materials.back().diffuseTexture = parseTexturePath(path, curr + 7, end);
+        } else {
+            // exporters disagree on which statement holds the normal map, so any of them will do
+            for (const std::string_view keyword : {"map_Bump", "map_bump", "bump", "norm"}) {
+                if (startsWithKeyword(curr, lineLength, keyword)) {
+                    materials.back().normalTexture = parseTexturePath(path, curr + keyword.size() + 1, end);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Splits the triangulated faces into submeshes wherever the object or the material changes, reading the materials
+ * the file references along the way.
+ */
+static void collectSubmeshes(const std::filesystem::path &path, const std::vector<ObjChunk> &chunks,
+                             const std::size_t cornerCount, std::vector<ObjSubmesh> &submeshes,
+                             std::vector<ObjMaterial> &materials) {
+    submeshes.clear();
+    materials.clear();
+
+    for (const ObjChunk &chunk : chunks) {
+        for (const ObjStatement &statement : chunk.statements) {
+            if (statement.kind == ObjStatement::MATERIAL_LIBRARY) {
+                parseMaterialLibrary(path.parent_path() / statement.value, materials);
+            }
+        }
+    }
+
+    // if a material is defined more than once, the first definition wins
+    std::unordered_map<std::string, std::size_t> materialIndices;
+    for (std::size_t i = 0; i < materials.size(); i++) {
+        materialIndices.try_emplace(materials[i].name, i);
+    }
+
+    const auto getMaterialIndex = [&](const std::string_view name) {
+        const auto [it, isNew] = materialIndices.try_emplace(std::string(name), materials.size());
+        if (isNew) {
+            materials.emplace_back().name = name;
+        }
+
+        return it->second;
+    };
+
+    // faces before the first `usemtl` only get a material if there are any
+    constexpr std::size_t NO_MATERIAL = std::numeric_limits<std::size_t>::max();
+
+    std::string objectName;
+    std::size_t materialIndex = NO_MATERIAL;
+    std::size_t submeshStart = 0;
+
+    const auto closeSubmesh = [&](const std::size_t end) {
+        if (end > submeshStart) {
+            if (materialIndex == NO_MATERIAL) {
+                materialIndex = getMaterialIndex("");
+            }
+
+            submeshes.push_back({objectName, materialIndex, submeshStart, end - submeshStart});
+        }
+
+        submeshStart = end;
+    };
+
+    for (const ObjChunk &chunk : chunks) {
+        for (const ObjStatement &statement : chunk.statements) {
+            const std::size_t offset = chunk.outputBase + statement.triangleCornerOffset;
+
+            if (statement.kind == ObjStatement::OBJECT && statement.value != objectName) {
+                closeSubmesh(offset);
+                objectName = statement.value;
+            } else if (statement.kind == ObjStatement::MATERIAL) {
+                const std::size_t newMaterialIndex = getMaterialIndex(statement.value);
+                if (newMaterialIndex != materialIndex) {
+                    closeSubmesh(offset);
+                    materialIndex = newMaterialIndex;
+                }
+            }
+        }
+    }
+
+    closeSubmesh(cornerCount);
+}
+
+std::vector<ObjChunk> ObjLoader::parseChunks(const std::string_view text) {
+    // split the text into line-aligned chunks, a few per thread
+    std::vector<ObjChunk> chunks;
+    const std::size_t targetChunkBytes = std::max(text.size() / (threadPool.getThreadCount() * 4) + 1,
+                                                  MIN_CHUNK_BYTES);
+
+    for (std::size_t begin = 0; begin < text.size();) {
+        std::size_t end = std::min(begin + targetChunkBytes, text.size());
+        end = text.find('\n', end - 1);
+        end = end == std::string_view::npos ? text.size() : end + 1;
+
+        chunks.emplace_back().text = text.substr(begin, end - begin);
+        begin = end;
+    }
+
+    threadPool.parallelFor(chunks.size(), 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            parseChunk(chunks[i]);
+        }
+    });
+
+    return chunks;
+}
+
+void ObjLoader::load(const std::filesystem::path &path, std::vector<Vertex> &vertices, std::vector<GLuint> &indices,
+                     std::vector<ObjSubmesh> &submeshes, std::vector<ObjMaterial> &materials) {
+    const MappedFile file(path);
+    const std::string_view text(reinterpret_cast<const char *>(file.getData().data()), file.getData().size());
+
+    std::vector<ObjChunk> chunks = parseChunks(text);
+
+    // now that we know how much each chunk contains, lay them out one after another
+    std::size_t positionCount = 0, uvCount = 0, cornerCount = 0;
+    for (auto &chunk : chunks) {
+        chunk.positionBase = positionCount;
+        chunk.uvBase = uvCount;
+        chunk.outputBase = cornerCount;
+        positionCount += chunk.positions.size();
+        uvCount += chunk.uvs.size();
+        cornerCount += chunk.triangleCornerCount;
+    }
+
+    if (cornerCount > std::numeric_limits<GLuint>::max()) {
+        throw std::runtime_error("OBJ file has too many face corners to be indexed with GLuint");
+    }
+
+    std::vector<glm::vec3> positions(positionCount);
+    std::vector<glm::vec2> uvs(uvCount);
+
+    threadPool.parallelFor(chunks.size(), 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            std::ranges::copy(chunks[i].positions, positions.begin() + chunks[i].positionBase);
+            std::ranges::copy(chunks[i].uvs, uvs.begin() + chunks[i].uvBase);
+            chunks[i].positions = {};
+            chunks[i].uvs = {};
+        }
+    });
+
+    // triangulate the faces, turning every triangle corner into a full vertex
+    std::vector<Vertex> corners(cornerCount);
+
+    threadPool.parallelFor(chunks.size(), 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            std::size_t outputCorner = chunks[i].outputBase;
+
+            triangulateChunk(chunks[i], positions, uvs, [&](const std::size_t position, const std::size_t uv) {
+                corners[outputCorner++] = {positions[position], uvs[uv]};
+            });
+        }
+    });
+
+    collectSubmeshes(path, chunks, cornerCount, submeshes, materials);
+
+    chunks = {};
+    positions = {};
+    uvs = {};
+
+    weld(corners, vertices, indices);
+}
+
+void ObjLoader::stream(const std::filesystem::path &path, const StreamCallback &onBlock) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open OBJ file: " + path.string());
+    }
+
+    // positions and texture coordinates can be referenced by any later face, so they have to be kept around.
+    // for every unique vertex we only remember where it came from, which is enough to compare it with new corners
+    struct VertexSource {
+        GLuint position;
+        GLuint uv;
+    };
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<VertexSource> vertexSources;
+    VertexWelder welder;
+
+    const auto getVertex = [&](const GLuint id) {
+        return Vertex{positions[vertexSources[id].position], uvs[vertexSources[id].uv]};
+    };
+
+    std::vector<Vertex> blockVertices;
+    std::vector<GLuint> blockIndices;
+    std::size_t cornerCount = 0;
+
+    std::vector<char> buffer(STREAM_BLOCK_BYTES);
+    std::size_t carriedBytes = 0; // the unfinished last line of the previous block
+
+    while (true) {
+        file.read(buffer.data() + carriedBytes, static_cast<std::streamsize>(buffer.size() - carriedBytes));
+        const std::size_t availableBytes = carriedBytes + static_cast<std::size_t>(file.gcount());
+        const bool isLastBlock = file.eof();
+
+        if (!isLastBlock && !file) {
+            throw std::runtime_error("failed to read OBJ file: " + path.string());
+        }
+
+        // only whole lines are parsed, the rest is carried over to the next block
+        std::size_t textBytes = availableBytes;
+        if (!isLastBlock) {
+            const std::string_view available(buffer.data(), availableBytes);
+            const std::size_t lastNewline = available.rfind('\n');
+
+            if (lastNewline == std::string_view::npos) {
+                // a single line longer than the whole block -- make room for it and keep reading
+                carriedBytes = availableBytes;
+                buffer.resize(buffer.size() * 2);
+                continue;
+            }
+
+            textBytes = lastNewline + 1;
+        }
+
+        std::vector<ObjChunk> chunks = parseChunks(std::string_view(buffer.data(), textBytes));
+
+        for (ObjChunk &chunk : chunks) {
+            chunk.positionBase = positions.size();
+            chunk.uvBase = uvs.size();
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+            chunk.positions = {};
+            chunk.uvs = {};
+
+            cornerCount += chunk.triangleCornerCount;
+            if (cornerCount > std::numeric_limits<GLuint>::max()) {
+                throw std::runtime_error("OBJ file has too many face corners to be indexed with GLuint");
+            }
+
+            // faces can only reference elements defined before them, so they can be resolved right away.
+            // welding sequentially numbers vertices in order of their first occurrence, just like `weld` does
+            triangulateChunk(chunk, positions, uvs, [&](const std::size_t position, const std::size_t uv) {
+                const Vertex vertex{positions[position], uvs[uv]};
+                const auto nextId = static_cast<GLuint>(vertexSources.size());
+                const GLuint id = welder.weld(vertex, nextId, getVertex);
+
+                if (id == nextId) {
+                    vertexSources.push_back({static_cast<GLuint>(position), static_cast<GLuint>(uv)});
+                    blockVertices.push_back(vertex);
+                }
+
+                blockIndices.push_back(id);
+            });
+        }
+
+        onBlock(blockVertices, blockIndices);
+        blockVertices.clear();
+        blockIndices.clear();
+
+        if (isLastBlock) {
+            break;
+        }
+
+        std::copy(buffer.begin() + static_cast<std::ptrdiff_t>(textBytes),
+                  buffer.begin() + static_cast<std::ptrdiff_t>(availableBytes), buffer.begin());
+        carriedBytes = availableBytes - textBytes;
+    }
+}
+
+void ObjLoader::weld(const std::vector<Vertex> &corners, std::vector<Vertex> &vertices, std::vector<GLuint> &indices) {
+    const std::size_t cornerCount = corners.size();
+    constexpr std::size_t minChunkSize = 64 * 1024;
+
+    // corners are partitioned by hash into buckets, so that equal vertices always land in the same bucket
+    // and every bucket can be deduplicated independently. there are more buckets than threads to balance the load
+    std::size_t bucketCount = 1;
+    while (bucketCount < threadPool.getThreadCount() * 8) bucketCount *= 2;
+
+    std::vector<std::size_t> hashes(cornerCount);
+    threadPool.parallelFor(cornerCount, minChunkSize, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            hashes[i] = std::hash<Vertex>()(corners[i]);
+        }
+    });
+
+    // the top bits of the hash pick the bucket, so they don't correlate with the low bits used by the maps inside
+    const auto getBucket = [&](const std::size_t corner) {
+        return (hashes[corner] * 0x9E3779B97F4A7C15ull) >> 32 & (bucketCount - 1);
+    };
+
+    // counting sort of corner indices by bucket; within a bucket, corners stay in ascending order
+    const std::size_t sliceCount = threadPool.getThreadCount() * 4;
+    const std::size_t sliceSize = (cornerCount + sliceCount - 1) / sliceCount;
+    std::vector<std::size_t> bucketOffsets(sliceCount * bucketCount + 1);
+
+    threadPool.parallelFor(sliceCount, 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t slice = begin; slice < end; slice++) {
+            const std::size_t cornerEnd = std::min((slice + 1) * sliceSize, cornerCount);
+            for (std::size_t i = slice * sliceSize; i < cornerEnd; i++) {
+                bucketOffsets[getBucket(i) * sliceCount + slice + 1]++;
+            }
+        }
+    });
+
+    for (std::size_t i = 1; i < bucketOffsets.size(); i++) {
+        bucketOffsets[i] += bucketOffsets[i - 1];
+    }
+
+    std::vector<GLuint> sortedCorners(cornerCount);
+    threadPool.parallelFor(sliceCount, 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t slice = begin; slice < end; slice++) {
+            std::vector<std::size_t> cursors(bucketCount);
+            for (std::size_t bucket = 0; bucket < bucketCount; bucket++) {
+                cursors[bucket] = bucketOffsets[bucket * sliceCount + slice];
+            }
+
+            const std::size_t cornerEnd = std::min((slice + 1) * sliceSize, cornerCount);
+            for (std::size_t i = slice * sliceSize; i < cornerEnd; i++) {
+                sortedCorners[cursors[getBucket(i)]++] = static_cast<GLuint>(i);
+            }
+        }
+    });
+
+    hashes = {};
+
+    // for every corner, find the first corner with an equal vertex
+    std::vector<GLuint> firstOccurrence(cornerCount);
+    threadPool.parallelFor(bucketCount, 1, [&](const std::size_t begin, const std::size_t end) {
+        VertexWelder welder;
+        const auto getCorner = [&](const GLuint corner) -> const Vertex & { return corners[corner]; };
+
+        for (std::size_t bucket = begin; bucket < end; bucket++) {
+            const std::size_t bucketBegin = bucketOffsets[bucket * sliceCount];
+            const std::size_t bucketEnd = bucketOffsets[(bucket + 1) * sliceCount];
+
+            welder.reset(bucketEnd - bucketBegin);
+
+            for (std::size_t i = bucketBegin; i < bucketEnd; i++) {
+                const GLuint corner = sortedCorners[i];
+                firstOccurrence[corner] = welder.weld(corners[corner], corner, getCorner);
+            }
+        }
+    });
+
+    sortedCorners = {};
+
+    // number the first occurrences in file order: count them per slice, then prefix-sum the counts
+    std::vector<std::size_t> sliceVertexBases(sliceCount + 1);
+    threadPool.parallelFor(sliceCount, 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t slice = begin; slice < end; slice++) {
+            const std::size_t cornerEnd = std::min((slice + 1) * sliceSize, cornerCount);
+            for (std::size_t i = slice * sliceSize; i < cornerEnd; i++) {
+                if (firstOccurrence[i] == i) sliceVertexBases[slice + 1]++;
+            }
+        }
+    });
+
+    for (std::size_t i = 1; i < sliceVertexBases.size(); i++) {
+        sliceVertexBases[i] += sliceVertexBases[i - 1];
+    }
+
+    vertices.resize(sliceVertexBases.back());
+    indices.resize(cornerCount);
+
+    threadPool.parallelFor(sliceCount, 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t slice = begin; slice < end; slice++) {
+            GLuint nextIndex = static_cast<GLuint>(sliceVertexBases[slice]);
+
+            const std::size_t cornerEnd = std::min((slice + 1) * sliceSize, cornerCount);
+            for (std::size_t i = slice * sliceSize; i < cornerEnd; i++) {
+                if (firstOccurrence[i] == i) {
+                    vertices[nextIndex] = corners[i];
+                    indices[i] = nextIndex++;
+                }
+            }
+        }
+    });
+
+    // every other corner takes the index of its first occurrence, which is final by now
+    threadPool.parallelFor(cornerCount, minChunkSize, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            if (firstOccurrence[i] != i) {
+                indices[i] = indices[firstOccurrence[i]];
+            }
+        }
+    });
+}
@@ -0,0 +1,98 @@
+#ifndef OBJ_LOADER_HPP
+#define OBJ_LOADER_HPP
+
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "utilities/thread-pool.hpp"
+#include "vertex.hpp"
+
+struct ObjChunk;
+
+/**
+ * Material of an OBJ file, as described by its MTL library. Only the parts we can render are kept.
+ */
+struct ObjMaterial {
+    std::string name;
+    glm::vec3 diffuseColor{1.0f};
+    std::filesystem::path diffuseTexture; // empty if the material has none
+    std::filesystem::path normalTexture; // tangent-space, empty if the material has none
+};
+
+/**
+ * A run of consecutive faces of an OBJ file belonging to the same object (or group) and using the same material.
+ */
+struct ObjSubmesh {
+    std::string name;
+    std::size_t materialIndex;
+    std::size_t firstIndex;
+    std::size_t indexCount;
+};
+
+/**
+ * Parallel loader for Wavefront OBJ files.
+ *
+ * The file is split into line-aligned chunks which are parsed concurrently, and the resulting face corners
+ * are then welded into unique vertices, also in parallel. Triangles and quads are triangulated the same way
+ * tinyobjloader does it, and vertices are numbered in order of their first occurrence, so for files made of those
+ * the output is identical to parsing the file with tinyobjloader and welding it sequentially.
+ *
+ * Polygons with five or more vertices are where the two differ -- they're assumed to be convex and fanned out from
+ * their first vertex, while tinyobjloader ear-clips them. Convex ones end up split into different, but equivalent,
+ * triangles. Concave ones may come out wrong, with triangles covering parts outside of the polygon.
+ */
+class ObjLoader {
+    ThreadPool &threadPool;
+
+public:
+    /**
+     * Receives the vertices first referenced in a block of the file, and the indices of the block's triangles.
+     */
+    using StreamCallback = std::function<void(std::span<const Vertex> vertices, std::span<const GLuint> indices)>;
+
+    explicit ObjLoader(ThreadPool &pool) : threadPool(pool) {}
+
+    /**
+     * Loads the mesh from the given file, replacing the contents of all the output vectors.
+     * Every face corner is required to have a texture coordinate.
+     *
+     * All objects and groups of the file end up in the same vertex and index arrays. `submeshes` cover all indices,
+     * in file order, and a new submesh starts wherever the object, group or material changes. Materials are read
+     * from the MTL libraries referenced by the file. Materials which can't be found (and faces without any)
+     * get a plain white material.
+     */
+    void load(const std::filesystem::path &path, std::vector<Vertex> &vertices, std::vector<GLuint> &indices,
+              std::vector<ObjSubmesh> &submeshes, std::vector<ObjMaterial> &materials);
+
+    /**
+     * Loads the mesh from the given file in fixed-size blocks, for files too large to be loaded all at once.
+     * The vertices and indices are identical to those of `load` (objects, groups and materials are ignored), but
+     * they're handed to `onBlock` piece by piece as each block is parsed and welded -- the vertices in order of
+     * their ids, and the indices in order.
+     *
+     * Memory use doesn't grow with the number of faces, but it does grow with the number of unique positions,
+     * texture coordinates and vertices -- all of them have to stay at hand, as any later face may refer to them.
+     * That's 12 bytes per position, 8 per texture coordinate, and 24 to 40 per welded vertex. For most meshes, that
+     * still grows with the size of the file, just at a fraction of the rate -- a file whose unique vertices don't
+     * fit in memory can't be streamed either.
+     */
+    void stream(const std::filesystem::path &path, const StreamCallback &onBlock);
+
+    /**
+     * Deduplicates the given face corners, writing the unique vertices in order of their first occurrence
+     * and an index per corner. Exposed separately so it can be used on corners coming from other sources.
+     */
+    void weld(const std::vector<Vertex> &corners, std::vector<Vertex> &vertices, std::vector<GLuint> &indices);
+
+private:
+    std::vector<ObjChunk> parseChunks(std::string_view text);
+};
+
+#endif //OBJ_LOADER_HPP
@@ -0,0 +1,244 @@
+#include "record-codec.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "entropy-coder.hpp"
+
+// records are coded in independent chunks of about this size. large enough to make up for what every plane costs
+// regardless of its size -- its code table, and building the decoding table -- while still splitting large meshes
+// into enough chunks to keep every thread busy
+static constexpr std::size_t CHUNK_BYTES = 1024 * 1024;
+
+static constexpr std::size_t PLANE_COUNT = sizeof(std::uint32_t);
+
+enum class ChunkMode : std::uint8_t {
+    STORED = 0,
+    FILTERED = 1,
+};
+
+enum class ColumnFilter : std::uint8_t {
+    NONE = 0,
+    DELTA = 1,
+    XOR = 2,
+};
+
+static constexpr ColumnFilter COLUMN_FILTERS[] = {ColumnFilter::NONE, ColumnFilter::DELTA, ColumnFilter::XOR};
+
+static std::size_t getChunkRecordCount(const std::size_t recordSize) {
+    return std::max<std::size_t>(CHUNK_BYTES / recordSize, 1);
+}
+
+static std::uint32_t encodeZigzag(const std::uint32_t value) {
+    return (value << 1) ^ (0u - (value >> 31));
+}
+
+static std::uint32_t decodeZigzag(const std::uint32_t value) {
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+static void checkRecordSize(const std::size_t recordSize) {
+    if (recordSize == 0 || recordSize % sizeof(std::uint32_t) != 0) {
+        throw std::runtime_error("record size must be a non-zero multiple of 4 bytes");
+    }
+}
+
+/**
+ * Filters a column of words and codes its byte planes, appending them to `output`.
+ */
+static void encodeColumn(const std::span<const std::uint32_t> column, const ColumnFilter filter,
+                         std::vector<std::uint8_t> &planes, std::vector<std::uint8_t> &output) {
+    const std::size_t count = column.size();
+    planes.resize(PLANE_COUNT * count);
+
+    std::uint32_t previous = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        const std::uint32_t word = column[i];
+        const std::uint32_t filtered = filter == ColumnFilter::DELTA ? encodeZigzag(word - previous)
+                                       : filter == ColumnFilter::XOR ? word ^ previous
+                                       : word;
+        previous = word;
+
+        for (std::size_t plane = 0; plane < PLANE_COUNT; plane++) {
+            planes[plane * count + i] = static_cast<std::uint8_t>(filtered >> (8 * plane));
+        }
+    }
+
+    for (std::size_t plane = 0; plane < PLANE_COUNT; plane++) {
+        entropyEncode(std::span(planes).subspan(plane * count, count), output);
+    }
+}
+
+static void encodeChunk(const std::span<const std::byte> records, const std::size_t recordSize,
+                        std::vector<std::uint8_t> &output) {
+    const std::size_t wordCount = recordSize / sizeof(std::uint32_t);
+    const std::size_t count = records.size() / recordSize;
+
+    std::vector<std::uint32_t> column(count);
+    std::vector<std::uint8_t> planes;
+    std::vector<std::uint8_t> bestColumn;
+    std::vector<std::uint8_t> candidate;
+
+    // every column's filter goes first, followed by the planes of all columns
+    output.resize(1 + wordCount);
+    output[0] = static_cast<std::uint8_t>(ChunkMode::FILTERED);
+
+    for (std::size_t word = 0; word < wordCount; word++) {
+        for (std::size_t i = 0; i < count; i++) {
+            std::memcpy(&column[i], records.data() + i * recordSize + word * sizeof(std::uint32_t),
+                        sizeof(std::uint32_t));
+        }
+
+        bestColumn.clear();
+        for (const ColumnFilter filter : COLUMN_FILTERS) {
+            candidate.clear();
+            encodeColumn(column, filter, planes, candidate);
+
+            if (bestColumn.empty() || candidate.size() < bestColumn.size()) {
+                std::swap(bestColumn, candidate);
+                output[1 + word] = static_cast<std::uint8_t>(filter);
+            }
+        }
+
+        output.insert(output.end(), bestColumn.begin(), bestColumn.end());
+    }
+
+    // every plane costs a few bytes even when it's constant, which only pays off once there are enough records
+    if (output.size() > 1 + records.size()) {
+        const auto *bytes = reinterpret_cast<const std::uint8_t *>(records.data());
+        output.assign(1, static_cast<std::uint8_t>(ChunkMode::STORED));
+        output.insert(output.end(), bytes, bytes + records.size());
+    }
+}
+
+static void decodeChunk(const std::span<const std::uint8_t> input, const std::span<std::byte> records,
+                        const std::size_t recordSize) {
+    const std::size_t wordCount = recordSize / sizeof(std::uint32_t);
+    const std::size_t count = records.size() / recordSize;
+
+    if (input.empty()) {
+        throw std::runtime_error("malformed record chunk: missing header");
+    }
+
+    if (static_cast<ChunkMode>(input[0]) == ChunkMode::STORED) {
+        if (input.size() != 1 + records.size()) {
+            throw std::runtime_error("malformed record chunk: wrong size of stored chunk");
+        }
+
+        std::memcpy(records.data(), input.data() + 1, records.size());
+        return;
+    }
+
+    if (static_cast<ChunkMode>(input[0]) != ChunkMode::FILTERED || input.size() < 1 + wordCount) {
+        throw std::runtime_error("malformed record chunk: truncated header");
+    }
+
+    const std::span<const std::uint8_t> filters = input.subspan(1, wordCount);
+    std::vector<std::uint8_t> planes(PLANE_COUNT * count);
+    std::size_t position = 1 + wordCount;
+
+    for (std::size_t word = 0; word < wordCount; word++) {
+        for (std::size_t plane = 0; plane < PLANE_COUNT; plane++) {
+            position += entropyDecode(input.subspan(position), std::span(planes).subspan(plane * count, count));
+        }
+
+        const std::uint8_t *plane0 = planes.data();
+        const std::uint8_t *plane1 = plane0 + count;
+        const std::uint8_t *plane2 = plane1 + count;
+        const std::uint8_t *plane3 = plane2 + count;
+        std::byte *destination = records.data() + word * sizeof(std::uint32_t);
+
+        // undoing the filter is a running sum over the column, so each filter gets its own tight loop
+        const auto unfilter = [&](const auto &combine) {
+            std::uint32_t previous = 0;
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint32_t filtered = plane0[i] | plane1[i] << 8 | plane2[i] << 16
+                                               | static_cast<std::uint32_t>(plane3[i]) << 24;
+                previous = combine(previous, filtered);
+                std::memcpy(destination + i * recordSize, &previous, sizeof(previous));
+            }
+        };
+
+        switch (static_cast<ColumnFilter>(filters[word])) {
+            case ColumnFilter::NONE:
+                unfilter([](std::uint32_t, const std::uint32_t filtered) { return filtered; });
+                break;
+            case ColumnFilter::DELTA:
+                unfilter([](const std::uint32_t previous, const std::uint32_t filtered) {
+                    return previous + decodeZigzag(filtered);
+                });
+                break;
+            case ColumnFilter::XOR:
+                unfilter([](const std::uint32_t previous, const std::uint32_t filtered) {
+                    return previous ^ filtered;
+                });
+                break;
+            default:
+                throw std::runtime_error("malformed record chunk: unknown filter");
+        }
+    }
+}
+
+void encodeRecords(ThreadPool &threadPool, const std::span<const std::byte> records, const std::size_t recordSize,
+                   std::vector<std::uint8_t> &output) {
+    checkRecordSize(recordSize);
+
+    const std::size_t chunkBytes = getChunkRecordCount(recordSize) * recordSize;
+    const std::size_t chunkCount = (records.size() + chunkBytes - 1) / chunkBytes;
+    std::vector<std::vector<std::uint8_t>> chunks(chunkCount);
+
+    threadPool.parallelFor(chunkCount, 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            encodeChunk(records.subspan(i * chunkBytes, std::min(chunkBytes, records.size() - i * chunkBytes)),
+                        recordSize, chunks[i]);
+        }
+    });
+
+    // the sizes of all chunks go first, so the decoder can find each one without decoding the ones before it
+    for (const std::vector<std::uint8_t> &chunk : chunks) {
+        const auto chunkSize = static_cast<std::uint32_t>(chunk.size());
+        const auto *sizeBytes = reinterpret_cast<const std::uint8_t *>(&chunkSize);
+        output.insert(output.end(), sizeBytes, sizeBytes + sizeof(chunkSize));
+    }
+
+    for (const std::vector<std::uint8_t> &chunk : chunks) {
+        output.insert(output.end(), chunk.begin(), chunk.end());
+    }
+}
+
+void decodeRecords(ThreadPool &threadPool, const std::span<const std::uint8_t> input,
+                   const std::span<std::byte> records, const std::size_t recordSize) {
+    checkRecordSize(recordSize);
+    if (records.size() % recordSize != 0) {
+        throw std::runtime_error("record array size must be a multiple of the record size");
+    }
+
+    const std::size_t chunkBytes = getChunkRecordCount(recordSize) * recordSize;
+    const std::size_t chunkCount = (records.size() + chunkBytes - 1) / chunkBytes;
+
+    if (input.size() / sizeof(std::uint32_t) < chunkCount) {
+        throw std::runtime_error("malformed record stream: truncated chunk table");
+    }
+
+    std::vector<std::size_t> chunkOffsets(chunkCount + 1);
+    chunkOffsets[0] = chunkCount * sizeof(std::uint32_t);
+
+    for (std::size_t i = 0; i < chunkCount; i++) {
+        std::uint32_t chunkSize;
+        std::memcpy(&chunkSize, input.data() + i * sizeof(std::uint32_t), sizeof(chunkSize));
+        chunkOffsets[i + 1] = chunkOffsets[i] + chunkSize;
+    }
+
+    if (chunkOffsets.back() > input.size()) {
+        throw std::runtime_error("malformed record stream: truncated chunks");
+    }
+
+    threadPool.parallelFor(chunkCount, 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            decodeChunk(input.subspan(chunkOffsets[i], chunkOffsets[i + 1] - chunkOffsets[i]),
+                        records.subspan(i * chunkBytes, std::min(chunkBytes, records.size() - i * chunkBytes)),
+                        recordSize);
+        }
+    });
+}
@@ -0,0 +1,33 @@
+#ifndef RECORD_CODEC_HPP
+#define RECORD_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "utilities/thread-pool.hpp"
+
+/**
+ * Appends the compressed form of an array of fixed-size records, e.g. vertices or indices, to `output`. The record
+ * size must be a multiple of 4 bytes.
+ *
+ * Records are seen as rows of 32-bit words. The array is split into chunks which are coded independently, so
+ * they can be decoded in parallel. Within a chunk, every column of words is filtered on its own -- replaced by
+ * zigzag-coded differences to the previous row, by its bitwise difference to it, or left as-is, whichever ends
+ * up smallest. Neighbouring records tend to be similar, e.g. indices after vertex cache optimization or vertices
+ * after fetch optimization, so this leaves small numbers whose high bytes are mostly zero. Every column is then
+ * split into planes of its first, second, third and fourth bytes, and every plane is entropy-coded separately,
+ * as their statistics are very different.
+ */
+void encodeRecords(ThreadPool &threadPool, std::span<const std::byte> records, std::size_t recordSize,
+                   std::vector<std::uint8_t> &output);
+
+/**
+ * Decodes records written by `encodeRecords`, filling the whole of `records`, whose size must be that of the
+ * original array. Throws if the input is malformed.
+ */
+void decodeRecords(ThreadPool &threadPool, std::span<const std::uint8_t> input, std::span<std::byte> records,
+                   std::size_t recordSize);
+
+#endif //RECORD_CODEC_HPP
@@ -1,24 +1,161 @@
 #include "renderer.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <map>
 #include <stdexcept>
 #include <iostream>
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <utility>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_transform.hpp>
+#include <glm/gtx/hash.hpp>
 
 #include <stb_image.h>
 
-#include <tiny_obj_loader.h>
-
 #include "utilities/debug.hpp"
+#include "utilities/gl-state.hpp"
+#include "utilities/process-memory.hpp"
+#include "mesh-optimizer.hpp"
+#include "mesh-simplifier.hpp"
+#include "meshlet.hpp"
+#include "obj-loader.hpp"
+#include "tangent-frames.hpp"
+#include "vertex-welder.hpp"
 #include "vertex.hpp"
 
-OpenGLRenderer::OpenGLRenderer(const int windowWidth, const int windowHeight) {
+// optional steps of mesh cooking -- changing these causes the mesh to be recooked on the next run
+static constexpr std::uint32_t MESH_COOK_FLAGS = MESH_COOK_OPTIMIZE_OVERDRAW;
+
+// source meshes larger than this are streamed straight into the cache instead of being fully cooked in memory
+static constexpr std::uintmax_t MESH_STREAMING_THRESHOLD_BYTES = std::uintmax_t{1} << 30;
+
+// cooked meshes are also written to a compressed cache, a fraction of the size of the plain one, which is loaded
+// instead of it whenever it's present. shipped builds only need to carry that one
+static constexpr bool IS_MESH_CACHE_COMPRESSED = true;
+
+// quality textures are block-compressed with when they're cooked, trading cooking time for quality. textures are
+// cooked uncompressed when this is empty
+static constexpr std::optional<BlockQuality> TEXTURE_COMPRESSION = BlockQuality::BALANCED;
+
+// how vertices are stored on the GPU
+static constexpr VertexFormat VERTEX_FORMAT = VertexFormat::QUANTIZED;
+
+// fractions of the full-detail mesh's triangles kept by each of the coarser LODs
+static constexpr float LOD_TRIANGLE_RATIOS[] = {0.5f, 0.25f, 0.1f};
+
+// a coarser LOD is used once its geometric error projects to at most this many pixels
+static constexpr float MAX_LOD_SCREEN_ERROR = 1.0f;
+
+// used by materials which don't have a texture of their own
+static const std::filesystem::path DEFAULT_TEXTURE_PATH = "../assets/textures/kettle-albedo.png";
+static const std::filesystem::path DEFAULT_NORMAL_TEXTURE_PATH = "../assets/textures/kettle-normal.png";
+
+// a tangent-space normal pointing straight out of the surface, for materials which have a color texture but no
+// normal map
+static constexpr unsigned char FLAT_NORMAL_TEXEL[] = {128, 128, 255, 255};
+
+// how long the render thread may spend uploading assets each frame, so that loading never causes a visible hitch
+static constexpr std::chrono::microseconds ASSET_UPLOAD_BUDGET{2000};
+
+// assets are uploaded in slices of this size, checking the time budget after each one
+static constexpr std::size_t ASSET_UPLOAD_SLICE_BYTES = 256 * 1024;
+
+// textures are streamed through a ring of this many pixel buffers of this size, see `TextureUploadRing`. a segment
+// has to fit at least a single row of blocks of the widest texture
+static constexpr std::size_t TEXTURE_UPLOAD_SEGMENT_COUNT = 4;
+static constexpr std::size_t TEXTURE_UPLOAD_SEGMENT_BYTES = 1024 * 1024;
+
+// textures may take at most this much memory on the GPU, see `TextureManager`. it can be halved and doubled at
+// runtime to see textures being trimmed and evicted
+static constexpr std::size_t TEXTURE_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+// the normal-mapped shaders light the mesh with a single directional light, shining from this direction
+static const glm::vec3 LIGHT_DIRECTION = glm::normalize(glm::vec3(0.4f, 1.0f, 0.6f));
+
+// the loaded mesh is actually really small so we'll scale it up for convenience
+static glm::mat4 getModelMatrix() {
+    return glm::scale(glm::identity<glm::mat4>(), glm::vec3(10.0f));
+}
+
+static std::span<const GLuint> getFullDetailIndices(const CachedMesh &mesh) {
+    return mesh.getIndices().first(mesh.getLods()[0].indexCount);
+}
+
+// the hash vertices were welded with before `VertexWelder`, kept as a baseline for `benchmarkVertexWelding`
+struct LegacyVertexHash {
+    std::size_t operator()(const Vertex &vertex) const noexcept {
+        return (std::hash<glm::vec3>()(vertex.position) >> 1) ^ (std::hash<glm::vec2>()(vertex.uv) << 1);
+    }
+};
+
+// welds corners the way `loadMesh` used to, numbering vertices in order of their first occurrence
+template<typename GetCorner>
+static void weldWithMap(const std::size_t cornerCount, GetCorner &&getCorner, std::vector<GLuint> &indices) {
+    std::unordered_map<Vertex, GLuint, LegacyVertexHash> vertexToIndex;
+    GLuint nextIndex = 0;
+
+    for (std::size_t i = 0; i < cornerCount; i++) {
+        const Vertex &corner = getCorner(i);
+
+        // one probe to check for the vertex, and another one to get its index
+        if (!vertexToIndex.contains(corner)) {
+            vertexToIndex.emplace(corner, nextIndex++);
+        }
+
+        indices.push_back(vertexToIndex.at(corner));
+    }
+}
+
+// the same as `weldWithMap`, just with a `VertexWelder`
+template<typename GetCorner>
+static void weldWithWelder(const std::size_t cornerCount, GetCorner &&getCorner, std::vector<GLuint> &indices) {
+    VertexWelder welder(cornerCount);
+    std::vector<Vertex> vertices;
+    const auto getVertex = [&](const GLuint id) -> const Vertex & { return vertices[id]; };
+
+    for (std::size_t i = 0; i < cornerCount; i++) {
+        const Vertex &corner = getCorner(i);
+        const GLuint id = welder.weld(corner, static_cast<GLuint>(vertices.size()), getVertex);
+
+        if (id == vertices.size()) {
+            vertices.push_back(corner);
+        }
+
+        indices.push_back(id);
+    }
+}
+
+// maps clip space to the mesh's object space, as seen from the given camera
+static glm::mat4 getClipToObjectMatrix(const Camera &camera) {
+    return glm::inverse(camera.getPerspectiveMatrix() * camera.getViewMatrix() * getModelMatrix());
+}
+
+/**
+ * Ray through a point on the screen, given in normalized device coordinates, starting on the near plane and
+ * reaching the far plane at a distance of 1.
+ */
+static void getScreenRay(const glm::mat4 &clipToObject, const glm::vec2 &ndc, glm::vec3 &origin,
+                         glm::vec3 &direction) {
+    const glm::vec4 nearPoint = clipToObject * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+    const glm::vec4 farPoint = clipToObject * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+
+    origin = glm::vec3(nearPoint) / nearPoint.w;
+    direction = glm::vec3(farPoint) / farPoint.w - origin;
+}
+
+OpenGLRenderer::OpenGLRenderer(const int windowWidth, const int windowHeight)
+    : startTime(std::chrono::steady_clock::now()) {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -50,13 +187,13 @@ OpenGLRenderer::OpenGLRenderer(const int windowWidth, const int windowHeight) {
 
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
-    glEnable(GL_DEPTH_TEST);
+    getGLState().enable(GL_DEPTH_TEST);
 
     // face culling -- to optimize the rendering process a little bit
     glCullFace(GL_BACK);
-    glEnable(GL_CULL_FACE);
+    getGLState().enable(GL_CULL_FACE);
 
-    glEnable(GL_DEBUG_OUTPUT);
+    getGLState().enable(GL_DEBUG_OUTPUT);
 #ifndef __APPLE__
     glDebugMessageCallback(reinterpret_cast<GLDEBUGPROC>(&debugCallback), nullptr);
 #endif
@@ -70,17 +207,41 @@ OpenGLRenderer::OpenGLRenderer(const int windowWidth, const int windowHeight) {
         "../6-loaded/shaders/main.frag"
     );
 
+    overdrawShaders = std::make_unique<GLShaders>(
+        "../6-loaded/shaders/main.vert",
+        "../6-loaded/shaders/overdraw.frag"
+    );
+
+    normalMappedShaders = std::make_unique<GLShaders>(
+        "../6-loaded/shaders/normal-mapped.vert",
+        "../6-loaded/shaders/normal-mapped.frag"
+    );
+
+    frameUniforms = std::make_unique<UniformBuffer<FrameUniforms>>();
+    objectUniforms = std::make_unique<UniformBuffer<ObjectUniforms>>();
+
     camera = std::make_unique<Camera>(window);
 
-    loadMesh();
-    prepareBuffers();
+    threadPool = std::make_unique<ThreadPool>();
+
+    // S3TC isn't part of core GL, even though every desktop driver has it. without it textures stay uncompressed
+    const std::optional<BlockQuality> textureCompression = GLEW_EXT_texture_compression_s3tc
+                                                               ? TEXTURE_COMPRESSION
+                                                               : std::nullopt;
 
-    loadTextures();
+    // nothing is drawn until the assets arrive, but the window is up and responsive in the meantime
+    ThreadPool &pool = *threadPool;
+    pendingAssets = threadPool->submit([&pool, textureCompression] { return loadAssets(pool, textureCompression); });
 }
 
 OpenGLRenderer::~OpenGLRenderer() {
-    glDeleteBuffers(1, &vbo);
-    glDeleteVertexArrays(1, &vao);
+    indexBuffer.reset(); // has to go while the context is still alive
+    frameUniforms.reset();
+    objectUniforms.reset();
+    textureUploadRing.reset();
+    textureManager.reset();
+    getGLState().deleteBuffer(vbo);
+    getGLState().deleteVertexArray(vao);
     glfwDestroyWindow(window);
     glfwTerminate();
 }
@@ -96,11 +257,191 @@ void OpenGLRenderer::tickInputEvents() {
                 "../6-loaded/shaders/main.vert",
                 "../6-loaded/shaders/main.frag"
             );
+            normalMappedShaders = std::make_unique<GLShaders>(
+                "../6-loaded/shaders/normal-mapped.vert",
+                "../6-loaded/shaders/normal-mapped.frag"
+            );
         }
         wasPressedLastFrame = true;
     } else {
         wasPressedLastFrame = false;
     }
+
+    // everything below needs the mesh
+    if (!isMeshReady) {
+        return;
+    }
+
+    // measure overdraw
+    static bool wasOverdrawKeyPressedLastFrame = false;
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS) {
+        if (!wasOverdrawKeyPressedLastFrame) {
+            measureOverdraw();
+        }
+        wasOverdrawKeyPressedLastFrame = true;
+    } else {
+        wasOverdrawKeyPressedLastFrame = false;
+    }
+
+    // benchmark vertex formats
+    static bool wasBenchmarkKeyPressedLastFrame = false;
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) {
+        if (!wasBenchmarkKeyPressedLastFrame) {
+            benchmarkVertexFormats();
+        }
+        wasBenchmarkKeyPressedLastFrame = true;
+    } else {
+        wasBenchmarkKeyPressedLastFrame = false;
+    }
+
+    // toggle meshlet culling
+    static bool wasCullingKeyPressedLastFrame = false;
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) {
+        if (!wasCullingKeyPressedLastFrame) {
+            isMeshletCullingEnabled = !isMeshletCullingEnabled;
+            std::cout << "Meshlet culling " << (isMeshletCullingEnabled ? "enabled" : "disabled") << ", "
+                    << visibleMeshletCount << " / " << meshletCuller->getMeshletCount()
+                    << " meshlets were visible in the last frame\n";
+        }
+        wasCullingKeyPressedLastFrame = true;
+    } else {
+        wasCullingKeyPressedLastFrame = false;
+    }
+
+    // pick the triangle under the cursor
+    static bool wasPickingButtonPressedLastFrame = false;
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+        if (!wasPickingButtonPressedLastFrame) {
+            pickTriangle();
+        }
+        wasPickingButtonPressedLastFrame = true;
+    } else {
+        wasPickingButtonPressedLastFrame = false;
+    }
+
+    // benchmark ray queries
+    static bool wasRayBenchmarkKeyPressedLastFrame = false;
+    if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS) {
+        if (!wasRayBenchmarkKeyPressedLastFrame) {
+            benchmarkRayQueries();
+        }
+        wasRayBenchmarkKeyPressedLastFrame = true;
+    } else {
+        wasRayBenchmarkKeyPressedLastFrame = false;
+    }
+
+    // benchmark vertex welding
+    static bool wasWeldingBenchmarkKeyPressedLastFrame = false;
+    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) {
+        if (!wasWeldingBenchmarkKeyPressedLastFrame) {
+            benchmarkVertexWelding();
+        }
+        wasWeldingBenchmarkKeyPressedLastFrame = true;
+    } else {
+        wasWeldingBenchmarkKeyPressedLastFrame = false;
+    }
+
+    // benchmark uniform lookups
+    static bool wasUniformBenchmarkKeyPressedLastFrame = false;
+    if (glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS) {
+        if (!wasUniformBenchmarkKeyPressedLastFrame) {
+            benchmarkUniformLookups();
+        }
+        wasUniformBenchmarkKeyPressedLastFrame = true;
+    } else {
+        wasUniformBenchmarkKeyPressedLastFrame = false;
+    }
+
+    // print what the texture manager has been doing since the last time
+    static bool wasTextureStatsKeyPressedLastFrame = false;
+    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS) {
+        if (!wasTextureStatsKeyPressedLastFrame) {
+            printTextureStats();
+        }
+        wasTextureStatsKeyPressedLastFrame = true;
+    } else {
+        wasTextureStatsKeyPressedLastFrame = false;
+    }
+
+    // print how many GL calls the shadow state has let through and skipped since the last time
+    static bool wasGLStateStatsKeyPressedLastFrame = false;
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS) {
+        if (!wasGLStateStatsKeyPressedLastFrame) {
+            printGLStateStats();
+        }
+        wasGLStateStatsKeyPressedLastFrame = true;
+    } else {
+        wasGLStateStatsKeyPressedLastFrame = false;
+    }
+
+    // halve or double the texture memory budget
+    static bool wasBudgetKeyPressedLastFrame = false;
+    const bool isShrinkKeyPressed = glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS;
+    const bool isGrowKeyPressed = glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS;
+    if (isShrinkKeyPressed || isGrowKeyPressed) {
+        if (!wasBudgetKeyPressedLastFrame) {
+            const std::size_t budget = textureManager->getBudgetBytes();
+            textureManager->setBudgetBytes(isShrinkKeyPressed ? budget / 2 : budget * 2);
+            std::cout << "Texture memory budget set to " << textureManager->getBudgetBytes() / 1024 << " KB\n";
+        }
+        wasBudgetKeyPressedLastFrame = true;
+    } else {
+        wasBudgetKeyPressedLastFrame = false;
+    }
+
+    // toggle normal mapping
+    static bool wasNormalMappingKeyPressedLastFrame = false;
+    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS) {
+        if (!wasNormalMappingKeyPressedLastFrame) {
+            if (mesh->getCookFlags() & MESH_COOK_STREAMED) {
+                std::cout << "Streamed meshes have no tangent frames, normal mapping is unavailable\n";
+            } else {
+                isNormalMappingEnabled = !isNormalMappingEnabled;
+                std::cout << "Normal mapping " << (isNormalMappingEnabled ? "enabled" : "disabled") << "\n";
+            }
+        }
+        wasNormalMappingKeyPressedLastFrame = true;
+    } else {
+        wasNormalMappingKeyPressedLastFrame = false;
+    }
+}
+
+void OpenGLRenderer::printTextureStats() {
+    const TextureManagerStats stats = textureManager->takeStats();
+    const std::size_t useCount = stats.hitCount + stats.missCount;
+
+    std::cout << "Texture arrays: " << textureManager->getResidentArrayCount() << " / "
+            << textureManager->getArrayCount() << " resident, " << textureManager->getResidentBytes() / 1024
+            << " KB of a " << textureManager->getBudgetBytes() / 1024 << " KB budget\n";
+    std::cout << "\t" << stats.hitCount << " hits, " << stats.missCount << " misses ("
+            << (useCount ? static_cast<double>(stats.hitCount) / useCount * 100.0 : 100.0) << "% hit rate), "
+            << stats.evictionCount << " evictions, " << stats.trimmedLevelCount << " levels trimmed, "
+            << stats.reloadCount << " reloads (" << stats.reloadedBytes / 1024 << " KB)\n";
+    std::cout << "\tPacked into " << textureManager->getArrayCount() << " arrays, the last frame bound "
+            << textureBindCount << " of them for " << drawBatchCount << " batches\n";
+}
+
+void OpenGLRenderer::printGLStateStats() {
+    static constexpr std::array<std::pair<GLStateCall, const char *>, 6> CALL_NAMES = {{
+        {GLStateCall::PROGRAM, "program"},
+        {GLStateCall::VERTEX_ARRAY, "vertex array"},
+        {GLStateCall::BUFFER, "buffer"},
+        {GLStateCall::TEXTURE, "texture"},
+        {GLStateCall::CAPABILITY, "capability"},
+        {GLStateCall::UNIFORM, "uniform"},
+    }};
+
+    const GLStateStats stats = getGLState().takeStats();
+
+    std::cout << "GL state changes, issued / skipped as redundant:\n";
+    for (const auto &[call, name] : CALL_NAMES) {
+        const std::size_t issuedCount = stats.getIssuedCount(call);
+        const std::size_t skippedCount = stats.getSkippedCount(call);
+        const std::size_t totalCount = issuedCount + skippedCount;
+
+        std::cout << "\t" << name << ": " << issuedCount << " / " << skippedCount << " ("
+                << (totalCount ? static_cast<double>(skippedCount) / totalCount * 100.0 : 0.0) << "% skipped)\n";
+    }
 }
 
 void OpenGLRenderer::startRendering() {
@@ -108,142 +449,1166 @@ void OpenGLRenderer::startRendering() {
 }
 
 void OpenGLRenderer::render() {
-    shaders->enable();
+    tickAssetUpload();
+    if (!isMeshReady) {
+        return;
+    }
 
-    // the loaded mesh is actually really small so we'll scale it up for convenience
-    shaders->setUniform("model", glm::scale(glm::identity<glm::mat4>(), glm::vec3(10.0f)));
-    shaders->setUniform("view", camera->getViewMatrix());
-    shaders->setUniform("projection", camera->getPerspectiveMatrix());
-    shaders->setUniform("colorTexture", 0);
+    GLShaders &shadingShaders = getShadingShaders();
+    shadingShaders.enable();
 
-    glDrawElements(GL_TRIANGLES, meshIndices.size(), GL_UNSIGNED_INT, 0);
+    updateUniformBuffers();
+    shadingShaders.setUniform("colorTexture", 0);
+
+    if (isNormalMappingEnabled) {
+        shadingShaders.setUniform("normalTexture", 1);
+    }
+
+    drawMesh(true);
+
+    textureManager->endFrame();
 }
 
-void OpenGLRenderer::finishRendering() const {
+void OpenGLRenderer::finishRendering() {
     glfwSwapBuffers(window);
     glfwPollEvents();
+
+    if (!isFirstFramePresented) {
+        isFirstFramePresented = true;
+
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+        std::cout << "First frame presented after " << elapsed.count() << " ms\n";
+    }
+}
+
+void OpenGLRenderer::drawMesh(const bool isShaded) {
+    getGLState().bindVertexArray(vao);
+
+    const std::size_t lod = selectLod();
+    if (lod != currentLod) {
+        currentLod = lod;
+        std::cout << "Switched to mesh LOD " << lod << " (" << mesh->getLods()[lod].indexCount / 3 << " triangles)\n";
+    }
+
+    // coarser LODs aren't split into meshlets -- they're only used when the whole mesh is small on screen anyway.
+    // streamed meshes have no meshlets at all, so there's nothing to cull them with
+    const bool isCulled = lod == 0 && isMeshletCullingEnabled && meshletCuller->getMeshletCount() > 0;
+
+    if (isCulled) {
+        // meshlet bounds live in the mesh's original object space, before vertex quantization
+        const glm::mat4 objectToClip = camera->getPerspectiveMatrix() * camera->getViewMatrix() * getModelMatrix();
+        const glm::vec3 cameraPosition(glm::inverse(getModelMatrix()) * glm::vec4(camera->getPosition(), 1.0f));
+
+        visibleMeshletCount = meshletCuller->cull(objectToClip, cameraPosition, visibleRanges);
+    } else {
+        visibleMeshletCount = lod == 0 ? meshletCuller->getMeshletCount() : 0;
+    }
+
+    const MeshLod &lodRange = mesh->getLods()[lod];
+    const std::span<const MeshSubmesh> submeshes = mesh->getSubmeshes().subspan(lodRange.firstSubmesh,
+                                                                                 lodRange.submeshCount);
+    auto visibleRange = visibleRanges.cbegin();
+
+    // set for every batch, so they're looked up just once here
+    UniformHandle<glm::vec3> diffuseColor;
+    UniformHandle<GLint> colorLayerUniform, normalLayerUniform;
+
+    if (isShaded) {
+        diffuseColor = getShadingShaders().getUniform<glm::vec3>("diffuseColor");
+        colorLayerUniform = getShadingShaders().getUniform<GLint>("colorLayer");
+
+        if (isNormalMappingEnabled) {
+            normalLayerUniform = getShadingShaders().getUniform<GLint>("normalLayer");
+        }
+    }
+
+    drawBatchCount = 0;
+    textureBindCount = 0;
+
+    // submeshes are sorted by material when cooking, so each material takes a single batch
+    for (std::size_t first = 0, last; first < submeshes.size(); first = last) {
+        const GLuint materialIndex = submeshes[first].materialIndex;
+        for (last = first + 1; last < submeshes.size() && submeshes[last].materialIndex == materialIndex; last++) {}
+
+        const std::size_t batchBegin = submeshes[first].firstIndex;
+        const std::size_t batchEnd = submeshes[last - 1].firstIndex + submeshes[last - 1].indexCount;
+
+        if (isShaded) {
+            GLShaders &shadingShaders = getShadingShaders();
+
+            // the manager reloads the textures first if they've been evicted. materials sharing an array only differ
+            // by their layer, so most batches don't need to bind anything
+            if (isNormalMappingEnabled) {
+                const TextureLayer normalLayer = textureManager->use(materialNormalTextures[materialIndex]);
+                textureBindCount += getGLState().bindTexture(1, GL_TEXTURE_2D_ARRAY, normalLayer.array);
+                shadingShaders.setUniform(normalLayerUniform, normalLayer.layer);
+            }
+
+            const TextureLayer colorLayer = textureManager->use(materialTextures[materialIndex]);
+            textureBindCount += getGLState().bindTexture(0, GL_TEXTURE_2D_ARRAY, colorLayer.array);
+            shadingShaders.setUniform(colorLayerUniform, colorLayer.layer);
+            shadingShaders.setUniform(diffuseColor, mesh->getMaterials()[materialIndex].diffuseColor);
+        }
+
+        drawBatchCount++;
+
+        if (!isCulled) {
+            indexBuffer->draw(batchBegin, batchEnd - batchBegin);
+            continue;
+        }
+
+        // visible ranges are sorted too, but merging may have made some of them span multiple batches
+        batchRanges.clear();
+        for (; visibleRange != visibleRanges.cend() && visibleRange->firstIndex < batchEnd; ++visibleRange) {
+            const std::size_t rangeEnd = visibleRange->firstIndex + visibleRange->indexCount;
+            const std::size_t begin = std::max(visibleRange->firstIndex, batchBegin);
+            const std::size_t end = std::min(rangeEnd, batchEnd);
+
+            if (begin < end) {
+                batchRanges.push_back({begin, end - begin});
+            }
+
+            if (rangeEnd > batchEnd) {
+                break;
+            }
+        }
+
+        indexBuffer->multiDraw(batchRanges);
+    }
+}
+
+void OpenGLRenderer::updateUniformBuffers() const {
+    frameUniforms->update({
+        .view = camera->getViewMatrix(),
+        .projection = camera->getPerspectiveMatrix(),
+        .lightDirection = glm::vec4(LIGHT_DIRECTION, 0.0f),
+        .cameraPosition = glm::vec4(camera->getPosition(), 1.0f),
+    });
+
+    // normals and tangents aren't quantized, so they skip the position decoding
+    objectUniforms->update({
+        .model = getModelMatrix() * positionDecodeMatrix,
+        .normalMatrix = glm::transpose(glm::inverse(getModelMatrix())),
+    });
+}
+
+GLShaders &OpenGLRenderer::getShadingShaders() const {
+    return isNormalMappingEnabled ? *normalMappedShaders : *shaders;
+}
+
+std::size_t OpenGLRenderer::selectLod() const {
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+
+    const glm::mat4 model = getModelMatrix();
+    const float modelScale = glm::length(glm::vec3(model[0]));
+    const glm::vec3 center(model * glm::vec4(meshCenter, 1.0f));
+
+    // the error is projected at the nearest point of the mesh's bounding sphere, where it's the largest
+    const float distance = glm::distance(center, camera->getPosition()) - meshRadius * modelScale;
+    if (distance <= 0.0f) {
+        return 0;
+    }
+
+    // how many pixels a world-space unit covers at that distance, given the vertical field of view
+    const float pixelsPerUnit = camera->getPerspectiveMatrix()[1][1] * static_cast<float>(height) / (2.0f * distance);
+
+    // errors only grow with coarser LODs, so the last one that's still precise enough wins
+    const std::span<const MeshLod> lods = mesh->getLods();
+    std::size_t lod = 0;
+    for (std::size_t i = 1; i < lods.size(); i++) {
+        if (lods[i].error * modelScale * pixelsPerUnit <= MAX_LOD_SCREEN_ERROR) {
+            lod = i;
+        }
+    }
+
+    return lod;
+}
+
+void OpenGLRenderer::measureOverdraw() {
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+
+    // every fragment that passes the depth test adds 1 to its pixel, so we need a float target with blending
+    GLuint countTextureID;
+    glGenTextures(1, &countTextureID);
+    getGLState().bindTexture(GL_TEXTURE_2D, countTextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, nullptr);
+
+    GLuint depthBufferID;
+    glGenRenderbuffers(1, &depthBufferID);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBufferID);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    GLuint fboID;
+    glGenFramebuffers(1, &fboID);
+    glBindFramebuffer(GL_FRAMEBUFFER, fboID);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, countTextureID, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBufferID);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error("overdraw measurement framebuffer is incomplete");
+    }
+
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    getGLState().enable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    overdrawShaders->enable();
+    updateUniformBuffers();
+
+    drawMesh(false);
+
+    getGLState().disable(GL_BLEND);
+
+    std::vector<float> counts(static_cast<std::size_t>(width) * height);
+    glReadPixels(0, 0, width, height, GL_RED, GL_FLOAT, counts.data());
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fboID);
+    glDeleteRenderbuffers(1, &depthBufferID);
+    getGLState().deleteTexture(countTextureID);
+
+    double fragmentCount = 0.0;
+    std::size_t coveredPixels = 0;
+    for (const float count : counts) {
+        fragmentCount += count;
+        if (count > 0.0f) coveredPixels++;
+    }
+
+    std::cout << "Overdraw: " << (coveredPixels ? fragmentCount / static_cast<double>(coveredPixels) : 0.0)
+            << " shaded fragments per covered pixel (" << coveredPixels << " pixels covered)\n";
+}
+
+void OpenGLRenderer::benchmarkVertexFormats() {
+    constexpr int DRAWS_PER_FORMAT = 256;
+
+    GLuint queryID;
+    glGenQueries(1, &queryID);
+
+    glViewport(0, 0, 1, 1);
+
+    shaders->enable();
+    updateUniformBuffers();
+
+    const MeshLod &fullDetail = mesh->getLods()[0];
+
+    for (const VertexFormat format : {VertexFormat::FLOAT, VertexFormat::HALF_UV, VertexFormat::QUANTIZED}) {
+        const EncodedVertices encoded = encodeVertices(mesh->getVertices(), format);
+
+        GLuint benchmarkVao, benchmarkVbo;
+        glGenVertexArrays(1, &benchmarkVao);
+        getGLState().bindVertexArray(benchmarkVao);
+
+        glGenBuffers(1, &benchmarkVbo);
+        getGLState().bindBuffer(GL_ARRAY_BUFFER, benchmarkVbo);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(encoded.data.size()), encoded.data.data(),
+                     GL_STATIC_DRAW);
+
+        const IndexBuffer benchmarkIndices(mesh->getIndices(), mesh->getVertices().size());
+        encoded.layout.apply();
+
+        objectUniforms->update({
+            .model = getModelMatrix() * encoded.positionDecodeMatrix,
+            .normalMatrix = glm::identity<glm::mat4>(),
+        });
+
+        // warm up, so that the upload itself isn't timed
+        benchmarkIndices.draw(fullDetail.firstIndex, fullDetail.indexCount);
+        glFinish();
+
+        glBeginQuery(GL_TIME_ELAPSED, queryID);
+        for (int i = 0; i < DRAWS_PER_FORMAT; i++) {
+            benchmarkIndices.draw(fullDetail.firstIndex, fullDetail.indexCount);
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+
+        GLuint64 elapsedNs;
+        glGetQueryObjectui64v(queryID, GL_QUERY_RESULT, &elapsedNs);
+
+        const double msPerDraw = static_cast<double>(elapsedNs) / 1e6 / DRAWS_PER_FORMAT;
+        const double fetchedBytes = static_cast<double>(fullDetail.indexCount) * encoded.layout.stride;
+
+        std::cout << "Vertex format " << getVertexFormatName(format) << ": " << encoded.layout.stride
+                << " bytes per vertex, " << encoded.data.size() << " bytes total, " << msPerDraw << " ms per draw ("
+                << fetchedBytes / (msPerDraw * 1e6) << " GB/s of vertex fetches before caching)\n";
+
+        getGLState().deleteBuffer(benchmarkVbo);
+        getGLState().deleteVertexArray(benchmarkVao);
+    }
+
+    glDeleteQueries(1, &queryID);
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    glViewport(0, 0, width, height);
+    getGLState().bindVertexArray(vao);
+}
+
+void OpenGLRenderer::pickTriangle() const {
+    if (!bvh) {
+        std::cout << "Streamed meshes have no BVH, picking is unavailable\n";
+        return;
+    }
+
+    double cursorX, cursorY;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+
+    // the cursor's position is in window coordinates, which may differ from framebuffer pixels
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+
+    const glm::vec2 ndc(2.0f * static_cast<float>(cursorX) / static_cast<float>(width) - 1.0f,
+                        1.0f - 2.0f * static_cast<float>(cursorY) / static_cast<float>(height));
+
+    glm::vec3 origin, direction;
+    getScreenRay(getClipToObjectMatrix(*camera), ndc, origin, direction);
+
+    const RayHit hit = bvh->intersect(origin, direction, 1.0f);
+    if (hit.triangle == Bvh::NO_HIT) {
+        std::cout << "Picked nothing\n";
+        return;
+    }
+
+    const std::size_t firstIndex = 3 * static_cast<std::size_t>(hit.triangle);
+    const MeshLod &fullDetail = mesh->getLods()[0];
+    const std::span<const MeshSubmesh> submeshes = mesh->getSubmeshes().subspan(fullDetail.firstSubmesh,
+                                                                                 fullDetail.submeshCount);
+    const auto submesh = std::ranges::find_if(submeshes, [&](const MeshSubmesh &candidate) {
+        return firstIndex >= candidate.firstIndex && firstIndex < candidate.firstIndex + candidate.indexCount;
+    });
+
+    const glm::vec3 worldHit(getModelMatrix() * glm::vec4(origin + direction * hit.distance, 1.0f));
+
+    std::cout << "Picked triangle " << hit.triangle << " of submesh " << submesh - submeshes.begin()
+            << " (material " << submesh->materialIndex << "), " << glm::distance(worldHit, camera->getPosition())
+            << " units away\n";
+}
+
+void OpenGLRenderer::benchmarkRayQueries() const {
+    if (!bvh) {
+        std::cout << "Streamed meshes have no BVH, there's nothing to benchmark\n";
+        return;
+    }
+
+    // rays go through a grid of this many points on each side of the screen, one packet per 4x2 tile
+    constexpr int RESOLUTION = 1024;
+    constexpr int PACKET_WIDTH = 4;
+    constexpr int PACKET_HEIGHT = static_cast<int>(RAY_PACKET_SIZE) / PACKET_WIDTH;
+
+    // brute force tests every ray against every triangle, so it only traces every n-th packet, keeping the number
+    // of tests below this
+    constexpr double MAX_BRUTE_FORCE_TESTS = 2e8;
+
+    // the BVH is built again, so that the build time is measured without anything else running on the thread pool
+    const auto buildStart = std::chrono::steady_clock::now();
+    const Bvh benchmarkBvh(*threadPool, getFullDetailIndices(*mesh), mesh->getVertices());
+    const std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - buildStart;
+
+    const glm::mat4 clipToObject = getClipToObjectMatrix(*camera);
+    std::vector<RayPacket> packets;
+
+    for (int tileY = 0; tileY < RESOLUTION; tileY += PACKET_HEIGHT) {
+        for (int tileX = 0; tileX < RESOLUTION; tileX += PACKET_WIDTH) {
+            RayPacket &packet = packets.emplace_back();
+
+            for (std::size_t lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+                const int x = tileX + static_cast<int>(lane) % PACKET_WIDTH;
+                const int y = tileY + static_cast<int>(lane) / PACKET_WIDTH;
+                const glm::vec2 ndc = (glm::vec2(static_cast<float>(x), static_cast<float>(y)) + 0.5f)
+                                      * (2.0f / RESOLUTION) - 1.0f;
+
+                glm::vec3 origin, direction;
+                getScreenRay(clipToObject, ndc, origin, direction);
+
+                packet.originX[lane] = origin.x;
+                packet.originY[lane] = origin.y;
+                packet.originZ[lane] = origin.z;
+                packet.directionX[lane] = direction.x;
+                packet.directionY[lane] = direction.y;
+                packet.directionZ[lane] = direction.z;
+                packet.maxDistance[lane] = 1.0f;
+            }
+        }
+    }
+
+    const std::size_t bruteForceStride = std::max(static_cast<std::size_t>(std::ceil(
+        static_cast<double>(packets.size() * RAY_PACKET_SIZE) * static_cast<double>(bvh->getTriangleCount())
+        / MAX_BRUTE_FORCE_TESTS)), std::size_t{1});
+
+    std::vector<RayPacket> bruteForcePackets;
+    for (std::size_t i = 0; i < packets.size(); i += bruteForceStride) {
+        bruteForcePackets.push_back(packets[i]);
+    }
+
+    const auto bvhStart = std::chrono::steady_clock::now();
+    threadPool->parallelFor(packets.size(), 64, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            benchmarkBvh.intersect(packets[i]);
+        }
+    });
+    const std::chrono::duration<double> bvhTime = std::chrono::steady_clock::now() - bvhStart;
+
+    const auto bruteForceStart = std::chrono::steady_clock::now();
+    threadPool->parallelFor(bruteForcePackets.size(), 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            benchmarkBvh.intersectBruteForce(bruteForcePackets[i]);
+        }
+    });
+    const std::chrono::duration<double> bruteForceTime = std::chrono::steady_clock::now() - bruteForceStart;
+
+    // rays hitting a shared edge may report either triangle, so only hits at different distances count as errors
+    std::size_t hitCount = 0;
+    std::size_t mismatchCount = 0;
+
+    for (std::size_t i = 0; i < packets.size(); i++) {
+        for (std::size_t lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            hitCount += packets[i].triangles[lane] != Bvh::NO_HIT;
+        }
+    }
+
+    for (std::size_t i = 0; i < bruteForcePackets.size(); i++) {
+        const RayPacket &expected = bruteForcePackets[i];
+        const RayPacket &actual = packets[i * bruteForceStride];
+
+        for (std::size_t lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            mismatchCount += expected.triangles[lane] != actual.triangles[lane]
+                    && std::abs(expected.maxDistance[lane] - actual.maxDistance[lane]) > 1e-5f;
+        }
+    }
+
+    const double bvhRate = static_cast<double>(packets.size() * RAY_PACKET_SIZE) / bvhTime.count() / 1e6;
+    const double bruteForceRate = static_cast<double>(bruteForcePackets.size() * RAY_PACKET_SIZE)
+                                  / bruteForceTime.count() / 1e6;
+
+    std::cout << "BVH: built in " << buildTime.count() << " ms, " << benchmarkBvh.getNodeCount() << " nodes over "
+            << benchmarkBvh.getTriangleCount() << " triangles\n";
+    std::cout << "\ttraversal: " << bvhRate << " Mrays/s (" << packets.size() * RAY_PACKET_SIZE << " rays, "
+            << hitCount << " hits)\n";
+    std::cout << "\tbrute force: " << bruteForceRate << " Mrays/s (" << bruteForcePackets.size() * RAY_PACKET_SIZE
+            << " rays), " << bvhRate / bruteForceRate << "x slower, " << mismatchCount << " mismatched hits\n";
+}
+
+void OpenGLRenderer::benchmarkVertexWelding() const {
+    // about 10M indices, in a grid of quads split into two triangles each
+    constexpr std::size_t GRID_SIDE = 1291;
+    constexpr std::array<glm::uvec2, 6> QUAD_CORNERS = {{{0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1}}};
+
+    // the mesh's corners as they were before welding -- the same triangles, just in the order cooking left them in.
+    // grid corners are generated on the fly, as storing 10M of them would take hundreds of MB
+    const std::span<const GLuint> meshIndices = getFullDetailIndices(*mesh);
+    const std::span<const Vertex> meshVertices = mesh->getVertices();
+    const auto getMeshCorner = [&](const std::size_t i) -> const Vertex & { return meshVertices[meshIndices[i]]; };
+
+    Vertex gridCorner;
+    const auto getGridCorner = [&](const std::size_t i) -> const Vertex & {
+        const std::size_t quad = i / QUAD_CORNERS.size();
+        const glm::uvec2 gridPosition = glm::uvec2(quad % GRID_SIDE, quad / GRID_SIDE) + QUAD_CORNERS[i % 6];
+        const glm::vec2 uv = glm::vec2(gridPosition) / static_cast<float>(GRID_SIDE);
+        gridCorner.position = glm::vec3(uv.x, 0.0f, uv.y);
+        gridCorner.uv = uv;
+        return gridCorner;
+    };
+
+    const auto benchmark = [](const char *name, const std::size_t cornerCount, const auto &getCorner) {
+        std::vector<GLuint> mapIndices, welderIndices;
+        mapIndices.reserve(cornerCount);
+        welderIndices.reserve(cornerCount);
+
+        const auto mapStart = std::chrono::steady_clock::now();
+        weldWithMap(cornerCount, getCorner, mapIndices);
+        const std::chrono::duration<double, std::milli> mapTime = std::chrono::steady_clock::now() - mapStart;
+
+        const auto welderStart = std::chrono::steady_clock::now();
+        weldWithWelder(cornerCount, getCorner, welderIndices);
+        const std::chrono::duration<double, std::milli> welderTime = std::chrono::steady_clock::now() - welderStart;
+
+        const GLuint vertexCount = mapIndices.empty() ? 0 : *std::ranges::max_element(mapIndices) + 1;
+
+        std::cout << "Vertex welding, " << name << " (" << cornerCount << " corners into " << vertexCount
+                << " vertices): " << mapTime.count() << " ms with std::unordered_map, " << welderTime.count()
+                << " ms with VertexWelder (" << mapTime.count() / welderTime.count() << "x)"
+                << (mapIndices == welderIndices ? "" : ", RESULTS DIFFER") << "\n";
+    };
+
+    benchmark("kettle.obj", meshIndices.size(), getMeshCorner);
+    benchmark("synthetic grid", GRID_SIDE * GRID_SIDE * QUAD_CORNERS.size(), getGridCorner);
+}
+
+void OpenGLRenderer::benchmarkUniformLookups() {
+    constexpr int SETS_PER_METHOD = 1 << 20;
+
+    GLShaders &shadingShaders = getShadingShaders();
+    shadingShaders.enable();
+
+    // alternating values keep every set from being filtered out as redundant, and also keep the values the shaders
+    // remember in step with the ones the map baseline sets behind their back
+    const auto getColor = [](const int i) { return glm::vec3(static_cast<float>(i & 1)); };
+
+    // what every set used to cost: building a string from the literal, and walking a map with it
+    std::map<std::string, GLint> locations;
+    for (const char *name : {"colorTexture", "colorLayer", "diffuseColor"}) {
+        locations.emplace(name, glGetUniformLocation(shadingShaders.getID(), name));
+    }
+
+    const auto mapStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < SETS_PER_METHOD; i++) {
+        const glm::vec3 color = getColor(i);
+        glUniform3f(locations.find("diffuseColor")->second, color.x, color.y, color.z);
+    }
+    glFinish();
+    const std::chrono::duration<double, std::nano> mapTime = std::chrono::steady_clock::now() - mapStart;
+
+    const auto literalStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < SETS_PER_METHOD; i++) {
+        shadingShaders.setUniform("diffuseColor", getColor(i));
+    }
+    glFinish();
+    const std::chrono::duration<double, std::nano> literalTime = std::chrono::steady_clock::now() - literalStart;
+
+    const UniformHandle<glm::vec3> diffuseColor = shadingShaders.getUniform<glm::vec3>("diffuseColor");
+    const auto handleStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < SETS_PER_METHOD; i++) {
+        shadingShaders.setUniform(diffuseColor, getColor(i));
+    }
+    glFinish();
+    const std::chrono::duration<double, std::nano> handleTime = std::chrono::steady_clock::now() - handleStart;
+
+    // and the same value over and over, which only ever reaches the driver once
+    const auto unchangedStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < SETS_PER_METHOD; i++) {
+        shadingShaders.setUniform(diffuseColor, getColor(0));
+    }
+    glFinish();
+    const std::chrono::duration<double, std::nano> unchangedTime = std::chrono::steady_clock::now() - unchangedStart;
+
+    std::cout << "Uniform sets: " << mapTime.count() / SETS_PER_METHOD << " ns by string in a map, "
+            << literalTime.count() / SETS_PER_METHOD << " ns by hashed literal, "
+            << handleTime.count() / SETS_PER_METHOD << " ns by handle, "
+            << unchangedTime.count() / SETS_PER_METHOD << " ns by handle with an unchanged value\n";
+}
+
+void OpenGLRenderer::tickAssetUpload() {
+    if (isMeshReady) {
+        return;
+    }
+
+    if (!uploadingAssets) {
+        if (pendingAssets.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return;
+        }
+
+        uploadingAssets = pendingAssets.get(); // rethrows whatever went wrong while loading
+
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+        std::cout << "Assets loaded after " << elapsed.count() << " ms\n";
+
+        prepareBuffers();
+    }
+
+    const LoadedAssets &assets = *uploadingAssets;
+    const std::span<const Vertex> vertices = mesh->getVertices();
+    const std::span<const GLuint> indices = mesh->getIndices();
+
+    const auto uploadStart = std::chrono::steady_clock::now();
+    std::size_t uploadedBytes = 0;
+    bool isUploadDone = false;
+
+    textureUploadRing->tick();
+
+    // at least one slice is uploaded every frame, so the upload always makes progress
+    do {
+        if (uploadedVertexCount < vertices.size()) {
+            const std::size_t stride = assets.vertexEncoder->getLayout().stride;
+            const std::size_t count = std::min(ASSET_UPLOAD_SLICE_BYTES / stride,
+                                               vertices.size() - uploadedVertexCount);
+            const auto offset = static_cast<GLintptr>(uploadedVertexCount * stride);
+            const auto size = static_cast<GLsizeiptr>(count * stride);
+
+            // encode the vertices straight into the buffer's memory, so the whole mesh never has to be encoded at
+            // once -- for streamed meshes, they come straight from the mapped cache
+            getGLState().bindBuffer(GL_ARRAY_BUFFER, vbo);
+            auto *mapped = static_cast<std::byte *>(glMapBufferRange(
+                GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+            if (!mapped) {
+                throw std::runtime_error("failed to map vertex buffer");
+            }
+
+            assets.vertexEncoder->encode(vertices.subspan(uploadedVertexCount, count), mapped);
+
+            if (!glUnmapBuffer(GL_ARRAY_BUFFER)) {
+                throw std::runtime_error("vertex buffer contents were lost while mapped");
+            }
+
+            uploadedVertexCount += count;
+            uploadedBytes += count * stride;
+        } else if (uploadedIndexCount < indices.size()) {
+            const std::size_t count = std::min(ASSET_UPLOAD_SLICE_BYTES / sizeof(GLuint),
+                                               indices.size() - uploadedIndexCount);
+
+            indexBuffer->upload(indices, uploadedIndexCount, count);
+
+            uploadedIndexCount += count;
+            uploadedBytes += count * sizeof(GLuint);
+        } else if (uploadedTextureCount < textureManager->getTextureCount()) {
+            // if the ring is full, the workers or the GPU are still busy with earlier slices, so we come back to it
+            // next frame rather than wait for them
+            if (!textureUploadRing->canSubmit()) {
+                break;
+            }
+
+            std::vector<TextureUpload> uploads = getNextTextureUploads(textureUploadRing->getSegmentBytes());
+            for (const TextureUpload &upload : uploads) {
+                uploadedBytes += upload.pixels.size();
+            }
+
+            textureUploadRing->submit(std::move(uploads));
+        } else if (!textureUploadRing->isIdle()) {
+            // the last slices are still being copied, and get issued by the next frames' ticks
+            break;
+        } else {
+            isUploadDone = true;
+        }
+    } while (!isUploadDone && std::chrono::steady_clock::now() - uploadStart < ASSET_UPLOAD_BUDGET);
+
+    uploadFrameCount++;
+
+    const std::chrono::duration<double, std::milli> uploadTime = std::chrono::steady_clock::now() - uploadStart;
+    const TextureUploadStats ringStats = textureUploadRing->takeStats();
+
+    std::cout << "Asset upload: " << uploadedBytes / 1024 << " KB in " << uploadTime.count() << " ms this frame, "
+            << "texture ring: " << ringStats.submittedBytes / 1024 << " KB submitted, " << ringStats.issuedBytes / 1024
+            << " KB issued, " << textureUploadRing->getBusySegmentCount() << "/"
+            << textureUploadRing->getSegmentCount() << " segments busy";
+
+    if (ringStats.fullRingCount) {
+        std::cout << ", full";
+    }
+
+    std::cout << "\n";
+
+    if (!isUploadDone) {
+        return;
+    }
+
+    uploadingAssets.reset();
+    isMeshReady = true;
+
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+    std::cout << "Mesh ready after " << elapsed.count() << " ms, uploaded over " << uploadFrameCount << " frame(s)\n";
+    std::cout << "\t" << mesh->getSubmeshes().size() << " submeshes and " << mesh->getMaterials().size()
+            << " materials, using " << textureManager->getTextureCount() << " textures packed into "
+            << textureManager->getArrayCount() << " arrays, " << textureManager->getResidentBytes() / 1024
+            << " KB of them resident\n";
+}
+
+std::vector<TextureUpload> OpenGLRenderer::getNextTextureUploads(const std::size_t maxBytes) {
+    std::vector<TextureUpload> uploads;
+    std::size_t byteCount = 0;
+
+    // every mip level comes precomputed, so they're uploaded one after another like the base level. compressed
+    // levels are uploaded in whole rows of blocks, which is what `uploadedTextureRows` counts
+    while (uploadedTextureCount < textureManager->getTextureCount()) {
+        const CachedTexture &texture = textureManager->getCachedTexture(uploadedTextureCount);
+        const std::size_t baseLevel = textureManager->getBaseLevel(uploadedTextureCount);
+        const TextureLevel level = texture.getLevel(uploadedTextureLevel);
+        const TextureFormat format = texture.getFormat();
+        const int blockSize = getBlockSize(format);
+        const int levelRowCount = getBlockRowCount(format, level.height);
+        const std::size_t rowBytes = getBlockRowBytes(format, level.width);
+        const auto sliceRows = static_cast<int>((maxBytes - byteCount) / rowBytes);
+        const int rowCount = std::min(sliceRows, levelRowCount - uploadedTextureRows);
+
+        if (rowCount == 0) {
+            if (uploads.empty()) {
+                throw std::runtime_error("a row of texture blocks doesn't fit in a texture upload segment");
+            }
+
+            break;
+        }
+
+        // the last row of blocks may stick out past the top of the level
+        const int y = uploadedTextureRows * blockSize;
+        const int height = std::min(rowCount * blockSize, level.height - y);
+
+        // levels the manager had to drop to fit the budget aren't part of the GL texture at all
+        const TextureLayer layer = textureManager->getLayer(uploadedTextureCount);
+        uploads.push_back({
+            layer.array,
+            layer.layer,
+            static_cast<GLint>(uploadedTextureLevel - baseLevel),
+            y,
+            level.width,
+            height,
+            format == TextureFormat::RGBA8 ? 0 : getTextureInternalFormat(format),
+            level.pixels.subspan(uploadedTextureRows * rowBytes, rowCount * rowBytes)
+        });
+
+        byteCount += rowCount * rowBytes;
+        uploadedTextureRows += rowCount;
+
+        if (uploadedTextureRows == levelRowCount) {
+            uploadedTextureRows = 0;
+            uploadedTextureLevel++;
+
+            if (uploadedTextureLevel == texture.getLevelCount()) {
+                uploadedTextureCount++;
+                uploadedTextureLevel = uploadedTextureCount < textureManager->getTextureCount()
+                                           ? textureManager->getBaseLevel(uploadedTextureCount)
+                                           : 0;
+            }
+        }
+    }
+
+    return uploads;
 }
 
 void OpenGLRenderer::prepareBuffers() {
+    LoadedAssets &assets = *uploadingAssets;
+
+    mesh = std::move(assets.mesh);
+    bvh = std::move(assets.bvh);
+    meshCenter = assets.meshCenter;
+    meshRadius = assets.meshRadius;
+    positionDecodeMatrix = assets.vertexEncoder->getPositionDecodeMatrix();
+    const VertexLayout &vertexLayout = assets.vertexEncoder->getLayout();
+
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    getGLState().bindVertexArray(vao);
 
     glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshVertices.size(), meshVertices.data(), GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * meshIndices.size(), meshIndices.data(), GL_STATIC_DRAW);
-
-    glVertexAttribPointer(
-        0,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(Vertex),
-        reinterpret_cast<void *>(offsetof(Vertex, position))
-    );
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(
-        1,
-        2,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(Vertex),
-        reinterpret_cast<void *>(offsetof(Vertex, uv))
-    );
-    glEnableVertexAttribArray(1);
+    getGLState().bindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh->getVertices().size() * vertexLayout.stride),
+                 nullptr, GL_STATIC_DRAW);
+
+    indexBuffer = std::make_unique<IndexBuffer>(mesh->getIndices(), mesh->getVertices().size(), true);
+
+    vertexLayout.apply();
+
+    meshletCuller = std::make_unique<MeshletCuller>(*threadPool, mesh->getMeshlets());
+
+    // textures are allocated right away, but only filled in by `tickAssetUpload`
+    textureUploadRing = std::make_unique<TextureUploadRing>(*threadPool, TEXTURE_UPLOAD_SEGMENT_COUNT,
+                                                            TEXTURE_UPLOAD_SEGMENT_BYTES);
+    textureManager = std::make_unique<TextureManager>(TEXTURE_MEMORY_BUDGET);
+    for (std::size_t i = 0; i < assets.textures.size(); i++) {
+        textureManager->add(std::move(assets.textureSources[i]), std::move(assets.textures[i]));
+    }
+
+    getGLState().setActiveTextureUnit(0);
+    textureManager->allocate();
+    uploadedTextureLevel = textureManager->getTextureCount() > 0 ? textureManager->getBaseLevel(0) : 0;
+
+    // textures are added in order, so the indices the materials refer to stay the same
+    materialTextures = std::move(assets.materialTextures);
+    materialNormalTextures = std::move(assets.materialNormalTextures);
+
+    // there's nothing to map normals with
+    if (mesh->getCookFlags() & MESH_COOK_STREAMED) {
+        isNormalMappingEnabled = false;
+    }
+
+    std::cout << "Vertex format: " << getVertexFormatName(VERTEX_FORMAT) << ", " << vertexLayout.stride
+            << " bytes per vertex\n";
+    std::cout << "Index buffer: " << (indexBuffer->getIndexType() == GL_UNSIGNED_SHORT ? "16" : "32") << "-bit, "
+            << indexBuffer->getSegmentCount() << " segment(s), " << indexBuffer->getSizeBytes() << " bytes\n";
 }
 
-void OpenGLRenderer::loadTextures() {
-    stbi_set_flip_vertically_on_load(true); // needed as the y-axis (or rather the v coordinate) is flipped
+std::unique_ptr<OpenGLRenderer::LoadedAssets> OpenGLRenderer::loadAssets(ThreadPool &threadPool,
+                                                                          const std::optional<BlockQuality>
+                                                                          textureCompression) {
+    auto assets = std::make_unique<LoadedAssets>();
 
-    int width, height, channelCount;
-    unsigned char *data = stbi_load("../assets/textures/kettle-albedo.png", &width, &height, &channelCount, 0);
-    if (!data) {
-        throw std::runtime_error("failed to load texture!");
+    assets->mesh = loadMesh(threadPool);
+    assets->vertexEncoder = std::make_unique<VertexEncoder>(assets->mesh->getVertices(), VERTEX_FORMAT);
+
+    // a BVH over a streamed mesh would take about as much memory as the mesh itself
+    if (!(assets->mesh->getCookFlags() & MESH_COOK_STREAMED)) {
+        const auto bvhStart = std::chrono::steady_clock::now();
+        assets->bvh = std::make_unique<Bvh>(threadPool, getFullDetailIndices(*assets->mesh),
+                                            assets->mesh->getVertices());
+        const std::chrono::duration<double, std::milli> bvhTime = std::chrono::steady_clock::now() - bvhStart;
+
+        std::cout << "BVH: " << assets->bvh->getNodeCount() << " nodes over " << assets->bvh->getTriangleCount()
+                << " triangles, built in " << bvhTime.count() << " ms\n";
+    }
+
+    // bounding sphere used for picking LODs
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (const Vertex &vertex : assets->mesh->getVertices()) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
     }
 
-    glGenTextures(1, &colorTextureID);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, colorTextureID);
+    assets->meshCenter = (boundsMin + boundsMax) * 0.5f;
+    assets->meshRadius = glm::distance(boundsMin, boundsMax) * 0.5f;
+
+    // materials sharing a texture share it. the empty path stands for the flat normal map
+    std::map<std::filesystem::path, std::size_t> textureIndices;
+    std::vector<std::filesystem::path> texturePaths;
+    std::vector<TextureKind> textureKinds;
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    const auto getTextureIndex = [&](const std::filesystem::path &path, const TextureKind kind) {
+        const auto [it, isNew] = textureIndices.try_emplace(path, texturePaths.size());
+        if (isNew) {
+            texturePaths.push_back(path);
+            textureKinds.push_back(kind);
+        }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+        return it->second;
+    };
 
-    stbi_image_free(data);
+    // materials without a color texture fall back to the default textures. ones which have a color texture
+    // but no normal map get a flat one instead, as the default normal map wouldn't match their texture mapping
+    for (const MeshMaterial &material : assets->mesh->getMaterials()) {
+        const bool hasTexture = material.diffuseTexture[0];
+        const std::filesystem::path texturePath = hasTexture ? material.diffuseTexture : DEFAULT_TEXTURE_PATH;
+        const std::filesystem::path normalTexturePath = material.normalTexture[0] ? material.normalTexture
+                                                        : hasTexture ? "" : DEFAULT_NORMAL_TEXTURE_PATH;
+
+        assets->materialTextures.push_back(getTextureIndex(texturePath, TextureKind::COLOR));
+        assets->materialNormalTextures.push_back(getTextureIndex(normalTexturePath, TextureKind::NORMAL));
+    }
+
+    // all textures are loaded at once, each one on its own core
+    const auto textureStart = std::chrono::steady_clock::now();
+    assets->textures.resize(texturePaths.size());
+    assets->textureSources.resize(texturePaths.size());
+    std::vector<double> textureTimes(texturePaths.size());
+
+    threadPool.parallelFor(texturePaths.size(), 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            const auto start = std::chrono::steady_clock::now();
+
+            TextureSource &source = assets->textureSources[i];
+
+            if (!texturePaths[i].empty()) {
+                source = {
+                    .cachePath = std::filesystem::path(texturePaths[i].stem()) += ".texcache",
+                    .sourceHash = CachedMesh::hashSourceFile(texturePaths[i]),
+                    .kind = textureKinds[i],
+                    .compression = textureCompression,
+                };
+                assets->textures[i] = loadTexture(threadPool, texturePaths[i], source);
+            } else {
+                // cooked in memory only, so there's no cache to reload it from and it's never evicted
+                source = {
+                    .cachePath = {},
+                    .sourceHash = 0,
+                    .kind = TextureKind::NORMAL,
+                    .compression = textureCompression,
+                };
+
+                auto *pixels = static_cast<unsigned char *>(std::malloc(sizeof(FLAT_NORMAL_TEXEL)));
+                std::ranges::copy(FLAT_NORMAL_TEXEL, pixels);
+
+                DecodedTexture texture;
+                texture.pixels = {pixels, std::free};
+                texture.width = texture.height = 1;
+                texture.channelCount = 4;
+
+                assets->textures[i] = CachedTexture::cook(threadPool, texture, 0, TextureKind::NORMAL,
+                                                          textureCompression);
+            }
+
+            const std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+            textureTimes[i] = time.count();
+        }
+    });
+
+    const std::chrono::duration<double, std::milli> textureTime = std::chrono::steady_clock::now() - textureStart;
+    const auto mappedCount = std::ranges::count_if(assets->textures, [](const std::unique_ptr<CachedTexture> &texture) {
+        return texture->isMapped();
+    });
+
+    std::cout << "Loaded " << assets->textures.size() << " texture(s) in " << textureTime.count() << " ms, "
+            << mappedCount << " of them from the texture cache\n";
+
+    for (std::size_t i = 0; i < texturePaths.size(); i++) {
+        const CachedTexture &texture = *assets->textures[i];
+
+        std::cout << "\t" << (texturePaths[i].empty() ? "flat normal map" : texturePaths[i].filename().string())
+                << ": " << getTextureFormatName(texture.getFormat()) << ", " << texture.getSizeBytes() / 1024
+                << " KB, ";
+
+        if (std::isinf(texture.getPsnr())) {
+            std::cout << "lossless";
+        } else {
+            std::cout << "PSNR " << texture.getPsnr() << " dB";
+        }
+
+        std::cout << ", " << (texture.isMapped() ? "mapped" : "cooked") << " in " << textureTimes[i] << " ms\n";
+    }
+
+    return assets;
 }
 
-void OpenGLRenderer::loadMesh() {
-    tinyobj::ObjReaderConfig reader_config{};
-    tinyobj::ObjReader reader{};
+std::unique_ptr<CachedTexture> OpenGLRenderer::loadTexture(ThreadPool &threadPool, const std::filesystem::path &path,
+                                                           const TextureSource &source) {
+    if (std::unique_ptr<CachedTexture> texture = CachedTexture::open(source.cachePath, source.sourceHash, source.kind,
+                                                                     source.compression)) {
+        return texture;
+    }
+
+    // textures are flipped, as the y-axis (or rather the v coordinate) is flipped
+    const DecodedTexture image = TextureLoader::decode(path, STBI_rgb_alpha, true);
+    std::unique_ptr<CachedTexture> texture = CachedTexture::cook(threadPool, image, source.sourceHash, source.kind,
+                                                                 source.compression);
+    texture->write(source.cachePath);
 
-    if (!reader.ParseFromFile("../assets/meshes/kettle.obj", reader_config)) {
-        if (!reader.Error().empty()) {
-            std::cerr << "TinyObjReader: " << reader.Error();
+    return texture;
+}
+
+static void writeCompressedMesh(ThreadPool &threadPool, const std::filesystem::path &path, const CachedMesh &mesh) {
+    const auto writeStart = std::chrono::steady_clock::now();
+    CachedMesh::writeCompressed(threadPool, path, mesh);
+    const std::chrono::duration<double, std::milli> writeTime = std::chrono::steady_clock::now() - writeStart;
+
+    const std::uintmax_t packedSize = std::filesystem::file_size(path);
+    std::cout << "Compressed mesh: " << path.filename() << " (" << mesh.getSizeBytes() / 1024 << " KB -> "
+            << packedSize / 1024 << " KB, " << static_cast<double>(packedSize) / mesh.getSizeBytes() * 100.0
+            << "%) in " << writeTime.count() << " ms\n";
+}
+
+std::unique_ptr<CachedMesh> OpenGLRenderer::loadMesh(ThreadPool &threadPool) {
+    const std::filesystem::path sourcePath = "../assets/meshes/kettle.obj";
+    const std::filesystem::path cachePath = "kettle.meshcache"; // cooked meshes go next to the executable
+    const std::filesystem::path compressedCachePath = "kettle.meshpack";
+
+    // without the source asset there's nothing to cook, nor to check the compressed cache against -- it's taken
+    // as-is, so loading only has to read it
+    if (IS_MESH_CACHE_COMPRESSED && !std::filesystem::exists(sourcePath)) {
+        std::unique_ptr<CachedMesh> mesh = loadCompressedMesh(threadPool, compressedCachePath, std::nullopt,
+                                                              MESH_COOK_FLAGS);
+        if (!mesh) {
+            throw std::runtime_error("missing both the source asset and its compressed cache: "
+                                     + compressedCachePath.string());
         }
 
-        throw std::runtime_error("failed to load mesh with tinyobjloader");
+        return mesh;
     }
 
-    if (!reader.Warning().empty()) {
-        std::cout << "TinyObjReader: " << reader.Warning();
+    const std::uint64_t sourceHash = CachedMesh::hashSourceFile(sourcePath);
+    const bool isStreamed = std::filesystem::file_size(sourcePath) > MESH_STREAMING_THRESHOLD_BYTES;
+    const std::uint32_t cookFlags = isStreamed ? MESH_COOK_STREAMED : MESH_COOK_FLAGS;
+
+    // streamed meshes are only ever mapped, decoding one would need it all in memory at once
+    const bool isCompressed = IS_MESH_CACHE_COMPRESSED && !isStreamed;
+
+    if (isCompressed) {
+        if (std::unique_ptr<CachedMesh> mesh = loadCompressedMesh(threadPool, compressedCachePath, sourceHash,
+                                                                  cookFlags)) {
+            return mesh;
+        }
     }
 
-    auto &attrib = reader.GetAttrib();
-    auto &shapes = reader.GetShapes();
+    if (std::unique_ptr<CachedMesh> mesh = CachedMesh::open(cachePath, sourceHash, cookFlags)) {
+        if (isCompressed) {
+            writeCompressedMesh(threadPool, compressedCachePath, *mesh);
+        }
 
-    std::unordered_map<Vertex, GLuint> vertexToIndexMapping;
+        return mesh;
+    }
 
-    // Loop over shapes (there's only one in kettle.obj)
-    for (const auto &shape : shapes) {
-        size_t indexOffset = 0;
-        size_t nextFreeIndex = 0;
+    // no usable cache -- parse the source file and cook it, then map the freshly written cache like we would
+    // on any later run. the parsed data is freed before mapping, so we don't hold two copies of the mesh
+    const auto cookStart = std::chrono::steady_clock::now();
 
-        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
-            const size_t numFaceVertices = static_cast<size_t>(shape.mesh.num_face_vertices[f]);
+    if (isStreamed) {
+        // the welded mesh goes straight to disk as the file is parsed, so only what's needed to weld it stays in
+        // memory -- which still grows with the number of unique vertices, see `ObjLoader::stream`. the cooking
+        // steps need the whole mesh at hand, so they're skipped -- the mesh is drawn as-is, without culling or LODs
+        MeshCacheStreamWriter writer(cachePath, sourceHash, cookFlags);
+        ObjLoader(threadPool).stream(sourcePath, [&](const std::span<const Vertex> vertices,
+                                                      const std::span<const GLuint> indices) {
+            writer.append(vertices, indices);
+        });
+        writer.finish();
 
-            // Loop over vertices in the face.
-            for (size_t v = 0; v < numFaceVertices; v++) {
-                const tinyobj::index_t idx = shape.mesh.indices[indexOffset + v];
-                const glm::vec3 position = {
-                    attrib.vertices[3 * idx.vertex_index + 0],
-                    attrib.vertices[3 * idx.vertex_index + 1],
-                    attrib.vertices[3 * idx.vertex_index + 2]
-                };
+        const std::chrono::duration<double, std::milli> cookTime = std::chrono::steady_clock::now() - cookStart;
+        std::cout << "Streamed mesh: " << sourcePath.filename() << " (" << writer.getVertexCount() << " vertices, "
+                << writer.getIndexCount() << " indices) in " << cookTime.count() << " ms\n";
+    } else {
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+        std::vector<ObjSubmesh> objSubmeshes;
+        std::vector<ObjMaterial> objMaterials;
+        ObjLoader(threadPool).load(sourcePath, vertices, indices, objSubmeshes, objMaterials);
 
-                // Check if `texcoord_index` is zero or positive. negative = no texcoord data
-                if (idx.texcoord_index < 0) {
-                    throw std::runtime_error("no texcoord index in mesh");
-                }
+        // normals and tangents only depend on the welded mesh, and every later step keeps them intact
+        const auto tangentStart = std::chrono::steady_clock::now();
+        const std::size_t weldedVertexCount = vertices.size();
+        generateTangentFrames(threadPool, vertices, indices);
+        const std::size_t splitVertexCount = vertices.size() - weldedVertexCount;
+        const std::chrono::duration<double, std::milli> tangentTime = std::chrono::steady_clock::now() - tangentStart;
 
-                const glm::vec2 uv = {
-                    attrib.texcoords[2 * idx.texcoord_index + 0],
-                    attrib.texcoords[2 * idx.texcoord_index + 1]
-                };
+        // group submeshes by material, so that each material can be drawn in a single batch
+        std::ranges::stable_sort(objSubmeshes, {}, &ObjSubmesh::materialIndex);
+        {
+            std::vector<GLuint> sortedIndices;
+            sortedIndices.reserve(indices.size());
+
+            for (ObjSubmesh &submesh : objSubmeshes) {
+                const auto first = indices.begin() + static_cast<std::ptrdiff_t>(submesh.firstIndex);
+                const auto last = first + static_cast<std::ptrdiff_t>(submesh.indexCount);
+                submesh.firstIndex = sortedIndices.size();
+                sortedIndices.insert(sortedIndices.end(), first, last);
+            }
+
+            indices = std::move(sortedIndices);
+        }
+
+        // reorder triangles for the post-transform cache and group them into meshlets, then reorder vertices for
+        // linear fetching. submeshes are processed one by one, so their triangles stay together
+        const VertexCacheStats statsBefore = analyzeVertexCache(indices, vertices.size());
+        SubmeshVertices submeshVertices(vertices.size());
+        std::vector<Meshlet> meshlets;
+        std::vector<MeshSubmesh> submeshes;
+
+        for (const ObjSubmesh &objSubmesh : objSubmeshes) {
+            const std::span<GLuint> submeshIndices = std::span(indices).subspan(objSubmesh.firstIndex,
+                                                                                objSubmesh.indexCount);
+            submeshVertices.compact(submeshIndices, vertices);
+            const std::span<const Vertex> localVertices = submeshVertices.getVertices();
+
+            optimizeVertexCache(submeshIndices, localVertices.size());
+            if (MESH_COOK_FLAGS & MESH_COOK_OPTIMIZE_OVERDRAW) {
+                optimizeOverdraw(submeshIndices, localVertices);
+            }
+
+            std::vector<Meshlet> submeshMeshlets = buildMeshlets(submeshIndices, localVertices);
+            submeshVertices.expand(submeshIndices);
+
+            for (Meshlet &meshlet : submeshMeshlets) {
+                meshlet.firstIndex += static_cast<GLuint>(objSubmesh.firstIndex);
+            }
+
+            submeshes.push_back({
+                static_cast<GLuint>(objSubmesh.materialIndex),
+                static_cast<GLuint>(objSubmesh.firstIndex),
+                static_cast<GLuint>(objSubmesh.indexCount),
+                static_cast<GLuint>(meshlets.size()),
+                static_cast<GLuint>(submeshMeshlets.size())
+            });
+            meshlets.insert(meshlets.end(), submeshMeshlets.begin(), submeshMeshlets.end());
+        }
+
+        // coarser LODs are all simplified straight from the full-detail mesh and appended to its indices,
+        // so they share the vertex buffer. every submesh is simplified on its own, so borders between
+        // materials stay where they are
+        const std::size_t fullIndexCount = indices.size();
+        const std::size_t fullSubmeshCount = submeshes.size();
+        std::vector<MeshLod> lods = {
+            {0, static_cast<GLuint>(fullIndexCount), 0.0f, 0, static_cast<GLuint>(fullSubmeshCount)}
+        };
+
+        for (const float ratio : LOD_TRIANGLE_RATIOS) {
+            MeshLod lod{static_cast<GLuint>(indices.size()), 0, 0.0f, static_cast<GLuint>(submeshes.size()), 0};
+
+            for (std::size_t i = 0; i < fullSubmeshCount; i++) {
+                const MeshSubmesh fullSubmesh = submeshes[i];
+                const auto targetTriangleCount = static_cast<std::size_t>(
+                    static_cast<float>(fullSubmesh.indexCount / 3) * ratio);
 
-                const Vertex newVertex { position, uv };
+                const std::span<GLuint> submeshIndices = std::span(indices).subspan(fullSubmesh.firstIndex,
+                                                                                    fullSubmesh.indexCount);
+                submeshVertices.compact(submeshIndices, vertices);
+                const std::span<const Vertex> localVertices = submeshVertices.getVertices();
 
-                if (vertexToIndexMapping.contains(newVertex)) {
-                    meshIndices.emplace_back(vertexToIndexMapping.at(newVertex));
-                } else {
-                    const GLuint index = nextFreeIndex++;
-                    vertexToIndexMapping.emplace(newVertex, index);
-                    meshVertices.push_back(newVertex);
-                    meshIndices.emplace_back(index);
+                float error;
+                std::vector<GLuint> lodIndices = simplifyMesh(submeshIndices, localVertices, 3 * targetTriangleCount,
+                                                              error);
+                optimizeVertexCache(lodIndices, localVertices.size());
+
+                submeshVertices.expand(submeshIndices);
+                submeshVertices.expand(lodIndices);
+
+                if (lodIndices.empty()) {
+                    continue;
                 }
+
+                submeshes.push_back({
+                    fullSubmesh.materialIndex, static_cast<GLuint>(indices.size()),
+                    static_cast<GLuint>(lodIndices.size()), 0, 0
+                });
+                indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+                lod.error = std::max(lod.error, error);
             }
 
-            indexOffset += numFaceVertices;
+            lod.indexCount = static_cast<GLuint>(indices.size() - lod.firstIndex);
+            lod.submeshCount = static_cast<GLuint>(submeshes.size() - lod.firstSubmesh);
+            lods.push_back(lod);
+        }
+
+        optimizeVertexFetch(vertices, indices);
+        const VertexCacheStats statsAfter = analyzeVertexCache(std::span(indices).first(fullIndexCount),
+                                                               vertices.size());
+
+        std::vector<MeshMaterial> materials;
+        for (const ObjMaterial &objMaterial : objMaterials) {
+            const std::string texturePath = objMaterial.diffuseTexture.generic_string();
+            const std::string normalTexturePath = objMaterial.normalTexture.generic_string();
+            if (std::max(texturePath.size(), normalTexturePath.size()) > MeshMaterial::MAX_TEXTURE_PATH_LENGTH) {
+                throw std::runtime_error("texture path of material " + objMaterial.name + " is too long");
+            }
+
+            MeshMaterial &material = materials.emplace_back();
+            material.diffuseColor = objMaterial.diffuseColor;
+            std::ranges::copy(texturePath, material.diffuseTexture);
+            std::ranges::copy(normalTexturePath, material.normalTexture);
+        }
+
+        const std::chrono::duration<double, std::milli> cookTime = std::chrono::steady_clock::now() - cookStart;
+        std::cout << "Cooked mesh: " << sourcePath.filename() << " (" << vertices.size() << " vertices, "
+                << fullIndexCount << " indices, " << meshlets.size() << " meshlets, " << fullSubmeshCount
+                << " submeshes, " << materials.size() << " materials) in " << cookTime.count() << " ms\n";
+        std::cout << "\ttangent frames: " << tangentTime.count() << " ms, " << splitVertexCount
+                << " vertices split at mirrored texture seams\n";
+        std::cout << "\tvertex cache: ACMR " << statsBefore.acmr << " -> " << statsAfter.acmr
+                << ", ATVR " << statsBefore.atvr << " -> " << statsAfter.atvr << "\n";
+        for (std::size_t i = 1; i < lods.size(); i++) {
+            std::cout << "\tLOD " << i << ": " << lods[i].indexCount / 3 << " triangles, error " << lods[i].error
+                    << "\n";
         }
+
+        CachedMesh::write(cachePath, sourceHash, cookFlags, vertices, indices, meshlets, lods, submeshes, materials);
+    }
+
+    std::cout << "\tpeak resident memory: " << getPeakResidentMemory() / (1024 * 1024) << " MB\n";
+
+    std::unique_ptr<CachedMesh> mesh = CachedMesh::open(cachePath, sourceHash, cookFlags);
+    if (!mesh) {
+        throw std::runtime_error("failed to open freshly cooked mesh cache: " + cachePath.string());
+    }
+
+    if (isCompressed) {
+        writeCompressedMesh(threadPool, compressedCachePath, *mesh);
     }
+
+    return mesh;
+}
+
+std::unique_ptr<CachedMesh> OpenGLRenderer::loadCompressedMesh(ThreadPool &threadPool,
+                                                               const std::filesystem::path &path,
+                                                               const std::optional<std::uint64_t> sourceHash,
+                                                               const std::uint32_t cookFlags) {
+    const auto decodeStart = std::chrono::steady_clock::now();
+    std::unique_ptr<CachedMesh> mesh = CachedMesh::openCompressed(threadPool, path, sourceHash, cookFlags);
+    if (!mesh) {
+        return nullptr;
+    }
+
+    const std::chrono::duration<double> decodeTime = std::chrono::steady_clock::now() - decodeStart;
+    std::cout << "Decoded mesh: " << path.filename() << " (" << std::filesystem::file_size(path) / 1024 << " KB -> "
+            << mesh->getSizeBytes() / 1024 << " KB) in " << decodeTime.count() * 1000.0 << " ms, "
+            << static_cast<double>(mesh->getSizeBytes()) / decodeTime.count() / 1e9 << " GB/s\n";
+
+    return mesh;
 }
 
 void OpenGLRenderer::windowRefreshCallback(GLFWwindow *window) {
@@ -1,13 +1,26 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include <chrono>
+#include <future>
 #include <memory>
+#include <optional>
 
 #include "GL/glew.h"
 #include "GLFW/glfw3.h"
 
 #include "utilities/gl-shader.hpp"
+#include "utilities/thread-pool.hpp"
+#include "utilities/uniform-buffer.hpp"
+#include "bvh.hpp"
 #include "camera.hpp"
+#include "index-buffer.hpp"
+#include "mesh-cache.hpp"
+#include "meshlet-culler.hpp"
+#include "texture-cache.hpp"
+#include "texture-manager.hpp"
+#include "texture-upload-ring.hpp"
+#include "vertex-format.hpp"
 #include "vertex.hpp"
 
 class OpenGLRenderer {
@@ -15,14 +28,79 @@ class OpenGLRenderer {
     GLFWwindow *window;
 
     std::unique_ptr<GLShaders> shaders;
+    std::unique_ptr<GLShaders> overdrawShaders;
+    std::unique_ptr<GLShaders> normalMappedShaders;
+    bool isNormalMappingEnabled = true;
 
-    std::vector<Vertex> meshVertices;
-    std::vector<GLuint> meshIndices;
-    GLuint vbo;
-    GLuint vao;
-    GLuint ebo;
+    // shared by all the asset processing that can be spread over multiple cores
+    std::unique_ptr<ThreadPool> threadPool;
 
-    GLuint colorTextureID;
+    /**
+     * The mesh and its textures, with all the processing that doesn't need the GL context already done.
+     */
+    struct LoadedAssets {
+        std::unique_ptr<CachedMesh> mesh;
+        std::unique_ptr<Bvh> bvh; // over the full-detail LOD, missing for streamed meshes
+        std::unique_ptr<VertexEncoder> vertexEncoder; // vertices are only encoded as they're uploaded
+        glm::vec3 meshCenter;
+        float meshRadius;
+
+        std::vector<std::unique_ptr<CachedTexture>> textures; // full mip chains, not uploaded yet
+        std::vector<TextureSource> textureSources; // where each of `textures` can be reloaded from
+        // indices into `textures` for every material of the mesh
+        std::vector<std::size_t> materialTextures;
+        std::vector<std::size_t> materialNormalTextures;
+    };
+
+    // assets are loaded on the thread pool and then uploaded a slice at a time, see `tickAssetUpload`
+    std::future<std::unique_ptr<LoadedAssets>> pendingAssets;
+    std::unique_ptr<LoadedAssets> uploadingAssets;
+    std::size_t uploadedVertexCount = 0;
+    std::size_t uploadedIndexCount = 0;
+    std::size_t uploadedTextureCount = 0;
+    std::size_t uploadedTextureLevel = 0;
+    int uploadedTextureRows = 0; // rows of blocks, for compressed textures
+    std::unique_ptr<TextureUploadRing> textureUploadRing;
+    bool isMeshReady = false;
+
+    std::chrono::steady_clock::time_point startTime;
+    bool isFirstFramePresented = false;
+    std::size_t uploadFrameCount = 0;
+
+    std::unique_ptr<CachedMesh> mesh;
+    std::unique_ptr<Bvh> bvh;
+    GLuint vbo = 0;
+    GLuint vao = 0;
+    std::unique_ptr<IndexBuffer> indexBuffer;
+
+    // undoes position quantization of the uploaded vertex format, see `VertexEncoder`
+    glm::mat4 positionDecodeMatrix;
+
+    std::unique_ptr<MeshletCuller> meshletCuller;
+    std::vector<DrawRange> visibleRanges;
+    std::size_t visibleMeshletCount = 0;
+    bool isMeshletCullingEnabled = true;
+
+    glm::vec3 meshCenter;
+    float meshRadius;
+    std::size_t currentLod = 0;
+
+    // owns all the textures, keeping them within a memory budget
+    std::unique_ptr<TextureManager> textureManager;
+    // indices into `textureManager` for every material of the mesh
+    std::vector<std::size_t> materialTextures;
+    std::vector<std::size_t> materialNormalTextures;
+
+    // reused between frames to avoid allocating every frame
+    std::vector<DrawRange> batchRanges;
+    std::size_t drawBatchCount = 0;
+
+    // texture arrays actually bound by the last `drawMesh`, rather than already being there
+    std::size_t textureBindCount = 0;
+
+    // the mesh is the only object drawn, so each buffer holds a single block
+    std::unique_ptr<UniformBuffer<FrameUniforms>> frameUniforms;
+    std::unique_ptr<UniformBuffer<ObjectUniforms>> objectUniforms;
 
     // camera stuff won't change too much; we're moving it to a separate class to avoid clutter
     std::unique_ptr<Camera> camera;
@@ -55,14 +133,122 @@ public:
      * Wraps up the rendering process.
      * Should be called after all rendering in the current tick has been finished.
      */
-    void finishRendering() const;
+    void finishRendering();
 
 private:
-    void prepareBuffers();
+    /**
+     * Draws the mesh at the LOD picked for the current camera. At full detail, only meshlets which survive culling
+     * are drawn, unless culling is off.
+     *
+     * The mesh is drawn in one batch per material. If `isShaded` is set, each batch first sets its material's color
+     * and texture layers in the shaders returned by `getShadingShaders`, which have to be enabled, and binds the
+     * arrays holding those layers if the previous batch used different ones.
+     */
+    void drawMesh(bool isShaded);
+
+    /**
+     * Uploads and binds the per-frame block for the current camera, and the mesh's per-object block.
+     */
+    void updateUniformBuffers() const;
 
-    void loadTextures();
+    /**
+     * The shaders the mesh is currently shaded with -- the normal-mapped ones, unless normal mapping is off.
+     */
+    GLShaders &getShadingShaders() const;
 
-    void loadMesh();
+    /**
+     * Picks the coarsest LOD of the mesh whose error, projected onto the screen from the current camera,
+     * stays below a pixel.
+     */
+    std::size_t selectLod() const;
+
+    /**
+     * Renders the mesh from the current camera into an offscreen target with additive blending, counting
+     * fragments that pass the depth test, and prints the average overdraw per covered pixel.
+     */
+    void measureOverdraw();
+
+    /**
+     * Times drawing the mesh with every `VertexFormat` into a 1x1 viewport, where practically all the work is
+     * vertex fetching and transformation, and prints the results.
+     */
+    void benchmarkVertexFormats();
+
+    /**
+     * Casts a ray from the camera through the cursor and prints which triangle of the mesh it hits first.
+     */
+    void pickTriangle() const;
+
+    /**
+     * Traces a grid of rays from the current camera through the mesh's BVH, and through all of its triangles
+     * for comparison, and prints the BVH's build time and the throughput of both.
+     */
+    void benchmarkRayQueries() const;
+
+    /**
+     * Welds the mesh's corners, and those of a synthetic grid of about 10M indices, both with the
+     * `std::unordered_map` vertices used to be welded with and with `VertexWelder`, and prints the time each took.
+     */
+    void benchmarkVertexWelding() const;
+
+    /**
+     * Times setting a uniform of the shading shaders over and over -- looked up in a map by a string built from a
+     * literal, the way `GLShaders` used to, by a literal hashed at compile time, and through a handle, as well as
+     * through a handle to a value it already has -- and prints the time per call of each.
+     */
+    void benchmarkUniformLookups();
+
+    /**
+     * Loads the mesh and its textures (cooking them if needed) and builds its BVH. Doesn't touch the GL context,
+     * so it's meant to run on the thread pool.
+     */
+    static std::unique_ptr<LoadedAssets> loadAssets(ThreadPool &threadPool,
+                                                    std::optional<BlockQuality> textureCompression);
+
+    /**
+     * Prints the texture manager's counters gathered since the last time, along with how much memory the textures
+     * take right now.
+     */
+    void printTextureStats();
+
+    /**
+     * Prints how many calls of every kind the GL shadow state has issued and skipped since the last time.
+     */
+    void printGLStateStats();
+
+    /**
+     * Maps the texture's cooked mip chain from the cache described by `source`, or decodes and cooks the texture
+     * (writing the cache) if there's no usable cache yet.
+     */
+    static std::unique_ptr<CachedTexture> loadTexture(ThreadPool &threadPool, const std::filesystem::path &path,
+                                                      const TextureSource &source);
+
+    static std::unique_ptr<CachedMesh> loadMesh(ThreadPool &threadPool);
+
+    /**
+     * Decodes the compressed mesh cache, if it's usable, and prints how long that took.
+     */
+    static std::unique_ptr<CachedMesh> loadCompressedMesh(ThreadPool &threadPool, const std::filesystem::path &path,
+                                                          std::optional<std::uint64_t> sourceHash,
+                                                          std::uint32_t cookFlags);
+
+    /**
+     * Picks up the assets once they're loaded and uploads as much of them as fits in the per-frame time budget.
+     * Textures are handed to the upload ring instead, which copies them on the workers. Once everything is uploaded,
+     * the mesh starts being drawn.
+     */
+    void tickAssetUpload();
+
+    /**
+     * Slices the next texture levels to upload into uploads taking at most the given number of bytes in total, and
+     * moves past them.
+     */
+    std::vector<TextureUpload> getNextTextureUploads(std::size_t maxBytes);
+
+    /**
+     * Creates the GL objects for freshly loaded assets, without uploading any of their data yet.
+     */
+    void prepareBuffers();
 
     static void windowRefreshCallback(GLFWwindow *window);
 
@@ -0,0 +1,350 @@
+#include "tangent-frames.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "mesh-optimizer.hpp"
+
+// triangles are gathered into blocks of this many before any math is done on them
+static constexpr std::size_t TRIANGLE_BLOCK_SIZE = 256;
+
+// the work per triangle or vertex is just a few dozen instructions, so thread pool tasks need plenty of them
+static constexpr std::size_t MIN_TRIANGLE_CHUNK = 16384;
+static constexpr std::size_t MIN_VERTEX_CHUNK = 16384;
+
+static constexpr GLuint NO_VERTEX = ~GLuint{0};
+
+/**
+ * Per-triangle results of the first pass, as structures of arrays.
+ */
+struct TriangleFrames {
+    std::vector<float> normalX, normalY, normalZ;
+    std::vector<float> tangentX, tangentY, tangentZ;
+
+    // 1 or -1 depending on whether the texture mapping is mirrored, 0 if it's degenerate
+    std::vector<float> orientations;
+
+    // 3 per triangle, in the order of its indices
+    std::vector<float> cornerAngles;
+};
+
+/**
+ * Tangents of the triangles projected onto the tangent plane of each of their corners and weighted by the
+ * corner's angle in that plane, as structures of arrays with 3 entries per triangle.
+ */
+struct CornerTangents {
+    std::vector<float> x, y, z;
+};
+
+/**
+ * Computes the unit normal, unit tangent, orientation and corner angles of the triangles in [begin, end).
+ * Degenerate triangles get a zero normal, and ones with a degenerate texture mapping get a zero tangent.
+ */
+static void computeTriangleFrames(const std::span<const GLuint> indices, const std::span<const Vertex> vertices,
+                                  const std::size_t begin, const std::size_t end, TriangleFrames &frames) {
+    // corner attributes of the current block, indexed by [corner][triangle]
+    float px[3][TRIANGLE_BLOCK_SIZE], py[3][TRIANGLE_BLOCK_SIZE], pz[3][TRIANGLE_BLOCK_SIZE];
+    float u[3][TRIANGLE_BLOCK_SIZE], v[3][TRIANGLE_BLOCK_SIZE];
+
+    for (std::size_t blockBegin = begin; blockBegin < end; blockBegin += TRIANGLE_BLOCK_SIZE) {
+        const std::size_t count = std::min(TRIANGLE_BLOCK_SIZE, end - blockBegin);
+
+        // the gather is the only part of the pass that doesn't vectorize
+        for (std::size_t i = 0; i < count; i++) {
+            for (int k = 0; k < 3; k++) {
+                const Vertex &vertex = vertices[indices[3 * (blockBegin + i) + k]];
+                px[k][i] = vertex.position.x;
+                py[k][i] = vertex.position.y;
+                pz[k][i] = vertex.position.z;
+                u[k][i] = vertex.uv.x;
+                v[k][i] = vertex.uv.y;
+            }
+        }
+
+        float *__restrict nx = frames.normalX.data() + blockBegin;
+        float *__restrict ny = frames.normalY.data() + blockBegin;
+        float *__restrict nz = frames.normalZ.data() + blockBegin;
+        float *__restrict tx = frames.tangentX.data() + blockBegin;
+        float *__restrict ty = frames.tangentY.data() + blockBegin;
+        float *__restrict tz = frames.tangentZ.data() + blockBegin;
+        float *__restrict orientations = frames.orientations.data() + blockBegin;
+        float *__restrict cosines = frames.cornerAngles.data() + 3 * blockBegin;
+
+        for (std::size_t i = 0; i < count; i++) {
+            const float e1x = px[1][i] - px[0][i], e1y = py[1][i] - py[0][i], e1z = pz[1][i] - pz[0][i];
+            const float e2x = px[2][i] - px[0][i], e2y = py[2][i] - py[0][i], e2z = pz[2][i] - pz[0][i];
+            const float e3x = px[2][i] - px[1][i], e3y = py[2][i] - py[1][i], e3z = pz[2][i] - pz[1][i];
+
+            const float crossX = e1y * e2z - e1z * e2y;
+            const float crossY = e1z * e2x - e1x * e2z;
+            const float crossZ = e1x * e2y - e1y * e2x;
+            const float crossLength = std::sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ);
+            const float normalScale = crossLength > 0.0f ? 1.0f / crossLength : 0.0f;
+
+            nx[i] = crossX * normalScale;
+            ny[i] = crossY * normalScale;
+            nz[i] = crossZ * normalScale;
+
+            // MikkTSpace's vOs -- the direction in which u grows, scaled by the signed area of the triangle in uv space
+            const float du1 = u[1][i] - u[0][i], dv1 = v[1][i] - v[0][i];
+            const float du2 = u[2][i] - u[0][i], dv2 = v[2][i] - v[0][i];
+            const float signedArea = du1 * dv2 - dv1 * du2;
+
+            const float osX = dv2 * e1x - dv1 * e2x;
+            const float osY = dv2 * e1y - dv1 * e2y;
+            const float osZ = dv2 * e1z - dv1 * e2z;
+            const float osLength = std::sqrt(osX * osX + osY * osY + osZ * osZ);
+
+            const bool isMappingValid = std::abs(signedArea) > std::numeric_limits<float>::min()
+                                        && osLength > std::numeric_limits<float>::min();
+            const float orientation = signedArea > 0.0f ? 1.0f : -1.0f;
+            const float tangentScale = isMappingValid ? orientation / osLength : 0.0f;
+
+            tx[i] = osX * tangentScale;
+            ty[i] = osY * tangentScale;
+            tz[i] = osZ * tangentScale;
+            orientations[i] = isMappingValid ? orientation : 0.0f;
+
+            // cosines of the angles at the corners, turned into angles below
+            const float length1 = std::sqrt(e1x * e1x + e1y * e1y + e1z * e1z);
+            const float length2 = std::sqrt(e2x * e2x + e2y * e2y + e2z * e2z);
+            const float length3 = std::sqrt(e3x * e3x + e3y * e3y + e3z * e3z);
+            const float inverse1 = length1 > 0.0f ? 1.0f / length1 : 0.0f;
+            const float inverse2 = length2 > 0.0f ? 1.0f / length2 : 0.0f;
+            const float inverse3 = length3 > 0.0f ? 1.0f / length3 : 0.0f;
+
+            cosines[3 * i] = (e1x * e2x + e1y * e2y + e1z * e2z) * inverse1 * inverse2;
+            cosines[3 * i + 1] = -(e1x * e3x + e1y * e3y + e1z * e3z) * inverse1 * inverse3;
+            cosines[3 * i + 2] = (e2x * e3x + e2y * e3y + e2z * e3z) * inverse2 * inverse3;
+        }
+
+        // acos doesn't vectorize without a vector math library, so it gets a loop of its own
+        for (std::size_t i = 0; i < 3 * count; i++) {
+            cosines[i] = std::acos(std::clamp(cosines[i], -1.0f, 1.0f));
+        }
+    }
+}
+
+/**
+ * Computes the tangent contributions of the corners of the triangles in [begin, end), given the final normals.
+ */
+static void computeCornerTangents(const std::span<const GLuint> indices, const std::span<const Vertex> vertices,
+                                  const std::span<const GLuint> positionIds,
+                                  const std::span<const glm::vec3> positionNormals, const TriangleFrames &frames,
+                                  const std::size_t begin, const std::size_t end, CornerTangents &cornerTangents) {
+    // corner attributes of the current block, indexed by [corner][triangle]
+    float px[3][TRIANGLE_BLOCK_SIZE], py[3][TRIANGLE_BLOCK_SIZE], pz[3][TRIANGLE_BLOCK_SIZE];
+    float nx[3][TRIANGLE_BLOCK_SIZE], ny[3][TRIANGLE_BLOCK_SIZE], nz[3][TRIANGLE_BLOCK_SIZE];
+    float tx[3][TRIANGLE_BLOCK_SIZE], ty[3][TRIANGLE_BLOCK_SIZE], tz[3][TRIANGLE_BLOCK_SIZE];
+    float angles[3][TRIANGLE_BLOCK_SIZE];
+
+    for (std::size_t blockBegin = begin; blockBegin < end; blockBegin += TRIANGLE_BLOCK_SIZE) {
+        const std::size_t count = std::min(TRIANGLE_BLOCK_SIZE, end - blockBegin);
+
+        for (std::size_t i = 0; i < count; i++) {
+            for (int k = 0; k < 3; k++) {
+                const GLuint vertex = indices[3 * (blockBegin + i) + k];
+                const glm::vec3 &position = vertices[vertex].position;
+                const glm::vec3 &normal = positionNormals[positionIds[vertex]];
+                px[k][i] = position.x;
+                py[k][i] = position.y;
+                pz[k][i] = position.z;
+                nx[k][i] = normal.x;
+                ny[k][i] = normal.y;
+                nz[k][i] = normal.z;
+            }
+        }
+
+        const float *__restrict faceX = frames.tangentX.data() + blockBegin;
+        const float *__restrict faceY = frames.tangentY.data() + blockBegin;
+        const float *__restrict faceZ = frames.tangentZ.data() + blockBegin;
+
+        // the same math for every corner, just with the triangle's vertices rotated
+        for (int k = 0; k < 3; k++) {
+            const int next = (k + 1) % 3;
+            const int previous = (k + 2) % 3;
+
+            for (std::size_t i = 0; i < count; i++) {
+                const float n1 = nx[k][i], n2 = ny[k][i], n3 = nz[k][i];
+
+                // the face tangent and both edges leaving the corner, projected onto the vertex's tangent plane
+                const float faceDot = n1 * faceX[i] + n2 * faceY[i] + n3 * faceZ[i];
+                const float t1 = faceX[i] - n1 * faceDot, t2 = faceY[i] - n2 * faceDot, t3 = faceZ[i] - n3 * faceDot;
+
+                const float a1 = px[next][i] - px[k][i], a2 = py[next][i] - py[k][i], a3 = pz[next][i] - pz[k][i];
+                const float b1 = px[previous][i] - px[k][i], b2 = py[previous][i] - py[k][i];
+                const float b3 = pz[previous][i] - pz[k][i];
+                const float aDot = n1 * a1 + n2 * a2 + n3 * a3;
+                const float bDot = n1 * b1 + n2 * b2 + n3 * b3;
+                const float pa1 = a1 - n1 * aDot, pa2 = a2 - n2 * aDot, pa3 = a3 - n3 * aDot;
+                const float pb1 = b1 - n1 * bDot, pb2 = b2 - n2 * bDot, pb3 = b3 - n3 * bDot;
+
+                const float tangentLength = std::sqrt(t1 * t1 + t2 * t2 + t3 * t3);
+                const float tangentScale = tangentLength > 0.0f ? 1.0f / tangentLength : 0.0f;
+                const float edgeLengths = std::sqrt((pa1 * pa1 + pa2 * pa2 + pa3 * pa3)
+                                                    * (pb1 * pb1 + pb2 * pb2 + pb3 * pb3));
+
+                tx[k][i] = t1 * tangentScale;
+                ty[k][i] = t2 * tangentScale;
+                tz[k][i] = t3 * tangentScale;
+                angles[k][i] = edgeLengths > 0.0f ? (pa1 * pb1 + pa2 * pb2 + pa3 * pb3) / edgeLengths : 1.0f;
+            }
+        }
+
+        float *__restrict outX = cornerTangents.x.data() + 3 * blockBegin;
+        float *__restrict outY = cornerTangents.y.data() + 3 * blockBegin;
+        float *__restrict outZ = cornerTangents.z.data() + 3 * blockBegin;
+
+        for (int k = 0; k < 3; k++) {
+            for (std::size_t i = 0; i < count; i++) {
+                const float angle = std::acos(std::clamp(angles[k][i], -1.0f, 1.0f));
+                outX[3 * i + k] = tx[k][i] * angle;
+                outY[3 * i + k] = ty[k][i] * angle;
+                outZ[3 * i + k] = tz[k][i] * angle;
+            }
+        }
+    }
+}
+
+/**
+ * Groups corners (i.e. entries of `indices`) by `groupOf(vertex)`, in compressed sparse row form:
+ * the corners of group `g` are `corners[offsets[g]]` up to `corners[offsets[g + 1]]`.
+ */
+template <typename GroupOf>
+static void groupCorners(const std::span<const GLuint> indices, const std::size_t groupCount, GroupOf groupOf,
+                         std::vector<GLuint> &offsets, std::vector<GLuint> &corners) {
+    offsets.assign(groupCount + 1, 0);
+    for (const GLuint index : indices) {
+        offsets[groupOf(index) + 1]++;
+    }
+
+    for (std::size_t g = 0; g < groupCount; g++) {
+        offsets[g + 1] += offsets[g];
+    }
+
+    std::vector<GLuint> cursors(offsets.begin(), offsets.end() - 1);
+    corners.resize(indices.size());
+
+    for (std::size_t corner = 0; corner < indices.size(); corner++) {
+        corners[cursors[groupOf(indices[corner])]++] = static_cast<GLuint>(corner);
+    }
+}
+
+/**
+ * Any unit vector perpendicular to `normal`, for vertices whose triangles don't define a tangent.
+ */
+static glm::vec3 getAnyPerpendicular(const glm::vec3 &normal) {
+    const glm::vec3 axis = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::normalize(glm::cross(normal, axis));
+}
+
+void generateTangentFrames(ThreadPool &threadPool, std::vector<Vertex> &vertices, const std::span<GLuint> indices) {
+    const std::size_t triangleCount = indices.size() / 3;
+
+    TriangleFrames frames;
+    for (std::vector<float> *values : {&frames.normalX, &frames.normalY, &frames.normalZ, &frames.tangentX,
+                                       &frames.tangentY, &frames.tangentZ, &frames.orientations}) {
+        values->resize(triangleCount);
+    }
+    frames.cornerAngles.resize(3 * triangleCount);
+
+    threadPool.parallelFor(triangleCount, MIN_TRIANGLE_CHUNK, [&](const std::size_t begin, const std::size_t end) {
+        computeTriangleFrames(indices, vertices, begin, end, frames);
+    });
+
+    // a vertex used by both mirrored and non-mirrored triangles gets a twin for the mirrored ones, since the two
+    // sides need bitangents pointing in opposite directions. triangles with a degenerate mapping don't count
+    std::vector<std::uint8_t> orientationMasks(vertices.size());
+    for (std::size_t corner = 0; corner < 3 * triangleCount; corner++) {
+        const float orientation = frames.orientations[corner / 3];
+        orientationMasks[indices[corner]] |= orientation > 0.0f ? 1 : orientation < 0.0f ? 2 : 0;
+    }
+
+    std::vector<GLuint> mirroredTwins(vertices.size(), NO_VERTEX);
+    for (std::size_t corner = 0; corner < 3 * triangleCount; corner++) {
+        const GLuint vertex = indices[corner];
+        if (orientationMasks[vertex] != 3 || frames.orientations[corner / 3] >= 0.0f) {
+            continue;
+        }
+
+        if (mirroredTwins[vertex] == NO_VERTEX) {
+            mirroredTwins[vertex] = static_cast<GLuint>(vertices.size());
+            vertices.push_back(vertices[vertex]);
+        }
+
+        indices[corner] = mirroredTwins[vertex];
+    }
+
+    // normals are shared by all vertices at the same position, so that they're smooth across texture seams
+    std::size_t positionCount;
+    const std::vector<GLuint> positionIds = getPositionIds(vertices, positionCount);
+
+    std::vector<GLuint> offsets, corners;
+    const std::span<const GLuint> cornerIndices = indices.first(3 * triangleCount);
+    groupCorners(cornerIndices, positionCount, [&](const GLuint vertex) { return positionIds[vertex]; },
+                 offsets, corners);
+
+    std::vector<glm::vec3> positionNormals(positionCount);
+
+    threadPool.parallelFor(positionCount, MIN_VERTEX_CHUNK, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t position = begin; position < end; position++) {
+            glm::vec3 normal(0.0f);
+
+            for (GLuint i = offsets[position]; i < offsets[position + 1]; i++) {
+                const GLuint corner = corners[i];
+                const std::size_t triangle = corner / 3;
+                const glm::vec3 faceNormal(frames.normalX[triangle], frames.normalY[triangle],
+                                           frames.normalZ[triangle]);
+                normal += faceNormal * frames.cornerAngles[corner];
+            }
+
+            const float length = glm::length(normal);
+
+            // isolated or fully degenerate geometry has no meaningful normal, but it still has to be a unit vector
+            positionNormals[position] = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        }
+    });
+
+    // normals are final, so the per-triangle data only needed for them can go
+    for (std::vector<float> *values : {&frames.normalX, &frames.normalY, &frames.normalZ, &frames.cornerAngles}) {
+        values->clear();
+        values->shrink_to_fit();
+    }
+
+    CornerTangents cornerTangents;
+    cornerTangents.x.resize(3 * triangleCount);
+    cornerTangents.y.resize(3 * triangleCount);
+    cornerTangents.z.resize(3 * triangleCount);
+
+    threadPool.parallelFor(triangleCount, MIN_TRIANGLE_CHUNK, [&](const std::size_t begin, const std::size_t end) {
+        computeCornerTangents(indices, vertices, positionIds, positionNormals, frames, begin, end, cornerTangents);
+    });
+
+    groupCorners(cornerIndices, vertices.size(), [](const GLuint vertex) { return vertex; }, offsets, corners);
+
+    threadPool.parallelFor(vertices.size(), MIN_VERTEX_CHUNK, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t vertex = begin; vertex < end; vertex++) {
+            const glm::vec3 normal = positionNormals[positionIds[vertex]];
+            glm::vec3 tangent(0.0f);
+            float orientation = 1.0f;
+
+            for (GLuint i = offsets[vertex]; i < offsets[vertex + 1]; i++) {
+                const GLuint corner = corners[i];
+                tangent += glm::vec3(cornerTangents.x[corner], cornerTangents.y[corner], cornerTangents.z[corner]);
+
+                // after splitting, all the triangles with a valid mapping around a vertex agree on this
+                if (frames.orientations[corner / 3] != 0.0f) {
+                    orientation = frames.orientations[corner / 3];
+                }
+            }
+
+            const float length = glm::length(tangent);
+            tangent = length > 0.0f ? tangent / length : getAnyPerpendicular(normal);
+
+            vertices[vertex].normal = normal;
+            vertices[vertex].tangent = glm::vec4(tangent, orientation);
+        }
+    });
+}
@@ -0,0 +1,27 @@
+#ifndef TANGENT_FRAMES_HPP
+#define TANGENT_FRAMES_HPP
+
+#include <span>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "utilities/thread-pool.hpp"
+#include "vertex.hpp"
+
+/**
+ * Fills in the normal and tangent of every vertex of a welded triangle list.
+ *
+ * Normals are the angle-weighted average of the normals of all triangles around the vertex's position, so they
+ * stay smooth across texture seams. Tangents follow MikkTSpace: every triangle's tangent is the direction in
+ * which its u coordinate grows, and the tangents of the triangles around a vertex are projected onto the plane
+ * of its normal and averaged, weighted by the angle of each triangle at that corner, as projected onto the same
+ * plane. A vertex shared by triangles whose texture mapping is mirrored relative to each other can't have a single
+ * tangent frame, so it gets split in two -- `vertices` may grow and `indices` are updated accordingly.
+ *
+ * Per-triangle work is done in blocks laid out as structures of arrays, which compilers turn into SIMD code,
+ * and every stage is spread over the thread pool.
+ */
+void generateTangentFrames(ThreadPool &threadPool, std::vector<Vertex> &vertices, std::span<GLuint> indices);
+
+#endif //TANGENT_FRAMES_HPP
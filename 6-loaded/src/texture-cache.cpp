@@ -0,0 +1,392 @@
+#include "texture-cache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+static constexpr std::size_t TEXEL_SIZE = 4;
+
+// linear values are turned back into sRGB through a table this large. it's fine enough for every entry to round to
+// the same sRGB value as the exact conversion would, except right at the boundaries between two of them
+static constexpr std::size_t LINEAR_TO_SRGB_TABLE_SIZE = 16384;
+
+// output rows of a level are filtered in chunks of at least this many, spread over the thread pool
+static constexpr std::size_t MIN_ROWS_PER_CHUNK = 8;
+
+static constexpr std::uint64_t alignUp(const std::uint64_t value, const std::uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static const std::array<float, 256> &getSrgbToLinearTable() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> values{};
+        for (std::size_t i = 0; i < values.size(); i++) {
+            const float srgb = static_cast<float>(i) / 255.0f;
+            values[i] = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+        }
+
+        return values;
+    }();
+
+    return table;
+}
+
+static const std::array<std::uint8_t, LINEAR_TO_SRGB_TABLE_SIZE> &getLinearToSrgbTable() {
+    static const std::array<std::uint8_t, LINEAR_TO_SRGB_TABLE_SIZE> table = [] {
+        std::array<std::uint8_t, LINEAR_TO_SRGB_TABLE_SIZE> values{};
+        for (std::size_t i = 0; i < values.size(); i++) {
+            const float linear = static_cast<float>(i) / (LINEAR_TO_SRGB_TABLE_SIZE - 1);
+            const float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+            values[i] = static_cast<std::uint8_t>(std::clamp(srgb * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+
+        return values;
+    }();
+
+    return table;
+}
+
+static std::uint8_t encodeUnorm(const float value) {
+    return static_cast<std::uint8_t>(std::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+/**
+ * Turns a row of a level into the floats it's filtered as, `paddedWidth` texels long. Past the end of the row, its
+ * last texel is repeated -- this only happens for rows a single texel wide.
+ */
+static void decodeRow(const std::uint8_t *row, const std::size_t width, const std::size_t paddedWidth,
+                      const TextureKind kind, float *texels) {
+    const std::array<float, 256> &srgbToLinear = getSrgbToLinearTable();
+
+    for (std::size_t x = 0; x < paddedWidth; x++) {
+        const std::uint8_t *texel = row + std::min(x, width - 1) * TEXEL_SIZE;
+        float *decoded = texels + x * TEXEL_SIZE;
+
+        for (std::size_t channel = 0; channel < 3; channel++) {
+            decoded[channel] = kind == TextureKind::COLOR ? srgbToLinear[texel[channel]]
+                               : kind == TextureKind::NORMAL ? static_cast<float>(texel[channel]) / 127.5f - 1.0f
+                               : static_cast<float>(texel[channel]) / 255.0f;
+        }
+
+        decoded[3] = static_cast<float>(texel[3]) / 255.0f;
+    }
+}
+
+static void encodeRow(const float *texels, const std::size_t width, const TextureKind kind, std::uint8_t *row) {
+    const std::array<std::uint8_t, LINEAR_TO_SRGB_TABLE_SIZE> &linearToSrgb = getLinearToSrgbTable();
+
+    for (std::size_t x = 0; x < width; x++) {
+        const float *texel = texels + x * TEXEL_SIZE;
+        std::uint8_t *encoded = row + x * TEXEL_SIZE;
+
+        if (kind == TextureKind::COLOR) {
+            for (std::size_t channel = 0; channel < 3; channel++) {
+                const float index = std::clamp(texel[channel], 0.0f, 1.0f) * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f;
+                encoded[channel] = linearToSrgb[static_cast<std::size_t>(index)];
+            }
+        } else if (kind == TextureKind::NORMAL) {
+            // averaged normals are shorter than unit length, the more so the more they diverge
+            const float length = std::sqrt(texel[0] * texel[0] + texel[1] * texel[1] + texel[2] * texel[2]);
+            const float scale = length > 1e-6f ? 0.5f / length : 0.0f;
+
+            encoded[0] = encodeUnorm(texel[0] * scale + 0.5f);
+            encoded[1] = encodeUnorm(texel[1] * scale + 0.5f);
+            encoded[2] = length > 1e-6f ? encodeUnorm(texel[2] * scale + 0.5f) : 255;
+        } else {
+            for (std::size_t channel = 0; channel < 3; channel++) {
+                encoded[channel] = encodeUnorm(texel[channel]);
+            }
+        }
+
+        encoded[3] = encodeUnorm(texel[3]);
+    }
+}
+
+/**
+ * The source texels a texel of the next level covers along one dimension -- up to three of them from `first` on,
+ * with the weights they're averaged with.
+ */
+struct FilterTaps {
+    std::size_t first;
+    std::array<float, 3> weights;
+};
+
+static FilterTaps getFilterTaps(const std::size_t x, const std::size_t sourceSize, const std::size_t targetSize) {
+    // halving an even size simply pairs texels up. a dimension which is a single texel already is "halved" by
+    // averaging that texel with itself, as reads past the last one are clamped
+    if (sourceSize % 2 == 0 || sourceSize == 1) {
+        return {2 * x, {0.5f, 0.5f, 0.0f}};
+    }
+
+    // halving an odd size, rounding down, leaves a texel over, so every target texel covers 2 + 1 / targetSize
+    // source texels instead. the weights shift from the first of the three towards the last one along the row, so
+    // that every source texel contributes the same in total and none of them is skipped
+    const float scale = 1.0f / static_cast<float>(2 * targetSize + 1);
+    return {
+        2 * x, {
+            static_cast<float>(targetSize - x) * scale,
+            static_cast<float>(targetSize) * scale,
+            static_cast<float>(x + 1) * scale
+        }
+    };
+}
+
+/**
+ * Filters a level down into the next one, which is half its size, rounded down. Along even dimensions, every output
+ * texel is the average of the two texels it covers. Along odd ones, three texels are weighted so that all of the
+ * source level is covered, the last row or column included -- see `getFilterTaps`.
+ */
+static void filterLevel(ThreadPool &threadPool, const std::uint8_t *source, const std::size_t sourceWidth,
+                        const std::size_t sourceHeight, std::uint8_t *target, const std::size_t targetWidth,
+                        const std::size_t targetHeight, const TextureKind kind) {
+    const std::size_t sourceRowSize = sourceWidth * TEXEL_SIZE;
+    const std::size_t targetRowSize = targetWidth * TEXEL_SIZE;
+
+    // decoded rows are padded to cover the last texel's taps, which are clamped to the row by `decodeRow`
+    const std::size_t paddedWidth = 2 * targetWidth + 1;
+
+    std::vector<FilterTaps> columnTaps(targetWidth);
+    for (std::size_t x = 0; x < targetWidth; x++) {
+        columnTaps[x] = getFilterTaps(x, sourceWidth, targetWidth);
+    }
+
+    threadPool.parallelFor(targetHeight, MIN_ROWS_PER_CHUNK, [&](const std::size_t begin, const std::size_t end) {
+        // the source rows are decoded first, so the filter itself is a plain loop over floats. only the conversions
+        // from and to 8 bits go through tables
+        std::array<std::vector<float>, 3> sourceRows;
+        for (std::vector<float> &row : sourceRows) {
+            row.resize(paddedWidth * TEXEL_SIZE);
+        }
+        std::vector<float> filteredRow(targetRowSize);
+
+        for (std::size_t y = begin; y < end; y++) {
+            const FilterTaps rowTaps = getFilterTaps(y, sourceHeight, targetHeight);
+
+            for (std::size_t i = 0; i < sourceRows.size(); i++) {
+                // rows which aren't weighted at all don't need decoding, they're only ever multiplied by 0
+                if (rowTaps.weights[i] > 0.0f) {
+                    const std::size_t sourceY = std::min(rowTaps.first + i, sourceHeight - 1);
+                    decodeRow(source + sourceY * sourceRowSize, sourceWidth, paddedWidth, kind, sourceRows[i].data());
+                }
+            }
+
+            float *filtered = filteredRow.data();
+
+            for (std::size_t x = 0; x < targetWidth; x++) {
+                const FilterTaps &taps = columnTaps[x];
+
+                for (std::size_t channel = 0; channel < TEXEL_SIZE; channel++) {
+                    float sum = 0.0f;
+
+                    for (std::size_t i = 0; i < sourceRows.size(); i++) {
+                        const float *texels = sourceRows[i].data() + taps.first * TEXEL_SIZE + channel;
+                        sum += rowTaps.weights[i] * (taps.weights[0] * texels[0]
+                                                     + taps.weights[1] * texels[TEXEL_SIZE]
+                                                     + taps.weights[2] * texels[2 * TEXEL_SIZE]);
+                    }
+
+                    filtered[x * TEXEL_SIZE + channel] = sum;
+                }
+            }
+
+            encodeRow(filtered, targetWidth, kind, target + y * targetRowSize);
+        }
+    });
+}
+
+std::unique_ptr<CachedTexture> CachedTexture::open(const std::filesystem::path &path, const std::uint64_t sourceHash,
+                                                   const TextureKind kind,
+                                                   const std::optional<BlockQuality> compression) {
+    if (!std::filesystem::exists(path)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<CachedTexture> texture(new CachedTexture());
+    texture->file.emplace(path);
+    texture->data = texture->file->getData();
+
+    if (!texture->isValid(sourceHash, kind, compression)) {
+        return nullptr;
+    }
+
+    return texture;
+}
+
+std::unique_ptr<CachedTexture> CachedTexture::cook(ThreadPool &threadPool, const DecodedTexture &image,
+                                                   const std::uint64_t sourceHash, const TextureKind kind,
+                                                   const std::optional<BlockQuality> compression) {
+    if (image.channelCount != static_cast<int>(TEXEL_SIZE) || image.width <= 0 || image.height <= 0) {
+        throw std::runtime_error("only non-empty RGBA8 images can be cooked into textures");
+    }
+
+    TextureCacheHeader header{};
+    header.magic      = TextureCacheHeader::MAGIC;
+    header.version    = TextureCacheHeader::VERSION;
+    header.sourceHash = sourceHash;
+    header.kind       = kind;
+    header.format     = TextureFormat::RGBA8;
+    header.quality    = BlockQuality::FAST;
+    header.basePsnr   = std::numeric_limits<double>::infinity();
+
+    // every level halves the size of the previous one, rounding down, until both dimensions reach 1
+    auto width = static_cast<std::uint32_t>(image.width);
+    auto height = static_cast<std::uint32_t>(image.height);
+    std::uint64_t offset = alignUp(sizeof(TextureCacheHeader), 16);
+
+    while (true) {
+        if (header.levelCount == TextureCacheHeader::MAX_LEVEL_COUNT) {
+            throw std::runtime_error("texture is too large to be cooked");
+        }
+
+        const std::uint64_t size = std::uint64_t{width} * height * TEXEL_SIZE;
+        header.levels[header.levelCount++] = {width, height, offset, size};
+        offset = alignUp(offset + size, 16);
+
+        if (width == 1 && height == 1) {
+            break;
+        }
+
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    std::unique_ptr<CachedTexture> texture(new CachedTexture());
+    texture->cookedData.resize(offset);
+    texture->data = texture->cookedData;
+
+    std::byte *base = texture->cookedData.data();
+    std::memcpy(base, &header, sizeof(header));
+    std::memcpy(base + header.levels[0].offset, image.pixels.get(), header.levels[0].size);
+
+    for (std::size_t level = 1; level < header.levelCount; level++) {
+        const TextureCacheLevel &source = header.levels[level - 1];
+        const TextureCacheLevel &target = header.levels[level];
+
+        filterLevel(threadPool, reinterpret_cast<const std::uint8_t *>(base + source.offset), source.width,
+                    source.height, reinterpret_cast<std::uint8_t *>(base + target.offset), target.width,
+                    target.height, kind);
+    }
+
+    // the mips are filtered from uncompressed levels, so compression errors don't pile up down the chain
+    if (compression) {
+        return compress(threadPool, *texture, *compression);
+    }
+
+    return texture;
+}
+
+void CachedTexture::write(const std::filesystem::path &path) const {
+    const std::filesystem::path tempPath = path.string() + ".tmp";
+
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("failed to open texture cache for writing: " + tempPath.string());
+        }
+
+        out.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+
+        if (!out.good()) {
+            throw std::runtime_error("failed to write texture cache: " + tempPath.string());
+        }
+    }
+
+    std::filesystem::rename(tempPath, path);
+}
+
+TextureLevel CachedTexture::getLevel(const std::size_t level) const {
+    const TextureCacheLevel &placement = getHeader().levels[level];
+
+    return {
+        static_cast<int>(placement.width),
+        static_cast<int>(placement.height),
+        data.subspan(placement.offset, placement.size)
+    };
+}
+
+const TextureCacheHeader &CachedTexture::getHeader() const {
+    return *reinterpret_cast<const TextureCacheHeader *>(data.data());
+}
+
+std::unique_ptr<CachedTexture> CachedTexture::compress(ThreadPool &threadPool, const CachedTexture &texture,
+                                                       const BlockQuality quality) {
+    const TextureCacheHeader &source = texture.getHeader();
+    TextureCacheHeader header = source;
+    header.quality = quality;
+
+    if (source.kind == TextureKind::COLOR) {
+        // BC1 is half the size of BC3, but can't do anything but opaque texels
+        const TextureLevel base = texture.getLevel(0);
+        bool isOpaque = true;
+        for (std::size_t i = 3; i < base.pixels.size(); i += TEXEL_SIZE) {
+            isOpaque &= base.pixels[i] == std::byte{255};
+        }
+
+        header.format = isOpaque ? TextureFormat::BC1 : TextureFormat::BC3;
+    } else {
+        header.format = source.kind == TextureKind::NORMAL ? TextureFormat::BC5 : TextureFormat::BC4;
+    }
+
+    std::uint64_t offset = alignUp(sizeof(TextureCacheHeader), 16);
+    for (std::size_t level = 0; level < header.levelCount; level++) {
+        TextureCacheLevel &placement = header.levels[level];
+        placement.offset = offset;
+        placement.size = getLevelSize(header.format, static_cast<int>(placement.width),
+                                      static_cast<int>(placement.height));
+        offset = alignUp(offset + placement.size, 16);
+    }
+
+    std::unique_ptr<CachedTexture> compressed(new CachedTexture());
+    compressed->cookedData.resize(offset);
+    compressed->data = compressed->cookedData;
+
+    std::byte *base = compressed->cookedData.data();
+
+    for (std::size_t level = 0; level < header.levelCount; level++) {
+        const TextureLevel texels = texture.getLevel(level);
+        compressLevel(threadPool, reinterpret_cast<const std::uint8_t *>(texels.pixels.data()), texels.width,
+                      texels.height, header.format, quality,
+                      reinterpret_cast<std::uint8_t *>(base + header.levels[level].offset));
+    }
+
+    const TextureLevel baseTexels = texture.getLevel(0);
+    header.basePsnr = measurePsnr(threadPool, reinterpret_cast<const std::uint8_t *>(baseTexels.pixels.data()),
+                                  baseTexels.width, baseTexels.height, header.format,
+                                  reinterpret_cast<const std::uint8_t *>(base + header.levels[0].offset));
+
+    std::memcpy(base, &header, sizeof(header));
+
+    return compressed;
+}
+
+bool CachedTexture::isValid(const std::uint64_t sourceHash, const TextureKind kind,
+                            const std::optional<BlockQuality> compression) const {
+    if (data.size() < sizeof(TextureCacheHeader)) {
+        return false;
+    }
+
+    const TextureCacheHeader &header = getHeader();
+
+    if (header.magic != TextureCacheHeader::MAGIC
+        || header.version != TextureCacheHeader::VERSION
+        || header.sourceHash != sourceHash
+        || header.kind != kind
+        || (header.format == TextureFormat::RGBA8) != !compression
+        || (compression && header.quality != *compression)
+        || header.levelCount == 0
+        || header.levelCount > TextureCacheHeader::MAX_LEVEL_COUNT) {
+        return false;
+    }
+
+    // make sure a truncated file doesn't send us reading past the end of the mapping
+    return std::all_of(header.levels, header.levels + header.levelCount, [&](const TextureCacheLevel &level) {
+        return level.width > 0 && level.height > 0
+               && level.size == getLevelSize(header.format, static_cast<int>(level.width),
+                                             static_cast<int>(level.height))
+               && level.offset + level.size <= data.size();
+    });
+}
@@ -0,0 +1,137 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "utilities/mapped-file.hpp"
+#include "utilities/thread-pool.hpp"
+#include "block-compression.hpp"
+#include "texture-loader.hpp"
+
+/**
+ * What the texels of a texture mean, which decides how they're filtered into smaller mip levels.
+ */
+enum class TextureKind : std::uint32_t {
+    // sRGB-encoded colors with linear alpha -- filtered in linear space, so mips don't darken
+    COLOR = 0,
+    // tangent-space normals mapped from [-1, 1] to [0, 255] -- filtered as vectors and renormalized
+    NORMAL = 1,
+    // linear data in the red channel alone, e.g. roughness or occlusion
+    SINGLE_CHANNEL = 2,
+};
+
+/**
+ * Placement of a single mip level within a cooked texture file.
+ */
+struct TextureCacheLevel {
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint64_t offset; // in bytes, from the start of the file
+    std::uint64_t size;   // in bytes
+};
+
+/**
+ * Header of a cooked texture file. The header is followed by every mip level of the texture, starting with the
+ * full-size one, each stored as tightly packed rows of texels or blocks in the texture's format, bottom row first --
+ * exactly as `glTexSubImage2D` and `glCompressedTexSubImage2D` take them, so a mapped file can be uploaded as-is.
+ */
+struct TextureCacheHeader {
+    static constexpr std::uint32_t MAGIC = 0x52545854; // "TXTR" in little-endian
+    // bump this whenever either the format or the cooking pipeline changes, so old caches get recooked
+    static constexpr std::uint32_t VERSION = 2;
+    static constexpr std::size_t MAX_LEVEL_COUNT = 16;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t sourceHash; // hash of the source file's contents, used to detect stale caches
+    TextureKind kind;
+    TextureFormat format;
+    BlockQuality quality; // only meaningful for block-compressed formats
+    std::uint32_t levelCount;
+    double basePsnr; // of the full-size level against the image it was cooked from, infinite if it's uncompressed
+    TextureCacheLevel levels[MAX_LEVEL_COUNT];
+};
+
+/**
+ * A mip level of a cooked texture.
+ */
+struct TextureLevel {
+    int width;
+    int height;
+    std::span<const std::byte> pixels;
+};
+
+/**
+ * A texture with its full mip chain, either memory-mapped from a file written by `CachedTexture::write`, or freshly
+ * cooked by `CachedTexture::cook`.
+ */
+class CachedTexture {
+    // contents of the cache file -- either the mapped file itself, or the buffer it was cooked into
+    std::optional<MappedFile> file;
+    std::vector<std::byte> cookedData;
+    std::span<const std::byte> data;
+
+    CachedTexture() = default;
+
+public:
+    /**
+     * Maps the cache file at the given path, if it exists and was cooked from a source file with the given hash
+     * as the given kind of texture, with the given compression. Returns nullptr if the cache is missing, stale or
+     * was written by an incompatible version.
+     */
+    static std::unique_ptr<CachedTexture> open(const std::filesystem::path &path, std::uint64_t sourceHash,
+                                               TextureKind kind, std::optional<BlockQuality> compression);
+
+    /**
+     * Builds the full mip chain of a decoded RGBA8 image, down to a single texel. Every level is filtered from the
+     * one above it with a 2x2 box filter -- in linear space for colors, and as renormalized vectors for normals.
+     * Rows of every level are spread over the thread pool.
+     *
+     * With compression, every level is then block-compressed in the format fitting the kind of texture -- BC1 for
+     * opaque colors and BC3 for ones with alpha, BC5 for normals and BC4 for single channels. Otherwise the texture
+     * is left as RGBA8.
+     */
+    static std::unique_ptr<CachedTexture> cook(ThreadPool &threadPool, const DecodedTexture &image,
+                                               std::uint64_t sourceHash, TextureKind kind,
+                                               std::optional<BlockQuality> compression);
+
+    /**
+     * Writes the texture to a cache file. The file is written to a temporary path first and then renamed, so
+     * a crash mid-write never leaves a corrupted cache behind.
+     */
+    void write(const std::filesystem::path &path) const;
+
+    [[nodiscard]] int getWidth() const { return getLevel(0).width; }
+
+    [[nodiscard]] int getHeight() const { return getLevel(0).height; }
+
+    [[nodiscard]] TextureFormat getFormat() const { return getHeader().format; }
+
+    [[nodiscard]] std::size_t getLevelCount() const { return getHeader().levelCount; }
+
+    [[nodiscard]] TextureLevel getLevel(std::size_t level) const;
+
+    [[nodiscard]] std::size_t getSizeBytes() const { return data.size(); }
+
+    [[nodiscard]] double getPsnr() const { return getHeader().basePsnr; }
+
+    /**
+     * Whether the texture was mapped from a cache file, rather than cooked in this run.
+     */
+    [[nodiscard]] bool isMapped() const { return file.has_value(); }
+
+private:
+    const TextureCacheHeader &getHeader() const;
+
+    bool isValid(std::uint64_t sourceHash, TextureKind kind, std::optional<BlockQuality> compression) const;
+
+    static std::unique_ptr<CachedTexture> compress(ThreadPool &threadPool, const CachedTexture &texture,
+                                                   BlockQuality quality);
+};
+
+#endif //TEXTURE_CACHE_HPP
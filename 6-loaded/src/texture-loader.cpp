@@ -0,0 +1,52 @@
+#include "texture-loader.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+#include <stb_image.h>
+
+std::future<DecodedTexture> TextureLoader::load(const std::filesystem::path &path, const int channelCount,
+                                                const bool isFlipped) const {
+    return threadPool.submit([path, channelCount, isFlipped] { return decode(path, channelCount, isFlipped); });
+}
+
+std::vector<DecodedTexture> TextureLoader::loadAll(const std::span<const std::filesystem::path> paths,
+                                                   const int channelCount, const bool isFlipped) const {
+    std::vector<DecodedTexture> textures(paths.size());
+
+    // every image is a separate chunk, as they can take wildly different amounts of time to decode
+    threadPool.parallelFor(paths.size(), 1, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            textures[i] = decode(paths[i], channelCount, isFlipped);
+        }
+    });
+
+    return textures;
+}
+
+DecodedTexture TextureLoader::decode(const std::filesystem::path &path, const int channelCount,
+                                     const bool isFlipped) {
+    DecodedTexture texture;
+    int fileChannelCount;
+    unsigned char *pixels = stbi_load(path.string().c_str(), &texture.width, &texture.height, &fileChannelCount,
+                                      channelCount);
+    if (!pixels) {
+        throw std::runtime_error("failed to load texture: " + path.string());
+    }
+
+    texture.pixels = {pixels, stbi_image_free};
+    texture.channelCount = channelCount ? channelCount : fileChannelCount;
+
+    if (isFlipped) {
+        const std::size_t rowSize = static_cast<std::size_t>(texture.width) * texture.channelCount;
+
+        for (int row = 0; row < texture.height / 2; row++) {
+            unsigned char *top = pixels + row * rowSize;
+            unsigned char *bottom = pixels + (texture.height - 1 - row) * rowSize;
+            std::swap_ranges(top, top + rowSize, bottom);
+        }
+    }
+
+    return texture;
+}
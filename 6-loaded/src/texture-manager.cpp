@@ -0,0 +1,318 @@
+#include "texture-manager.hpp"
+
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "utilities/gl-state.hpp"
+
+GLenum getTextureInternalFormat(const TextureFormat format) {
+    switch (format) {
+        case TextureFormat::RGBA8: return GL_RGBA8;
+        case TextureFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case TextureFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case TextureFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+        case TextureFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    }
+
+    throw std::runtime_error("unknown texture format");
+}
+
+TextureManager::TextureManager(const std::size_t budgetBytes) : budgetBytes(budgetBytes) {
+    // texture storage is core only since GL 4.2, while we only ask for a 3.3 context
+    isTextureStorageSupported = GLEW_VERSION_4_2 || GLEW_ARB_texture_storage;
+}
+
+TextureManager::~TextureManager() {
+    for (const ManagedArray &array : arrays) {
+        if (array.id) {
+            getGLState().deleteTexture(array.id);
+        }
+    }
+}
+
+std::size_t TextureManager::add(TextureSource source, std::unique_ptr<CachedTexture> texture) {
+    textures.push_back({
+        .source = std::move(source),
+        .texture = std::move(texture),
+    });
+
+    return textures.size() - 1;
+}
+
+void TextureManager::allocate() {
+    if (!arrays.empty()) {
+        throw std::runtime_error("textures were already allocated");
+    }
+
+    GLint maxLayerCount = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayerCount);
+
+    // textures can only share an array if all of their levels have the same format and size
+    using ArrayKey = std::tuple<TextureFormat, GLsizei, GLsizei, std::size_t>;
+    std::map<ArrayKey, std::size_t> openArrays;
+
+    for (std::size_t i = 0; i < textures.size(); i++) {
+        ManagedTexture &managed = textures[i];
+        const CachedTexture &texture = *managed.texture;
+        const TextureLevel top = texture.getLevel(0);
+        const ArrayKey key{texture.getFormat(), top.width, top.height, texture.getLevelCount()};
+
+        auto it = openArrays.find(key);
+        if (it == openArrays.end() || arrays[it->second].layers.size() >= static_cast<std::size_t>(maxLayerCount)) {
+            arrays.emplace_back();
+            it = openArrays.insert_or_assign(key, arrays.size() - 1).first;
+        }
+
+        ManagedArray &array = arrays[it->second];
+        managed.array = it->second;
+        managed.layer = static_cast<GLint>(array.layers.size());
+        array.layers.push_back(i);
+        array.isPinned |= managed.source.cachePath.empty();
+    }
+
+    std::size_t totalBytes = 0;
+    for (const ManagedArray &array : arrays) {
+        totalBytes += getLevelsBytes(array, array.baseLevel);
+    }
+
+    // the top level is three quarters of a mip chain, so dropping it from the largest arrays saves the most
+    while (totalBytes > budgetBytes) {
+        ManagedArray *largest = findLargestTrimmableArray(false);
+        if (!largest) {
+            break; // every array is down to its last level, so the budget can't be met
+        }
+
+        totalBytes -= getLevelsBytes(*largest, largest->baseLevel) - getLevelsBytes(*largest, largest->baseLevel + 1);
+        largest->baseLevel++;
+        stats.trimmedLevelCount++;
+    }
+
+    for (ManagedArray &array : arrays) {
+        createArray(array, array.baseLevel, false);
+    }
+}
+
+TextureLayer TextureManager::getLayer(const std::size_t index) const {
+    const ManagedTexture &managed = textures[index];
+    return {arrays[managed.array].id, managed.layer};
+}
+
+std::size_t TextureManager::getBaseLevel(const std::size_t index) const {
+    return arrays[textures[index].array].baseLevel;
+}
+
+std::size_t TextureManager::getResidentArrayCount() const {
+    std::size_t count = 0;
+    for (const ManagedArray &array : arrays) {
+        count += array.id != 0;
+    }
+
+    return count;
+}
+
+TextureLayer TextureManager::use(const std::size_t index) {
+    const ManagedTexture &managed = textures[index];
+    ManagedArray &array = arrays[managed.array];
+    array.lastUsedFrame = frame;
+
+    if (!array.id) {
+        // it's needed for this very draw, so there's no way around reloading it right away. it comes back with the
+        // levels it had before, and gets the rest back over the next frames
+        stats.missCount++;
+        reload(array, array.baseLevel);
+    } else if (array.baseLevel > 0) {
+        stats.missCount++;
+    } else {
+        stats.hitCount++;
+    }
+
+    return {array.id, managed.layer};
+}
+
+void TextureManager::endFrame() {
+    // a level at a time, so an array coming back into view doesn't reupload its whole chain over and over
+    for (ManagedArray &array : arrays) {
+        if (!array.id || array.lastUsedFrame != frame || array.baseLevel == 0) {
+            continue;
+        }
+
+        const std::size_t levelBytes = getLevelsBytes(array, array.baseLevel - 1) - array.residentBytes;
+        if (makeRoom(levelBytes)) {
+            reload(array, array.baseLevel - 1);
+        }
+    }
+
+    while (residentBytes > budgetBytes) {
+        if (makeRoom(0)) {
+            break;
+        }
+
+        // everything left was used this frame, so the largest top level goes
+        ManagedArray *largest = findLargestTrimmableArray(true);
+        if (!largest) {
+            break;
+        }
+
+        createArray(*largest, largest->baseLevel + 1, true);
+        stats.trimmedLevelCount++;
+    }
+
+    frame++;
+}
+
+TextureManagerStats TextureManager::takeStats() {
+    return std::exchange(stats, {});
+}
+
+void TextureManager::createArray(ManagedArray &array, const std::size_t baseLevel, const bool isFilled) {
+    if (array.id) {
+        getGLState().deleteTexture(array.id);
+        residentBytes -= array.residentBytes;
+    }
+
+    const CachedTexture &first = getFirstLayer(array);
+    const TextureFormat format = first.getFormat();
+    const GLenum internalFormat = getTextureInternalFormat(format);
+    const auto levelCount = static_cast<GLsizei>(first.getLevelCount() - baseLevel);
+    const auto layerCount = static_cast<GLsizei>(array.layers.size());
+    const TextureLevel base = first.getLevel(baseLevel);
+
+    glGenTextures(1, &array.id);
+    getGLState().bindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    // immutable storage allocates the whole mip chain of every layer at once, and spares the driver from having to
+    // check whether the levels specified one by one add up to a complete texture
+    if (isTextureStorageSupported) {
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, levelCount, internalFormat, base.width, base.height, layerCount);
+    }
+
+    for (GLsizei level = 0; level < levelCount; level++) {
+        const TextureLevel cooked = first.getLevel(baseLevel + level);
+        const auto layerBytes = static_cast<GLsizei>(cooked.pixels.size());
+
+        // without storage, every level has to be specified even when it's left empty, and the only way to do that is
+        // for all the layers at once
+        if (!isTextureStorageSupported && format == TextureFormat::RGBA8) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, static_cast<GLint>(internalFormat), cooked.width, cooked.height,
+                         layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        } else if (!isTextureStorageSupported) {
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, cooked.width, cooked.height,
+                                   layerCount, 0, layerBytes * layerCount, nullptr);
+        }
+
+        for (GLint layer = 0; isFilled && layer < layerCount; layer++) {
+            const CachedTexture &texture = *textures[array.layers[layer]].texture;
+            const void *pixels = texture.getLevel(baseLevel + level).pixels.data();
+
+            if (format == TextureFormat::RGBA8) {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, cooked.width, cooked.height, 1, GL_RGBA,
+                                GL_UNSIGNED_BYTE, pixels);
+            } else {
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, cooked.width, cooked.height, 1,
+                                          internalFormat, layerBytes, pixels);
+            }
+        }
+    }
+
+    array.baseLevel = baseLevel;
+    array.residentBytes = getLevelsBytes(array, baseLevel);
+    residentBytes += array.residentBytes;
+}
+
+void TextureManager::evict(ManagedArray &array) {
+    getGLState().deleteTexture(array.id);
+    residentBytes -= array.residentBytes;
+
+    array.id = 0;
+    array.residentBytes = 0;
+    stats.evictionCount++;
+
+    // unmaps the caches, which is all that's left of the layers in memory
+    for (const std::size_t index : array.layers) {
+        textures[index].texture.reset();
+    }
+}
+
+void TextureManager::reload(ManagedArray &array, const std::size_t baseLevel) {
+    for (const std::size_t index : array.layers) {
+        ManagedTexture &managed = textures[index];
+        if (managed.texture) {
+            continue;
+        }
+
+        const TextureSource &source = managed.source;
+        managed.texture = CachedTexture::open(source.cachePath, source.sourceHash, source.kind, source.compression);
+
+        if (!managed.texture) {
+            throw std::runtime_error("texture cache went missing or stale: " + source.cachePath.string());
+        }
+    }
+
+    createArray(array, baseLevel, true);
+    stats.reloadCount++;
+    stats.reloadedBytes += array.residentBytes;
+}
+
+bool TextureManager::makeRoom(const std::size_t bytes) {
+    while (residentBytes + bytes > budgetBytes) {
+        ManagedArray *leastRecentlyUsed = nullptr;
+
+        for (ManagedArray &array : arrays) {
+            if (!array.id || array.isPinned || array.lastUsedFrame == frame) {
+                continue;
+            }
+
+            if (!leastRecentlyUsed || array.lastUsedFrame < leastRecentlyUsed->lastUsedFrame) {
+                leastRecentlyUsed = &array;
+            }
+        }
+
+        if (!leastRecentlyUsed) {
+            return false;
+        }
+
+        evict(*leastRecentlyUsed);
+    }
+
+    return true;
+}
+
+TextureManager::ManagedArray *TextureManager::findLargestTrimmableArray(const bool isResidentOnly) {
+    ManagedArray *largest = nullptr;
+    std::size_t largestBytes = 0;
+
+    for (ManagedArray &array : arrays) {
+        if ((isResidentOnly && !array.id) || array.isPinned
+            || array.baseLevel + 1 == getFirstLayer(array).getLevelCount()) {
+            continue;
+        }
+
+        const std::size_t bytes = getFirstLayer(array).getLevel(array.baseLevel).pixels.size() * array.layers.size();
+        if (bytes > largestBytes) {
+            largest = &array;
+            largestBytes = bytes;
+        }
+    }
+
+    return largest;
+}
+
+std::size_t TextureManager::getLevelsBytes(const ManagedArray &array, const std::size_t baseLevel) const {
+    // every layer has the same format and size, so they all take as much as the first one
+    const CachedTexture &first = getFirstLayer(array);
+
+    std::size_t bytes = 0;
+    for (std::size_t level = baseLevel; level < first.getLevelCount(); level++) {
+        bytes += first.getLevel(level).pixels.size();
+    }
+
+    return bytes * array.layers.size();
+}
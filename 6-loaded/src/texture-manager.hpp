@@ -0,0 +1,190 @@
+#ifndef TEXTURE_MANAGER_HPP
+#define TEXTURE_MANAGER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "block-compression.hpp"
+#include "texture-cache.hpp"
+
+/**
+ * Where a managed texture is reloaded from once it's been evicted -- the arguments `CachedTexture::open` needs.
+ */
+struct TextureSource {
+    std::filesystem::path cachePath; // empty for textures which only exist in memory, which are never evicted
+    std::uint64_t sourceHash;
+    TextureKind kind;
+    std::optional<BlockQuality> compression;
+};
+
+/**
+ * Where a managed texture lives on the GPU -- a layer of a `GL_TEXTURE_2D_ARRAY`.
+ */
+struct TextureLayer {
+    GLuint array;
+    GLint layer;
+};
+
+/**
+ * What the texture manager has been doing since the counters were last taken.
+ */
+struct TextureManagerStats {
+    std::size_t hitCount = 0;          // textures used with their whole mip chain resident
+    std::size_t missCount = 0;         // textures used while evicted, or with some of their top levels missing
+    std::size_t evictionCount = 0;     // whole arrays evicted
+    std::size_t trimmedLevelCount = 0; // top levels dropped from arrays which stayed resident
+    std::size_t reloadCount = 0;       // arrays reloaded from their caches, whole or with more levels than before
+    std::size_t reloadedBytes = 0;
+};
+
+/**
+ * Returns the GL internal format textures of the given format are stored in.
+ */
+GLenum getTextureInternalFormat(TextureFormat format);
+
+/**
+ * Owns the GL textures of the loaded assets and keeps the memory they take under a budget.
+ *
+ * Textures of the same format, size and mip count are packed into the layers of a single `GL_TEXTURE_2D_ARRAY`, so
+ * that drawing with a different one of them only takes a different layer index rather than a different binding.
+ * Everything is stored in arrays, even textures which don't share theirs with any other, so shaders only ever sample
+ * one kind of sampler.
+ *
+ * Arrays are also what residency is managed by. Each one keeps a suffix of its layers' cooked mip chains resident --
+ * all of it, unless it had to give up some of its top levels, or none of it if it's been evicted. Once a frame,
+ * arrays which weren't used in it are evicted whole, least recently used first, until everything fits. If the arrays
+ * in use don't fit on their own, the top levels of the largest ones are dropped instead. Arrays used while missing
+ * levels are reloaded from their layers' cooked caches -- whole ones right when they're used, and trimmed ones a level
+ * per frame, as long as the budget allows it.
+ *
+ * Resident levels are always stored as a complete texture of their own, so dropping a level really frees its memory,
+ * rather than just hiding it behind `GL_TEXTURE_BASE_LEVEL`.
+ */
+class TextureManager {
+    struct ManagedTexture {
+        TextureSource source;
+        std::unique_ptr<CachedTexture> texture; // null while its array is evicted
+        std::size_t array = 0;
+        GLint layer = 0;
+    };
+
+    struct ManagedArray {
+        std::vector<std::size_t> layers; // indices of the textures in every layer
+        GLuint id = 0;                   // 0 while evicted
+        std::size_t baseLevel = 0;       // finest level of the cooked mip chains which is resident
+        std::size_t residentBytes = 0;
+        std::uint64_t lastUsedFrame = 0;
+        bool isPinned = false;           // holds a texture which can't be reloaded
+    };
+
+    std::vector<ManagedTexture> textures;
+    std::vector<ManagedArray> arrays;
+    std::size_t budgetBytes;
+    std::size_t residentBytes = 0;
+    std::uint64_t frame = 1;
+    bool isTextureStorageSupported;
+    TextureManagerStats stats;
+
+public:
+    explicit TextureManager(std::size_t budgetBytes);
+
+    ~TextureManager();
+
+    TextureManager(const TextureManager &other) = delete;
+
+    TextureManager &operator=(const TextureManager &other) = delete;
+
+    /**
+     * Starts managing a cooked texture, without creating anything on the GPU yet. Returns its index.
+     */
+    std::size_t add(TextureSource source, std::unique_ptr<CachedTexture> texture);
+
+    /**
+     * Packs everything added so far into arrays and creates them, without filling them. Starts by dropping top levels
+     * of the largest arrays until all of them fit in the budget, so the levels to fill are the ones from
+     * `getBaseLevel` on.
+     */
+    void allocate();
+
+    [[nodiscard]] std::size_t getTextureCount() const { return textures.size(); }
+
+    [[nodiscard]] std::size_t getArrayCount() const { return arrays.size(); }
+
+    /**
+     * Returns where the texture at the given index lives, without counting it as used. Its array has to be resident.
+     */
+    [[nodiscard]] TextureLayer getLayer(std::size_t index) const;
+
+    [[nodiscard]] const CachedTexture &getCachedTexture(std::size_t index) const { return *textures[index].texture; }
+
+    [[nodiscard]] std::size_t getBaseLevel(std::size_t index) const;
+
+    [[nodiscard]] std::size_t getBudgetBytes() const { return budgetBytes; }
+
+    [[nodiscard]] std::size_t getResidentBytes() const { return residentBytes; }
+
+    [[nodiscard]] std::size_t getResidentArrayCount() const;
+
+    void setBudgetBytes(std::size_t bytes) { budgetBytes = bytes; }
+
+    /**
+     * Returns where the texture at the given index lives to draw with it, marking its array as used in the current
+     * frame. If the array's been evicted, it's reloaded from its caches first, which binds it to the active unit.
+     */
+    TextureLayer use(std::size_t index);
+
+    /**
+     * Brings back a level of arrays used this frame which are missing some, and then evicts or trims arrays until
+     * everything fits in the budget again. Should be called once every frame, after drawing.
+     */
+    void endFrame();
+
+    /**
+     * Returns the counters gathered since the previous call, and resets them.
+     */
+    TextureManagerStats takeStats();
+
+private:
+    /**
+     * (Re)creates the GL texture of an array, holding the levels of its layers' mip chains from the given one on,
+     * and fills them from the cooked textures unless told not to.
+     */
+    void createArray(ManagedArray &array, std::size_t baseLevel, bool isFilled);
+
+    void evict(ManagedArray &array);
+
+    /**
+     * Reloads an array's textures from their cooked caches, in case it's been evicted, and recreates it with levels
+     * from the given one on.
+     */
+    void reload(ManagedArray &array, std::size_t baseLevel);
+
+    /**
+     * Makes room for the given number of bytes by evicting arrays not used in this frame, least recently used
+     * first. Returns whether there's enough room now.
+     */
+    bool makeRoom(std::size_t bytes);
+
+    /**
+     * Returns the resident array whose top level takes the most memory among ones which have more than one level
+     * left and can be trimmed, or nullptr if there's none. Only resident arrays are considered if asked to.
+     */
+    ManagedArray *findLargestTrimmableArray(bool isResidentOnly);
+
+    /**
+     * Bytes taken by the levels of all the array's layers from the given one on.
+     */
+    [[nodiscard]] std::size_t getLevelsBytes(const ManagedArray &array, std::size_t baseLevel) const;
+
+    [[nodiscard]] const CachedTexture &getFirstLayer(const ManagedArray &array) const {
+        return *textures[array.layers.front()].texture;
+    }
+};
+
+#endif //TEXTURE_MANAGER_HPP
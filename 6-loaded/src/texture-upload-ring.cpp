@@ -0,0 +1,184 @@
+#include "texture-upload-ring.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "utilities/gl-state.hpp"
+
+TextureUploadRing::TextureUploadRing(ThreadPool &threadPool, const std::size_t segmentCount,
+                                     const std::size_t segmentBytes)
+    : threadPool(threadPool), segmentBytes(segmentBytes), segments(segmentCount) {
+    isPersistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+    for (Segment &segment : segments) {
+        glGenBuffers(1, &segment.buffer);
+        getGLState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, segment.buffer);
+
+        if (!isPersistent) {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(segmentBytes), nullptr, GL_STREAM_DRAW);
+            continue;
+        }
+
+        // coherent, so nothing has to be flushed after the workers are done writing
+        constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(segmentBytes), nullptr, flags);
+        segment.mapping = static_cast<std::byte *>(
+            glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(segmentBytes), flags));
+
+        if (!segment.mapping) {
+            throw std::runtime_error("failed to map texture upload buffer");
+        }
+    }
+
+    // a bound unpack buffer turns the pointer of every other texture upload into an offset
+    getGLState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureUploadRing::~TextureUploadRing() {
+    for (Segment &segment : segments) {
+        // the workers may still be writing into the mapping
+        if (segment.copy.valid()) {
+            segment.copy.wait();
+        }
+
+        if (segment.mapping) {
+            getGLState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, segment.buffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+
+        if (segment.fence) {
+            glDeleteSync(segment.fence);
+        }
+
+        getGLState().deleteBuffer(segment.buffer);
+    }
+
+    getGLState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+bool TextureUploadRing::canSubmit() {
+    Segment &segment = segments[nextSegment];
+
+    if (segment.fence) {
+        const GLenum status = glClientWaitSync(segment.fence, 0, 0);
+
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+            glDeleteSync(segment.fence);
+            segment.fence = nullptr;
+        }
+    }
+
+    if (segment.copy.valid() || segment.fence) {
+        stats.fullRingCount++;
+        return false;
+    }
+
+    return true;
+}
+
+void TextureUploadRing::submit(std::vector<TextureUpload> uploads) {
+    Segment &segment = segments[nextSegment];
+    nextSegment = (nextSegment + 1) % segments.size();
+
+    if (segment.copy.valid() || segment.fence) {
+        throw std::runtime_error("texture upload segment is still in use");
+    }
+
+    segment.byteCount = 0;
+    for (const TextureUpload &upload : uploads) {
+        segment.byteCount += upload.pixels.size();
+    }
+
+    if (segment.byteCount > segmentBytes) {
+        throw std::runtime_error("texture uploads don't fit in an upload segment");
+    }
+
+    if (!isPersistent) {
+        // the fence has passed, so there's nothing for the driver to synchronize with
+        getGLState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, segment.buffer);
+        segment.mapping = static_cast<std::byte *>(glMapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(segmentBytes),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        getGLState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (!segment.mapping) {
+            throw std::runtime_error("failed to map texture upload buffer");
+        }
+    }
+
+    segment.uploads = std::move(uploads);
+    stats.submittedBytes += segment.byteCount;
+
+    // uploads are packed tightly. every row is a multiple of 4 bytes long, so the default unpack alignment holds
+    segment.copy = threadPool.submit([mapping = segment.mapping, &uploads = segment.uploads] {
+        std::size_t offset = 0;
+        for (const TextureUpload &upload : uploads) {
+            std::memcpy(mapping + offset, upload.pixels.data(), upload.pixels.size());
+            offset += upload.pixels.size();
+        }
+    });
+}
+
+void TextureUploadRing::tick() {
+    // segments are filled in order, and issued in the same order
+    for (std::size_t i = 0; i < segments.size(); i++) {
+        Segment &segment = segments[(nextSegment + i) % segments.size()];
+
+        if (!segment.copy.valid()) {
+            continue;
+        }
+
+        if (segment.copy.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            break;
+        }
+
+        segment.copy.get(); // rethrows whatever went wrong while copying
+        getGLState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, segment.buffer);
+
+        if (!isPersistent) {
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            segment.mapping = nullptr;
+        }
+
+        std::size_t offset = 0;
+        for (const TextureUpload &upload : segment.uploads) {
+            // with an unpack buffer bound, the pointer is an offset into it
+            const auto *pixels = reinterpret_cast<const void *>(offset);
+            getGLState().bindTexture(GL_TEXTURE_2D_ARRAY, upload.texture);
+
+            if (upload.compressedFormat) {
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, upload.level, 0, upload.y, upload.layer, upload.width,
+                                          upload.height, 1, upload.compressedFormat,
+                                          static_cast<GLsizei>(upload.pixels.size()), pixels);
+            } else {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, upload.level, 0, upload.y, upload.layer, upload.width,
+                                upload.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            }
+
+            offset += upload.pixels.size();
+        }
+
+        getGLState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        segment.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        segment.uploads.clear();
+        stats.issuedBytes += segment.byteCount;
+    }
+}
+
+bool TextureUploadRing::isIdle() const {
+    return std::ranges::none_of(segments, [](const Segment &segment) { return segment.copy.valid(); });
+}
+
+std::size_t TextureUploadRing::getBusySegmentCount() const {
+    return std::ranges::count_if(segments, [](const Segment &segment) {
+        return segment.copy.valid() || segment.fence;
+    });
+}
+
+TextureUploadStats TextureUploadRing::takeStats() {
+    return std::exchange(stats, {});
+}
@@ -0,0 +1,114 @@
+#ifndef TEXTURE_UPLOAD_RING_HPP
+#define TEXTURE_UPLOAD_RING_HPP
+
+#include <cstddef>
+#include <future>
+#include <span>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "utilities/thread-pool.hpp"
+
+/**
+ * A slice of a level of an array texture's layer to be uploaded -- whole rows of texels, or whole rows of blocks for
+ * compressed formats.
+ */
+struct TextureUpload {
+    GLuint texture; // a `GL_TEXTURE_2D_ARRAY`
+    GLint layer;
+    GLint level;
+    int y;
+    int width;
+    int height; // in texels, so the last row of blocks of a compressed level may stick out past it
+    GLenum compressedFormat; // 0 for RGBA8 texels
+    std::span<const std::byte> pixels; // has to stay alive until the upload is issued
+};
+
+/**
+ * What the ring has been doing since the counters were last taken.
+ */
+struct TextureUploadStats {
+    std::size_t submittedBytes = 0; // handed to the workers to copy into the ring
+    std::size_t issuedBytes = 0;    // uploaded from the ring into textures
+    std::size_t fullRingCount = 0;  // times a submission had to wait, as every segment was still in use
+};
+
+/**
+ * Streams texture data to the GPU through a ring of pixel buffer objects, so the render thread never has to copy
+ * texels itself or wait for a transfer to finish.
+ *
+ * Each batch of uploads takes a segment of the ring, which is filled by one of the workers. Once the copy is done,
+ * the render thread issues the uploads from offsets into the segment's buffer and fences them. The segment comes back
+ * into use only after the GPU is past the fence, which is checked without ever blocking.
+ *
+ * Segments are mapped persistently when buffer storage is available (GL 4.4 or ARB_buffer_storage). Otherwise each
+ * one is mapped for as long as the workers are filling it, and unmapped before its uploads are issued.
+ */
+class TextureUploadRing {
+    struct Segment {
+        GLuint buffer = 0;
+        std::byte *mapping = nullptr; // only set while the segment is mapped
+        GLsync fence = nullptr;       // set while the GPU may still be reading from the segment
+        std::future<void> copy;       // valid while a worker is filling the segment
+        std::vector<TextureUpload> uploads;
+        std::size_t byteCount = 0;
+    };
+
+    ThreadPool &threadPool;
+    std::size_t segmentBytes;
+    bool isPersistent;
+    std::vector<Segment> segments;
+    std::size_t nextSegment = 0; // segments are taken in order, so this one is always the least recently used
+    TextureUploadStats stats;
+
+public:
+    TextureUploadRing(ThreadPool &threadPool, std::size_t segmentCount, std::size_t segmentBytes);
+
+    ~TextureUploadRing();
+
+    TextureUploadRing(const TextureUploadRing &other) = delete;
+
+    TextureUploadRing &operator=(const TextureUploadRing &other) = delete;
+
+    [[nodiscard]] std::size_t getSegmentBytes() const { return segmentBytes; }
+
+    [[nodiscard]] std::size_t getSegmentCount() const { return segments.size(); }
+
+    [[nodiscard]] bool isMappedPersistently() const { return isPersistent; }
+
+    /**
+     * Returns whether the next segment is free to take a batch of uploads. Doesn't wait for the GPU -- if it's still
+     * reading from the segment, this returns false and counts the ring as full.
+     */
+    bool canSubmit();
+
+    /**
+     * Starts copying a batch of uploads into the next segment on one of the workers. `canSubmit` has to have
+     * returned true, and the uploads can't take more than `getSegmentBytes` in total.
+     */
+    void submit(std::vector<TextureUpload> uploads);
+
+    /**
+     * Issues the uploads of every segment which the workers are done filling. Should be called every frame.
+     */
+    void tick();
+
+    /**
+     * Returns whether every submitted upload has been issued. Textures can be sampled from then, as the GPU
+     * executes the uploads before any draw issued after them.
+     */
+    [[nodiscard]] bool isIdle() const;
+
+    /**
+     * Returns the number of segments being filled or read by the GPU.
+     */
+    [[nodiscard]] std::size_t getBusySegmentCount() const;
+
+    /**
+     * Returns the counters gathered since the previous call, and resets them.
+     */
+    TextureUploadStats takeStats();
+};
+
+#endif //TEXTURE_UPLOAD_RING_HPP
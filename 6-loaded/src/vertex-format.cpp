@@ -0,0 +1,160 @@
+#include "vertex-format.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+static std::uint16_t packUnorm16(const float value) {
+    return static_cast<std::uint16_t>(std::round(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+// unit vectors as snorm10 components, leaving the 2-bit w unused. tangents are packed the same way, just with the
+// sign of their bitangent in w. GL before 4.2 decodes a -1 there as -1/3 rather than -1, so the shaders only look
+// at w's sign
+static std::uint32_t packDirection(const glm::vec3 &direction) {
+    return glm::packSnorm3x10_1x2(glm::vec4(direction, 0.0f));
+}
+
+const char *getVertexFormatName(const VertexFormat format) {
+    switch (format) {
+        case VertexFormat::FLOAT:
+            return "float";
+        case VertexFormat::HALF_UV:
+            return "half-float uv";
+        case VertexFormat::QUANTIZED:
+            return "quantized";
+    }
+
+    return "unknown";
+}
+
+struct HalfUvVertex {
+    glm::vec3 position;
+    std::uint32_t uv;
+    std::uint32_t normal;
+    std::uint32_t tangent;
+};
+
+// attributes are kept 4-byte aligned, which some hardware needs to avoid slow fetch paths
+struct QuantizedVertex {
+    std::uint16_t position[3];
+    std::uint16_t padding;
+    std::uint16_t uv[2];
+    std::uint32_t normal;
+    std::uint32_t tangent;
+};
+
+VertexEncoder::VertexEncoder(const std::span<const Vertex> vertices, const VertexFormat format)
+    : format(format), positionDecodeMatrix(glm::identity<glm::mat4>()) {
+    if (format == VertexFormat::FLOAT) {
+        layout = {
+            sizeof(Vertex), {
+                {0, 3, GL_FLOAT, false, offsetof(Vertex, position)},
+                {1, 2, GL_FLOAT, false, offsetof(Vertex, uv)},
+                {2, 3, GL_FLOAT, false, offsetof(Vertex, normal)},
+                {3, 4, GL_FLOAT, false, offsetof(Vertex, tangent)},
+            }
+        };
+        return;
+    }
+
+    if (format == VertexFormat::HALF_UV) {
+        layout = {
+            sizeof(HalfUvVertex), {
+                {0, 3, GL_FLOAT, false, offsetof(HalfUvVertex, position)},
+                {1, 2, GL_HALF_FLOAT, false, offsetof(HalfUvVertex, uv)},
+                {2, 4, GL_INT_2_10_10_10_REV, true, offsetof(HalfUvVertex, normal)},
+                {3, 4, GL_INT_2_10_10_10_REV, true, offsetof(HalfUvVertex, tangent)},
+            }
+        };
+        return;
+    }
+
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+
+    for (const Vertex &vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+        uvsNormalized &= vertex.uv.x >= 0.0f && vertex.uv.x <= 1.0f && vertex.uv.y >= 0.0f && vertex.uv.y <= 1.0f;
+    }
+
+    if (vertices.empty()) {
+        boundsMin = boundsMax = glm::vec3(0.0f);
+    }
+
+    // flat meshes would otherwise divide by zero
+    extent = boundsMax - boundsMin;
+    for (int axis = 0; axis < 3; axis++) {
+        if (extent[axis] <= 0.0f) extent[axis] = 1.0f;
+    }
+
+    // unorm attributes arrive in the shader in [0, 1], so undoing the quantization is just a scale and offset
+    positionDecodeMatrix = glm::scale(glm::translate(glm::identity<glm::mat4>(), boundsMin), extent);
+
+    layout = {
+        sizeof(QuantizedVertex), {
+            {0, 3, GL_UNSIGNED_SHORT, true, offsetof(QuantizedVertex, position)},
+            uvsNormalized
+                ? VertexAttribute{1, 2, GL_UNSIGNED_SHORT, true, offsetof(QuantizedVertex, uv)}
+                : VertexAttribute{1, 2, GL_HALF_FLOAT, false, offsetof(QuantizedVertex, uv)},
+            {2, 4, GL_INT_2_10_10_10_REV, true, offsetof(QuantizedVertex, normal)},
+            {3, 4, GL_INT_2_10_10_10_REV, true, offsetof(QuantizedVertex, tangent)},
+        }
+    };
+}
+
+void VertexEncoder::encode(const std::span<const Vertex> vertices, std::byte *out) const {
+    if (format == VertexFormat::FLOAT) {
+        std::memcpy(out, vertices.data(), vertices.size_bytes());
+        return;
+    }
+
+    if (format == VertexFormat::HALF_UV) {
+        auto *halfUvOut = reinterpret_cast<HalfUvVertex *>(out);
+
+        for (std::size_t i = 0; i < vertices.size(); i++) {
+            halfUvOut[i] = {
+                vertices[i].position, glm::packHalf2x16(vertices[i].uv),
+                packDirection(vertices[i].normal), glm::packSnorm3x10_1x2(vertices[i].tangent)
+            };
+        }
+
+        return;
+    }
+
+    auto *quantizedOut = reinterpret_cast<QuantizedVertex *>(out);
+
+    for (std::size_t i = 0; i < vertices.size(); i++) {
+        const glm::vec3 normalized = (vertices[i].position - boundsMin) / extent;
+        const glm::vec2 uv = vertices[i].uv;
+
+        quantizedOut[i] = {
+            {packUnorm16(normalized.x), packUnorm16(normalized.y), packUnorm16(normalized.z)},
+            0,
+            {
+                uvsNormalized ? packUnorm16(uv.x) : glm::packHalf1x16(uv.x),
+                uvsNormalized ? packUnorm16(uv.y) : glm::packHalf1x16(uv.y)
+            },
+            packDirection(vertices[i].normal),
+            glm::packSnorm3x10_1x2(vertices[i].tangent)
+        };
+    }
+}
+
+EncodedVertices encodeVertices(const std::span<const Vertex> vertices, const VertexFormat format) {
+    const VertexEncoder encoder(vertices, format);
+
+    EncodedVertices encoded;
+    encoded.layout = encoder.getLayout();
+    encoded.positionDecodeMatrix = encoder.getPositionDecodeMatrix();
+    encoded.data.resize(vertices.size() * encoded.layout.stride);
+    encoder.encode(vertices, encoded.data.data());
+
+    return encoded;
+}
@@ -0,0 +1,75 @@
+#ifndef VERTEX_FORMAT_HPP
+#define VERTEX_FORMAT_HPP
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "utilities/vertex-layout.hpp"
+#include "vertex.hpp"
+
+/**
+ * Ways of storing mesh vertices in GPU memory, from the most precise to the most compact.
+ */
+enum class VertexFormat {
+    // 48 bytes -- float positions, texture coordinates, normals and tangents, exactly as they are cooked
+    FLOAT,
+
+    // 24 bytes -- float positions, half-float texture coordinates, snorm10 normals and tangents
+    HALF_UV,
+
+    // 20 bytes -- unorm16 positions relative to the mesh's bounding box, 16-bit texture coordinates
+    // (unorm16 if they all lie in [0, 1], half-float otherwise), snorm10 normals and tangents
+    QUANTIZED,
+};
+
+const char *getVertexFormatName(VertexFormat format);
+
+/**
+ * Vertices converted into some `VertexFormat`, ready to be uploaded into a vertex buffer.
+ */
+struct EncodedVertices {
+    VertexLayout layout;
+    std::vector<std::byte> data;
+
+    // maps positions as seen by the vertex shader back to the mesh's object space,
+    // meant to be folded into the model matrix
+    glm::mat4 positionDecodeMatrix;
+};
+
+/**
+ * Converts the vertices of a mesh into some `VertexFormat` a range at a time, so that they can be encoded straight
+ * into GPU memory without ever holding an encoded copy of the whole mesh.
+ *
+ * The layout and the position decode matrix are derived from all of the mesh's vertices when the encoder is
+ * created, which takes a single pass over them but doesn't copy anything.
+ */
+class VertexEncoder {
+    VertexFormat format;
+    VertexLayout layout;
+    glm::mat4 positionDecodeMatrix;
+
+    // quantized positions are relative to the mesh's bounding box
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 extent{1.0f};
+    bool uvsNormalized = true;
+
+public:
+    VertexEncoder(std::span<const Vertex> vertices, VertexFormat format);
+
+    [[nodiscard]] const VertexLayout &getLayout() const { return layout; }
+
+    [[nodiscard]] const glm::mat4 &getPositionDecodeMatrix() const { return positionDecodeMatrix; }
+
+    /**
+     * Encodes the given vertices, which have to be some of those the encoder was created with, into `out`, which
+     * has to have room for the layout's stride times their count.
+     */
+    void encode(std::span<const Vertex> vertices, std::byte *out) const;
+};
+
+EncodedVertices encodeVertices(std::span<const Vertex> vertices, VertexFormat format);
+
+#endif //VERTEX_FORMAT_HPP
@@ -0,0 +1,31 @@
+#include "vertex-welder.hpp"
+
+#include <algorithm>
+#include <bit>
+
+void VertexWelder::reset(const std::size_t expectedCount) {
+    // keep the load factor at or below 1/2, so probe sequences stay short
+    const std::size_t slotCount = std::bit_ceil(std::max<std::size_t>(expectedCount * 2, 16));
+
+    slots.assign(slotCount, {EMPTY_SLOT, 0});
+    slotMask = slotCount - 1;
+    size = 0;
+}
+
+void VertexWelder::grow() {
+    std::vector<Slot> oldSlots = std::move(slots);
+
+    slots.assign(oldSlots.size() * 2, {EMPTY_SLOT, 0});
+    slotMask = slots.size() - 1;
+
+    for (const Slot &slot : oldSlots) {
+        if (slot.id == EMPTY_SLOT) continue;
+
+        std::size_t i = slot.hashTag & slotMask;
+        while (slots[i].id != EMPTY_SLOT) {
+            i = (i + 1) & slotMask;
+        }
+
+        slots[i] = slot;
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef VERTEX_WELDER_HPP
+#define VERTEX_WELDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "vertex.hpp"
+
+/**
+ * Hash table specialized for deduplicating vertices.
+ *
+ * The table doesn't store vertices itself, only ids of vertices living in some external array, together with
+ * a part of their hash. Slots are kept in a single flat array and collisions are resolved with linear probing,
+ * so a lookup usually touches a single cache line, and finding and inserting a vertex is done in one probe sequence.
+ */
+class VertexWelder {
+    static constexpr GLuint EMPTY_SLOT = ~GLuint{0};
+
+    struct Slot {
+        GLuint id;
+        std::uint32_t hashTag;
+    };
+
+    std::vector<Slot> slots;
+    std::size_t slotMask = 0;
+    std::size_t size = 0;
+
+public:
+    explicit VertexWelder(const std::size_t expectedCount = 0) { reset(expectedCount); }
+
+    /**
+     * Empties the table, reserving enough space to hold `expectedCount` vertices without growing.
+     */
+    void reset(std::size_t expectedCount);
+
+    /**
+     * Looks up a vertex equal to `vertex`, inserting it with the given id if there's none.
+     * Returns the id of the vertex in the table -- either of the one already present, or `id` if it was inserted.
+     * `getVertex` maps ids of previously inserted vertices to their values.
+     */
+    template<typename GetVertex>
+    GLuint weld(const Vertex &vertex, const GLuint id, GetVertex &&getVertex) {
+        if ((size + 1) * 2 > slots.size()) {
+            grow();
+        }
+
+        // the tag doubles as the source of the slot index, so the table can be rehashed without touching the vertices
+        const auto hashTag = static_cast<std::uint32_t>(std::hash<Vertex>()(vertex));
+
+        for (std::size_t i = hashTag & slotMask;; i = (i + 1) & slotMask) {
+            Slot &slot = slots[i];
+
+            if (slot.id == EMPTY_SLOT) {
+                slot = {id, hashTag};
+                size++;
+                return id;
+            }
+
+            if (slot.hashTag == hashTag && getVertex(slot.id) == vertex) {
+                return slot.id;
+            }
+        }
+    }
+
+private:
+    void grow();
+};
+
+#endif //VERTEX_WELDER_HPP
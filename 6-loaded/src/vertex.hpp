@@ -1,27 +1,58 @@
 #ifndef VERTEX_HPP
 #define VERTEX_HPP
 
-#include <string>
+#include <bit>
+#include <cstdint>
+#include <functional>
 
-#define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
-#include "glm/gtx/hash.hpp"
 
 struct Vertex {
     glm::vec3 position;
     glm::vec2 uv;
 
+    // derived from the mesh's geometry by `generateTangentFrames`, so they don't take part in welding -- the
+    // tangent's w is the handedness of the frame, i.e. the sign of the bitangent
+    glm::vec3 normal{0.0f};
+    glm::vec4 tangent{0.0f};
+
     bool operator==(const Vertex &other) const {
         return position == other.position
             && uv == other.uv;
     }
 };
 
+/**
+ * Hashes the raw bits of all the vertex's components, mixing them pairwise with a full 64-bit avalanche.
+ * Combining per-component hashes with shifts and XORs collides a lot for vertices of real meshes,
+ * which tend to differ only in the low bits of a single coordinate.
+ */
 template <>
 struct std::hash<Vertex> {
     std::size_t operator()(const Vertex& vertex) const noexcept {
-        return (hash<glm::vec3>()(vertex.position) >> 1) ^
-               (hash<glm::vec2>()(vertex.uv) << 1);
+        std::uint64_t hash = 0x9E3779B97F4A7C15ull;
+        hash = mix(hash ^ pack(vertex.position.x, vertex.position.y));
+        hash = mix(hash ^ pack(vertex.position.z, vertex.uv.x));
+        hash = mix(hash ^ pack(vertex.uv.y, 0.0f));
+        return static_cast<std::size_t>(hash);
+    }
+
+private:
+    static std::uint64_t pack(const float a, const float b) {
+        // +0.0 and -0.0 compare equal, so they must hash equally too
+        const auto bitsA = std::bit_cast<std::uint32_t>(a == 0.0f ? 0.0f : a);
+        const auto bitsB = std::bit_cast<std::uint32_t>(b == 0.0f ? 0.0f : b);
+        return static_cast<std::uint64_t>(bitsA) << 32 | bitsB;
+    }
+
+    // the 64-bit finalizer of MurmurHash3
+    static std::uint64_t mix(std::uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDull;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ull;
+        x ^= x >> 33;
+        return x;
     }
 };
 
@@ -5,10 +5,15 @@ in vec3 normal;
 
 out vec4 out_color;
 
-uniform vec3 light_direction;
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 lightDirection; // towards the light
+    vec4 cameraPosition;
+};
 
 void main() {
-    float diffuse_factor = max(dot(-normal, light_direction), 0.1f);
+    float diffuse_factor = max(dot(normal, lightDirection.xyz), 0.1f);
     vec3 diffuse = diffuse_factor * color;
 
     out_color = vec4(diffuse, 1.0f);
@@ -7,10 +7,17 @@ layout (location = 2) in vec3 in_normal;
 out vec3 color;
 out vec3 normal; // normals are interpolated! this might not be intended in certain cases (e.g. in flat shading)
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 light_direction;
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 lightDirection; // towards the light
+    vec4 cameraPosition;
+};
+
+layout (std140) uniform ObjectUniforms {
+    mat4 model;
+    mat4 normalMatrix;
+};
 
 void main() {
     gl_Position = projection * view * model * vec4(in_position, 1.0);
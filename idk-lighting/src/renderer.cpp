@@ -35,7 +35,7 @@ const std::vector<Vertex> vertices{
 };
 
 // each of these triples is a triangle
-const std::vector<GLuint> indices{
+const std::vector<GLushort> indices{ // 12 vertices, so 16-bit indices are plenty
     0, 4, 1,
     0, 9, 4,
     9, 5, 4,
@@ -106,10 +106,15 @@ OpenGLRenderer::OpenGLRenderer(const int windowWidth, const int windowHeight) {
         "../5-lighting/shaders/main.frag"
     );
 
+    frameUniforms = std::make_unique<UniformBuffer<FrameUniforms>>();
+    objectUniforms = std::make_unique<UniformBuffer<ObjectUniforms>>();
+
     prepareBuffers();
 }
 
 OpenGLRenderer::~OpenGLRenderer() {
+    frameUniforms.reset(); // have to go while the context is still alive
+    objectUniforms.reset();
     glDeleteBuffers(1, &vbo);
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &ebo);
@@ -170,12 +175,19 @@ void OpenGLRenderer::startRendering() {
 void OpenGLRenderer::render() {
     shaders->enable();
 
-    shaders->setUniform("model", glm::identity<glm::mat4>());
-    shaders->setUniform("view", getViewMatrix());
-    shaders->setUniform("projection", glm::perspective(glm::radians(fieldOfView), aspectRatio, zNear, zFar));
-    shaders->setUniform("light_direction", glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f)));
-
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    // the light shines along (1, 2, 3), and the block holds the direction towards it
+    frameUniforms->update({
+        .view = getViewMatrix(),
+        .projection = glm::perspective(glm::radians(fieldOfView), aspectRatio, zNear, zFar),
+        .lightDirection = glm::vec4(-glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f)), 0.0f),
+        .cameraPosition = glm::vec4(cameraPosition, 1.0f),
+    });
+    objectUniforms->update({
+        .model = glm::identity<glm::mat4>(),
+        .normalMatrix = glm::identity<glm::mat4>(),
+    });
+
+    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_SHORT, 0);
 }
 
 void OpenGLRenderer::finishRendering() const {
@@ -187,43 +199,18 @@ void OpenGLRenderer::prepareBuffers() {
     glGenVertexArrays(1, &vao);
     glBindVertexArray(vao);
 
+    const std::vector<PackedVertex> packedVertices(vertices.begin(), vertices.end());
+
     glGenBuffers(1, &vbo);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(PackedVertex) * packedVertices.size(), packedVertices.data(),
+                 GL_STATIC_DRAW);
 
     glGenBuffers(1, &ebo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * indices.size(), indices.data(), GL_STATIC_DRAW);
 
-    glVertexAttribPointer(
-        0,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(Vertex),
-        reinterpret_cast<void *>(offsetof(Vertex, position))
-    );
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(
-        1,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(Vertex),
-        reinterpret_cast<void *>(offsetof(Vertex, color))
-    );
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(
-        2,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(Vertex),
-        reinterpret_cast<void *>(offsetof(Vertex, normal))
-    );
-    glEnableVertexAttribArray(2);
+    PackedVertex::getLayout().apply();
 }
 
 glm::mat4 OpenGLRenderer::getViewMatrix() const {
@@ -7,12 +7,15 @@
 #include "GLFW/glfw3.h"
 
 #include "utilities/gl-shader.hpp"
+#include "utilities/uniform-buffer.hpp"
 
 class OpenGLRenderer {
     glm::ivec2 windowSize;
     GLFWwindow *window;
 
     std::unique_ptr<GLShaders> shaders;
+    std::unique_ptr<UniformBuffer<FrameUniforms>> frameUniforms;
+    std::unique_ptr<UniformBuffer<ObjectUniforms>> objectUniforms;
 
     GLuint vbo;
     GLuint vao;
@@ -1 +1,19 @@
 #include "vertex.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+PackedVertex::PackedVertex(const Vertex &vertex)
+    : position(vertex.position),
+      color(glm::packUnorm4x8(glm::vec4(vertex.color, 1.0f))),
+      normal(glm::packSnorm3x10_1x2(glm::vec4(vertex.normal, 0.0f))) {
+}
+
+VertexLayout PackedVertex::getLayout() {
+    return {
+        sizeof(PackedVertex), {
+            {0, 3, GL_FLOAT, false, offsetof(PackedVertex, position)},
+            {1, 3, GL_UNSIGNED_BYTE, true, offsetof(PackedVertex, color)},
+            {2, 4, GL_INT_2_10_10_10_REV, true, offsetof(PackedVertex, normal)},
+        }
+    };
+}
@@ -1,8 +1,13 @@
 #include "gl-shader.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
+#include "gl-state.hpp"
+#include "uniform-buffer.hpp"
+
 GLShaders::GLShaders(const std::filesystem::path &vertexShaderPath, const std::filesystem::path &fragmentShaderPath) {
     programID = glCreateProgram();
     const GLuint vertexShaderID = compileShader(GL_VERTEX_SHADER, vertexShaderPath);
@@ -10,65 +15,235 @@ GLShaders::GLShaders(const std::filesystem::path &vertexShaderPath, const std::f
     linkProgram(vertexShaderID, fragmentShaderID);
     glDeleteShader(vertexShaderID);
     glDeleteShader(fragmentShaderID);
+    reflectUniforms();
+    bindUniformBlocks();
 }
 
 void GLShaders::enable() const {
-    glUseProgram(programID);
+    getGLState().useProgram(programID);
+}
+
+void GLShaders::setUniform(const UniformName &name, const GLint value) {
+    setUniformValue(uniforms[findUniform(name.hash, name.name, GL_INT)], value);
 }
 
-void GLShaders::setUniform(const std::string &name, const GLint value) {
-    const GLint uniformID = getUniformID(name);
-    glUniform1i(uniformID, value);
+void GLShaders::setUniform(const UniformName &name, const float value) {
+    setUniformValue(uniforms[findUniform(name.hash, name.name, GL_FLOAT)], value);
 }
 
-void GLShaders::setUniform(const std::string &name, const float value) {
-    const GLint uniformID = getUniformID(name);
-    glUniform1f(uniformID, value);
+void GLShaders::setUniform(const UniformName &name, const glm::vec2 &value) {
+    setUniformValue(uniforms[findUniform(name.hash, name.name, GL_FLOAT_VEC2)], value);
 }
 
-void GLShaders::setUniform(const std::string &name, const glm::vec2 &value) {
-    const GLint uniformID = getUniformID(name);
-    glUniform2f(uniformID, value.x, value.y);
+void GLShaders::setUniform(const UniformName &name, const glm::vec3 &value) {
+    setUniformValue(uniforms[findUniform(name.hash, name.name, GL_FLOAT_VEC3)], value);
 }
 
-void GLShaders::setUniform(const std::string &name, const glm::vec3 &value) {
-    const GLint uniformID = getUniformID(name);
-    glUniform3f(uniformID, value.x, value.y, value.z);
+void GLShaders::setUniform(const UniformName &name, const glm::vec4 &value) {
+    setUniformValue(uniforms[findUniform(name.hash, name.name, GL_FLOAT_VEC4)], value);
 }
 
-void GLShaders::setUniform(const std::string &name, const glm::vec4 &value) {
-    const GLint uniformID = getUniformID(name);
-    glUniform4f(uniformID, value.x, value.y, value.z, value.w);
+void GLShaders::setUniform(const UniformName &name, const glm::mat4 &value) {
+    setUniformValue(uniforms[findUniform(name.hash, name.name, GL_FLOAT_MAT4)], value);
 }
 
-void GLShaders::setUniform(const std::string &name, const glm::mat4 &value) {
-    const GLint uniformID = getUniformID(name);
-    glUniformMatrix4fv(uniformID, 1, GL_FALSE, &value[0][0]);
+void GLShaders::setUniform(const UniformName &name, const std::vector<GLint> &value) {
+    setUniformValue(uniforms[findUniform(name.hash, name.name, GL_INT)], value);
 }
 
-void GLShaders::setUniform(const std::string &name, const std::vector<GLint> &value) {
-    const GLint uniformID = getUniformID(name);
-    glUniform1iv(uniformID, static_cast<GLint>(value.size()), value.data());
+void GLShaders::setUniform(const UniformName &name, const std::vector<float> &value) {
+    setUniformValue(uniforms[findUniform(name.hash, name.name, GL_FLOAT)], value);
 }
 
-void GLShaders::setUniform(const std::string &name, const std::vector<float> &value) {
-    const GLint uniformID = getUniformID(name);
-    glUniform1fv(uniformID, static_cast<GLint>(value.size()), value.data());
+static bool isSamplerType(const GLenum type) {
+    switch (type) {
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_CUBE_MAP_ARRAY:
+        case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW: case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW: case GL_SAMPLER_BUFFER:
+        case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+        case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_CUBE_MAP_ARRAY:
+        case GL_INT_SAMPLER_2D_MULTISAMPLE: case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_INT_SAMPLER_2D_RECT: case GL_INT_SAMPLER_BUFFER:
+        case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+        case GL_UNSIGNED_INT_SAMPLER_CUBE: case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D_RECT: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+            return true;
+        default:
+            return false;
+    }
 }
 
-GLint GLShaders::getUniformID(const std::string &name) {
-    const auto it = uniformIDs.find(name);
-    if (it != uniformIDs.end()) {
-        return it->second;
+std::size_t GLShaders::findUniform(const std::uint64_t hash, const std::string_view name, const GLenum type) const {
+    const std::size_t mask = uniformSlots.size() - 1;
+
+    for (std::size_t slot = hash & mask; uniformSlots[slot] != -1; slot = (slot + 1) & mask) {
+        const ReflectedUniform &uniform = uniforms[uniformSlots[slot]];
+        if (uniform.hash != hash || uniform.name != name) {
+            continue;
+        }
+
+        // booleans and samplers are set through the scalar integer functions, and anything else has to match exactly
+        const bool isIntType = uniform.type == GL_INT || uniform.type == GL_BOOL || isSamplerType(uniform.type);
+        if (type == GL_INT ? !isIntType : uniform.type != type) {
+            throw std::runtime_error("uniform set to a value of the wrong type: " + std::string(name));
+        }
+
+        return static_cast<std::size_t>(uniformSlots[slot]);
     }
 
-    const GLint id = glGetUniformLocation(programID, name.c_str());
-    if (id == -1) {
-        throw std::runtime_error("failed to get uniform with name: " + name);
+    throw std::runtime_error("failed to get uniform with name: " + std::string(name));
+}
+
+void GLShaders::reflectUniforms() {
+    GLint uniformCount = 0, maxNameLength = 0;
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<char> nameBuffer(std::max(maxNameLength, 1));
+
+    for (GLint i = 0; i < uniformCount; i++) {
+        GLsizei nameLength = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(programID, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()), &nameLength,
+                           &size, &type, nameBuffer.data());
+
+        // members of uniform blocks have no location, and are set through their block's buffer instead
+        const GLint location = glGetUniformLocation(programID, nameBuffer.data());
+        if (location == -1) {
+            continue;
+        }
+
+        std::string name(nameBuffer.data(), nameLength);
+        if (name.ends_with("[0]")) {
+            name.resize(name.size() - 3);
+        }
+
+        const std::uint64_t hash = hashUniformName(name);
+        uniforms.push_back({std::move(name), hash, location, type, {}});
+    }
+
+    // at most half full, so that probes stay short
+    std::size_t slotCount = 1;
+    while (slotCount < uniforms.size() * 2) {
+        slotCount *= 2;
+    }
+
+    uniformSlots.assign(slotCount, -1);
+    const std::size_t mask = slotCount - 1;
+
+    for (std::size_t i = 0; i < uniforms.size(); i++) {
+        std::size_t slot = uniforms[i].hash & mask;
+        while (uniformSlots[slot] != -1) {
+            slot = (slot + 1) & mask;
+        }
+
+        uniformSlots[slot] = static_cast<std::int32_t>(i);
+    }
+}
+
+void GLShaders::bindUniformBlocks() const {
+    GLint blockCount = 0, maxNameLength = 0;
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+
+    std::vector<char> nameBuffer(std::max(maxNameLength, 1));
+
+    for (GLint i = 0; i < blockCount; i++) {
+        const auto index = static_cast<GLuint>(i);
+        GLsizei nameLength = 0;
+        GLint dataSize = 0;
+        glGetActiveUniformBlockName(programID, index, static_cast<GLsizei>(nameBuffer.size()), &nameLength,
+                                    nameBuffer.data());
+        glGetActiveUniformBlockiv(programID, index, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+
+        const std::string name(nameBuffer.data(), nameLength);
+        GLuint binding;
+        std::size_t size;
+
+        if (name == FrameUniforms::BLOCK_NAME) {
+            binding = FrameUniforms::BINDING;
+            size = sizeof(FrameUniforms);
+        } else if (name == ObjectUniforms::BLOCK_NAME) {
+            binding = ObjectUniforms::BINDING;
+            size = sizeof(ObjectUniforms);
+        } else {
+            throw std::runtime_error("no struct mirrors uniform block: " + name);
+        }
+
+        // the offsets are checked at compile time on the C++ side, so this catches blocks declared differently
+        if (static_cast<std::size_t>(dataSize) != size) {
+            throw std::runtime_error("uniform block doesn't match the struct mirroring it: " + name);
+        }
+
+        glUniformBlockBinding(programID, index, binding);
+    }
+}
+
+void GLShaders::setUniformValue(ReflectedUniform &uniform, const GLint value) {
+    if (updateValue(uniform, &value, sizeof(value))) {
+        glUniform1i(uniform.location, value);
+    }
+}
+
+void GLShaders::setUniformValue(ReflectedUniform &uniform, const float value) {
+    if (updateValue(uniform, &value, sizeof(value))) {
+        glUniform1f(uniform.location, value);
+    }
+}
+
+void GLShaders::setUniformValue(ReflectedUniform &uniform, const glm::vec2 &value) {
+    if (updateValue(uniform, &value, sizeof(value))) {
+        glUniform2f(uniform.location, value.x, value.y);
+    }
+}
+
+void GLShaders::setUniformValue(ReflectedUniform &uniform, const glm::vec3 &value) {
+    if (updateValue(uniform, &value, sizeof(value))) {
+        glUniform3f(uniform.location, value.x, value.y, value.z);
+    }
+}
+
+void GLShaders::setUniformValue(ReflectedUniform &uniform, const glm::vec4 &value) {
+    if (updateValue(uniform, &value, sizeof(value))) {
+        glUniform4f(uniform.location, value.x, value.y, value.z, value.w);
+    }
+}
+
+void GLShaders::setUniformValue(ReflectedUniform &uniform, const glm::mat4 &value) {
+    if (updateValue(uniform, &value, sizeof(value))) {
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &value[0][0]);
+    }
+}
+
+void GLShaders::setUniformValue(ReflectedUniform &uniform, const std::vector<GLint> &value) {
+    if (updateValue(uniform, value.data(), value.size() * sizeof(GLint))) {
+        glUniform1iv(uniform.location, static_cast<GLint>(value.size()), value.data());
+    }
+}
+
+void GLShaders::setUniformValue(ReflectedUniform &uniform, const std::vector<float> &value) {
+    if (updateValue(uniform, value.data(), value.size() * sizeof(float))) {
+        glUniform1fv(uniform.location, static_cast<GLint>(value.size()), value.data());
+    }
+}
+
+bool GLShaders::updateValue(ReflectedUniform &uniform, const void *data, const std::size_t size) {
+    // compared bytewise, so a NaN set twice in a row is still only set once
+    const bool isChanged = uniform.value.size() != size || std::memcmp(uniform.value.data(), data, size) != 0;
+    getGLState().countUniform(isChanged);
+
+    if (isChanged) {
+        const auto *bytes = static_cast<const std::byte *>(data);
+        uniform.value.assign(bytes, bytes + size);
     }
 
-    uniformIDs.emplace(name, id);
-    return id;
+    return isChanged;
 }
 
 GLuint GLShaders::compileShader(const GLuint shaderKind, const std::filesystem::path &path) const {
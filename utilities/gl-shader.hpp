@@ -1,19 +1,65 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
-#include <unordered_map>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
-#include <map>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <sstream>
 
+/**
+ * FNV-1a hash of a uniform's name. Usable at compile time, so that names given as literals are hashed by the compiler.
+ */
+constexpr std::uint64_t hashUniformName(const std::string_view name) {
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for (const char c : name) {
+        hash = (hash ^ static_cast<std::uint8_t>(c)) * 0x100000001b3;
+    }
+
+    return hash;
+}
+
+/**
+ * A uniform's name given as a string literal, hashed at compile time. Looking a uniform up by one never allocates.
+ */
+struct UniformName {
+    std::string_view name;
+    std::uint64_t hash;
+
+    template<std::size_t N>
+    consteval UniformName(const char (&literal)[N]) : name(literal, N - 1), hash(hashUniformName(name)) {}
+};
+
+/**
+ * A uniform of a specific program, looked up once by `GLShaders::getUniform` and typed by the values it can be set
+ * to. Stays valid for as long as the program it was looked up in.
+ */
+template<typename T>
+struct UniformHandle {
+    std::size_t index = 0; // into the program's reflected uniforms
+};
+
 class GLShaders {
+    struct ReflectedUniform {
+        std::string name; // without the "[0]" suffix of arrays
+        std::uint64_t hash;
+        GLint location;
+        GLenum type;
+        std::vector<std::byte> value; // the last value it was set to, empty until it's first set
+    };
+
     GLuint programID;
 
-    std::map<std::string, GLint> uniformIDs {};
+    // every active uniform of the program which has a location, as reflected after linking, and an open addressing
+    // table of indices into it, indexed by the low bits of the names' hashes
+    std::vector<ReflectedUniform> uniforms;
+    std::vector<std::int32_t> uniformSlots;
 
 public:
     GLShaders(const std::filesystem::path &vertexShaderPath, const std::filesystem::path &fragmentShaderPath);
@@ -22,24 +68,97 @@ public:
 
     void enable() const;
 
-    void setUniform(const std::string& name, GLint value);
+    /**
+     * Looks up the uniform with the given name, throwing if the program has no such uniform or if it can't be set to
+     * values of the handle's type. The handle can be used to set the uniform without any lookup from then on.
+     */
+    template<typename T>
+    UniformHandle<T> getUniform(const std::string_view name) const {
+        return {findUniform(hashUniformName(name), name, getUniformType<T>())};
+    }
+
+    /**
+     * Sets a uniform of the program, which has to be enabled. Values the uniform already has aren't set again.
+     */
+    template<typename T>
+    void setUniform(const UniformHandle<T> handle, const std::type_identity_t<T> &value) {
+        setUniformValue(uniforms[handle.index], value);
+    }
+
+    /**
+     * Sets a uniform of the program, which has to be enabled, looking it up by its name first. Values the uniform
+     * already has aren't set again.
+     */
+    void setUniform(const UniformName &name, GLint value);
 
-    void setUniform(const std::string& name, float value);
+    void setUniform(const UniformName &name, float value);
 
-    void setUniform(const std::string& name, const glm::vec2& value);
+    void setUniform(const UniformName &name, const glm::vec2 &value);
 
-    void setUniform(const std::string& name, const glm::vec3& value);
+    void setUniform(const UniformName &name, const glm::vec3 &value);
 
-    void setUniform(const std::string& name, const glm::vec4& value);
+    void setUniform(const UniformName &name, const glm::vec4 &value);
 
-    void setUniform(const std::string& name, const glm::mat4& value);
+    void setUniform(const UniformName &name, const glm::mat4 &value);
 
-    void setUniform(const std::string& name, const std::vector<GLint>& value);
+    void setUniform(const UniformName &name, const std::vector<GLint> &value);
 
-    void setUniform(const std::string& name, const std::vector<float>& value);
+    void setUniform(const UniformName &name, const std::vector<float> &value);
 
 private:
-    GLint getUniformID(const std::string &name);
+    /**
+     * Returns the index of the uniform with the given name and hash, checking that it's of the given type. Every
+     * integer type also stands for booleans and samplers, which are set the same way.
+     */
+    std::size_t findUniform(std::uint64_t hash, std::string_view name, GLenum type) const;
+
+    void reflectUniforms();
+
+    /**
+     * Binds every uniform block the program declares to the binding point of the struct mirroring it, throwing if
+     * there's no such struct or if the block's size doesn't match it.
+     */
+    void bindUniformBlocks() const;
+
+    static void setUniformValue(ReflectedUniform &uniform, GLint value);
+
+    static void setUniformValue(ReflectedUniform &uniform, float value);
+
+    static void setUniformValue(ReflectedUniform &uniform, const glm::vec2 &value);
+
+    static void setUniformValue(ReflectedUniform &uniform, const glm::vec3 &value);
+
+    static void setUniformValue(ReflectedUniform &uniform, const glm::vec4 &value);
+
+    static void setUniformValue(ReflectedUniform &uniform, const glm::mat4 &value);
+
+    static void setUniformValue(ReflectedUniform &uniform, const std::vector<GLint> &value);
+
+    static void setUniformValue(ReflectedUniform &uniform, const std::vector<float> &value);
+
+    /**
+     * Remembers the given bytes as the uniform's value, returning whether they're any different from the previous
+     * one -- if they're not, there's no need to set it. Either way, counts the set in the GL state's stats.
+     */
+    static bool updateValue(ReflectedUniform &uniform, const void *data, std::size_t size);
+
+    template<typename T>
+    static constexpr GLenum getUniformType() {
+        if constexpr (std::is_same_v<T, GLint> || std::is_same_v<T, std::vector<GLint>>) {
+            return GL_INT;
+        } else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, std::vector<float>>) {
+            return GL_FLOAT;
+        } else if constexpr (std::is_same_v<T, glm::vec2>) {
+            return GL_FLOAT_VEC2;
+        } else if constexpr (std::is_same_v<T, glm::vec3>) {
+            return GL_FLOAT_VEC3;
+        } else if constexpr (std::is_same_v<T, glm::vec4>) {
+            return GL_FLOAT_VEC4;
+        } else {
+            static_assert(std::is_same_v<T, glm::mat4>, "uniforms can't be set to values of this type");
+            return GL_FLOAT_MAT4;
+        }
+    }
 
     GLuint compileShader(GLuint shaderKind, const std::filesystem::path &path) const;
 
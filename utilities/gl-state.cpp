@@ -0,0 +1,220 @@
+#include "gl-state.hpp"
+
+#include <utility>
+
+GLState::GLState() {
+    invalidate();
+}
+
+void GLState::invalidate() {
+    program = UNKNOWN;
+    vertexArray = UNKNOWN;
+    buffers.fill(UNKNOWN);
+    uniformBufferRanges.fill({});
+    activeTextureUnit = UNKNOWN;
+
+    for (auto &unitTextures : textures) {
+        unitTextures.fill(UNKNOWN);
+    }
+
+    capabilities.clear();
+}
+
+bool GLState::useProgram(const GLuint id) {
+    const bool isIssued = program != id;
+    count(GLStateCall::PROGRAM, isIssued);
+
+    if (isIssued) {
+        glUseProgram(id);
+        program = id;
+    }
+
+    return isIssued;
+}
+
+bool GLState::bindVertexArray(const GLuint id) {
+    const bool isIssued = vertexArray != id;
+    count(GLStateCall::VERTEX_ARRAY, isIssued);
+
+    if (isIssued) {
+        glBindVertexArray(id);
+        vertexArray = id;
+    }
+
+    return isIssued;
+}
+
+bool GLState::bindBuffer(const GLenum target, const GLuint id) {
+    const std::size_t index = findBufferTarget(target);
+    const bool isIssued = index == BUFFER_TARGETS.size() || buffers[index] != id;
+    count(GLStateCall::BUFFER, isIssued);
+
+    if (isIssued) {
+        glBindBuffer(target, id);
+
+        if (index < BUFFER_TARGETS.size()) {
+            buffers[index] = id;
+        }
+    }
+
+    return isIssued;
+}
+
+bool GLState::bindUniformBufferRange(const GLuint index, const GLuint id, const GLintptr offset,
+                                     const GLsizeiptr size) {
+    const bool isShadowed = index < UNIFORM_BUFFER_BINDING_COUNT;
+    const bool isIssued = !isShadowed || uniformBufferRanges[index].buffer != id
+                          || uniformBufferRanges[index].offset != offset || uniformBufferRanges[index].size != size;
+    count(GLStateCall::BUFFER, isIssued);
+
+    if (isIssued) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, index, id, offset, size);
+        buffers[findBufferTarget(GL_UNIFORM_BUFFER)] = id;
+
+        if (isShadowed) {
+            uniformBufferRanges[index] = {id, offset, size};
+        }
+    }
+
+    return isIssued;
+}
+
+bool GLState::setActiveTextureUnit(const GLuint unit) {
+    const bool isIssued = activeTextureUnit != unit;
+    count(GLStateCall::TEXTURE, isIssued);
+
+    if (isIssued) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeTextureUnit = unit;
+    }
+
+    return isIssued;
+}
+
+bool GLState::bindTexture(const GLenum target, const GLuint id) {
+    const std::size_t targetIndex = findTextureTarget(target);
+    const bool isShadowed = activeTextureUnit < TEXTURE_UNIT_COUNT && targetIndex < TEXTURE_TARGETS.size();
+    const bool isIssued = !isShadowed || textures[activeTextureUnit][targetIndex] != id;
+    count(GLStateCall::TEXTURE, isIssued);
+
+    if (isIssued) {
+        glBindTexture(target, id);
+
+        if (isShadowed) {
+            textures[activeTextureUnit][targetIndex] = id;
+        }
+    }
+
+    return isIssued;
+}
+
+bool GLState::bindTexture(const GLuint unit, const GLenum target, const GLuint id) {
+    const std::size_t targetIndex = findTextureTarget(target);
+
+    // checked before switching units, so that a binding which is already there doesn't switch them either
+    if (unit < TEXTURE_UNIT_COUNT && targetIndex < TEXTURE_TARGETS.size() && textures[unit][targetIndex] == id) {
+        count(GLStateCall::TEXTURE, false);
+        return false;
+    }
+
+    setActiveTextureUnit(unit);
+    return bindTexture(target, id);
+}
+
+bool GLState::enable(const GLenum capability) {
+    return setCapability(capability, true);
+}
+
+bool GLState::disable(const GLenum capability) {
+    return setCapability(capability, false);
+}
+
+void GLState::deleteVertexArray(const GLuint id) {
+    glDeleteVertexArrays(1, &id);
+
+    if (vertexArray == id) {
+        vertexArray = 0;
+    }
+}
+
+void GLState::deleteBuffer(const GLuint id) {
+    glDeleteBuffers(1, &id);
+
+    // deleting a buffer unbinds it from every binding point it's bound to
+    for (GLuint &buffer : buffers) {
+        if (buffer == id) {
+            buffer = 0;
+        }
+    }
+
+    for (BufferRange &range : uniformBufferRanges) {
+        if (range.buffer == id) {
+            range = {0, 0, 0};
+        }
+    }
+}
+
+void GLState::deleteTexture(const GLuint id) {
+    glDeleteTextures(1, &id);
+
+    // deleting a texture unbinds it from every unit it's bound to
+    for (auto &unitTextures : textures) {
+        for (GLuint &texture : unitTextures) {
+            if (texture == id) {
+                texture = 0;
+            }
+        }
+    }
+}
+
+GLStateStats GLState::takeStats() {
+    return std::exchange(stats, {});
+}
+
+void GLState::count(const GLStateCall call, const bool isIssued) {
+    const auto index = static_cast<std::size_t>(call);
+    (isIssued ? stats.issuedCounts : stats.skippedCounts)[index]++;
+}
+
+bool GLState::setCapability(const GLenum capability, const bool isEnabled) {
+    const auto it = capabilities.find(capability);
+    const bool isIssued = it == capabilities.end() || it->second != isEnabled;
+    count(GLStateCall::CAPABILITY, isIssued);
+
+    if (isIssued) {
+        if (isEnabled) {
+            glEnable(capability);
+        } else {
+            glDisable(capability);
+        }
+
+        capabilities[capability] = isEnabled;
+    }
+
+    return isIssued;
+}
+
+std::size_t GLState::findBufferTarget(const GLenum target) {
+    for (std::size_t i = 0; i < BUFFER_TARGETS.size(); i++) {
+        if (BUFFER_TARGETS[i] == target) {
+            return i;
+        }
+    }
+
+    return BUFFER_TARGETS.size();
+}
+
+std::size_t GLState::findTextureTarget(const GLenum target) {
+    for (std::size_t i = 0; i < TEXTURE_TARGETS.size(); i++) {
+        if (TEXTURE_TARGETS[i] == target) {
+            return i;
+        }
+    }
+
+    return TEXTURE_TARGETS.size();
+}
+
+GLState &getGLState() {
+    static GLState state;
+    return state;
+}
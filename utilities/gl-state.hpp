@@ -0,0 +1,157 @@
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+
+#include <array>
+#include <cstddef>
+#include <unordered_map>
+
+#include <GL/glew.h>
+
+/**
+ * The kinds of GL calls the shadow state filters.
+ */
+enum class GLStateCall {
+    PROGRAM,
+    VERTEX_ARRAY,
+    BUFFER,
+    TEXTURE, // both binding textures and switching the active unit
+    CAPABILITY,
+    UNIFORM,
+    COUNT
+};
+
+/**
+ * How many calls of every kind were issued to GL, and how many were skipped as they wouldn't have changed anything.
+ */
+struct GLStateStats {
+    std::array<std::size_t, static_cast<std::size_t>(GLStateCall::COUNT)> issuedCounts{};
+    std::array<std::size_t, static_cast<std::size_t>(GLStateCall::COUNT)> skippedCounts{};
+
+    [[nodiscard]] std::size_t getIssuedCount(GLStateCall call) const {
+        return issuedCounts[static_cast<std::size_t>(call)];
+    }
+
+    [[nodiscard]] std::size_t getSkippedCount(GLStateCall call) const {
+        return skippedCounts[static_cast<std::size_t>(call)];
+    }
+};
+
+/**
+ * A shadow copy of the GL state which is changed the most often -- the current program, the bound vertex array,
+ * buffers and textures, and enabled capabilities -- which lets calls that wouldn't change anything be skipped before
+ * they ever reach the driver. Uniform values are shadowed by `GLShaders` itself, as they're state of the program.
+ *
+ * The shadow state only stays right if every change of the kinds of state it tracks goes through it, and so do
+ * deletions of whatever may still be bound -- GL unbinds deleted objects, and their names may be handed out again.
+ * Code which can't do that should call `invalidate` afterwards. Everything starts out unknown, so the first call of
+ * every kind is always issued.
+ *
+ * `GL_ELEMENT_ARRAY_BUFFER` is state of the bound vertex array rather than of the context, so it's never shadowed.
+ */
+class GLState {
+    static constexpr GLuint UNKNOWN = ~0u;
+    static constexpr std::size_t TEXTURE_UNIT_COUNT = 16;
+    static constexpr std::size_t UNIFORM_BUFFER_BINDING_COUNT = 16;
+
+    struct BufferRange {
+        GLuint buffer = UNKNOWN;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    // the texture targets which are shadowed for every unit
+    static constexpr std::array<GLenum, 2> TEXTURE_TARGETS = {GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY};
+
+    // the buffer targets which are shadowed, `GL_ELEMENT_ARRAY_BUFFER` aside
+    static constexpr std::array<GLenum, 6> BUFFER_TARGETS = {
+        GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER, GL_COPY_READ_BUFFER,
+        GL_COPY_WRITE_BUFFER
+    };
+
+    GLuint program = UNKNOWN;
+    GLuint vertexArray = UNKNOWN;
+    std::array<GLuint, BUFFER_TARGETS.size()> buffers{};
+    std::array<BufferRange, UNIFORM_BUFFER_BINDING_COUNT> uniformBufferRanges{};
+    GLuint activeTextureUnit = UNKNOWN;
+    std::array<std::array<GLuint, TEXTURE_TARGETS.size()>, TEXTURE_UNIT_COUNT> textures{};
+    std::unordered_map<GLenum, bool> capabilities;
+
+    GLStateStats stats;
+
+public:
+    GLState();
+
+    GLState(const GLState &other) = delete;
+
+    GLState &operator=(const GLState &other) = delete;
+
+    /**
+     * Forgets everything, so that the next call of every kind is issued. For after GL state has been changed without
+     * going through the shadow state.
+     */
+    void invalidate();
+
+    // each of the calls below returns whether it was issued
+
+    bool useProgram(GLuint id);
+
+    bool bindVertexArray(GLuint id);
+
+    bool bindBuffer(GLenum target, GLuint id);
+
+    /**
+     * Binds a range of a buffer to an indexed binding point of `GL_UNIFORM_BUFFER`, which binds the buffer to the
+     * generic binding point as well.
+     */
+    bool bindUniformBufferRange(GLuint index, GLuint id, GLintptr offset, GLsizeiptr size);
+
+    bool setActiveTextureUnit(GLuint unit);
+
+    /**
+     * Binds a texture to the active unit.
+     */
+    bool bindTexture(GLenum target, GLuint id);
+
+    /**
+     * Binds a texture to the given unit, making it the active one first. Returns whether the binding itself was
+     * issued.
+     */
+    bool bindTexture(GLuint unit, GLenum target, GLuint id);
+
+    bool enable(GLenum capability);
+
+    bool disable(GLenum capability);
+
+    void deleteVertexArray(GLuint id);
+
+    void deleteBuffer(GLuint id);
+
+    void deleteTexture(GLuint id);
+
+    /**
+     * Counts a uniform set by `GLShaders`, which does its own filtering.
+     */
+    void countUniform(bool isIssued) { count(GLStateCall::UNIFORM, isIssued); }
+
+    /**
+     * Returns the counters gathered since the previous call, and resets them.
+     */
+    GLStateStats takeStats();
+
+private:
+    void count(GLStateCall call, bool isIssued);
+
+    bool setCapability(GLenum capability, bool isEnabled);
+
+    static std::size_t findBufferTarget(GLenum target);
+
+    static std::size_t findTextureTarget(GLenum target);
+};
+
+/**
+ * Returns the shadow state of the GL context. Every program only ever has a single context, which is used from the
+ * render thread alone.
+ */
+GLState &getGLState();
+
+#endif //GL_STATE_HPP
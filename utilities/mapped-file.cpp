@@ -0,0 +1,92 @@
+#include "mapped-file.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path &path) {
+#ifdef _WIN32
+    fileHandle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        fileHandle = nullptr;
+        throw std::runtime_error("failed to open file for mapping: " + path.string());
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize)) {
+        unmap();
+        throw std::runtime_error("failed to query size of file: " + path.string());
+    }
+
+    size = static_cast<std::size_t>(fileSize.QuadPart);
+    if (size == 0) {
+        return; // empty files can't be mapped, but an empty span is a perfectly good view of them
+    }
+
+    mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle) {
+        unmap();
+        throw std::runtime_error("failed to map file: " + path.string());
+    }
+
+    data = static_cast<const std::byte *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!data) {
+        unmap();
+        throw std::runtime_error("failed to map file: " + path.string());
+    }
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("failed to open file for mapping: " + path.string());
+    }
+
+    struct stat fileStat {};
+    if (fstat(fd, &fileStat) == -1) {
+        close(fd);
+        throw std::runtime_error("failed to query size of file: " + path.string());
+    }
+
+    size = static_cast<std::size_t>(fileStat.st_size);
+    if (size == 0) {
+        close(fd);
+        return; // empty files can't be mapped, but an empty span is a perfectly good view of them
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps its own reference to the file
+    if (mapping == MAP_FAILED) {
+        size = 0;
+        throw std::runtime_error("failed to map file: " + path.string());
+    }
+
+    data = static_cast<const std::byte *>(mapping);
+#endif
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+void MappedFile::unmap() {
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (data) munmap(const_cast<std::byte *>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+}
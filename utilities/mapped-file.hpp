@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+/**
+ * Read-only memory mapping of a whole file.
+ * The mapping stays valid for the lifetime of this object, so spans handed out by `getData()`
+ * must not outlive it.
+ */
+class MappedFile {
+    const std::byte *data = nullptr;
+    std::size_t size = 0;
+
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+
+public:
+    explicit MappedFile(const std::filesystem::path &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &other) = delete;
+
+    MappedFile &operator=(const MappedFile &other) = delete;
+
+    std::span<const std::byte> getData() const { return {data, size}; }
+
+private:
+    void unmap();
+};
+
+#endif //MAPPED_FILE_HPP
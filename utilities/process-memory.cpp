@@ -0,0 +1,33 @@
+#include "process-memory.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define PSAPI_VERSION 2 // resolves to the kernel32 export, so there's no need to link psapi.lib
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+std::size_t getPeakResidentMemory() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+#ifdef __APPLE__
+    return static_cast<std::size_t>(usage.ru_maxrss); // macOS reports bytes...
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024; // ...while Linux reports kilobytes
+#endif
+#endif
+}
@@ -0,0 +1,12 @@
+#ifndef PROCESS_MEMORY_HPP
+#define PROCESS_MEMORY_HPP
+
+#include <cstddef>
+
+/**
+ * Returns the largest amount of physical memory the process has occupied so far, in bytes,
+ * or 0 if the platform doesn't report it.
+ */
+std::size_t getPeakResidentMemory();
+
+#endif //PROCESS_MEMORY_HPP
@@ -0,0 +1,122 @@
+#include "thread-pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(std::size_t threadCount) {
+    threadCount = std::max<std::size_t>(threadCount, 1); // hardware_concurrency() is allowed to return 0
+
+    workers.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(tasksMutex);
+        isStopping = true;
+    }
+
+    tasksCondition.notify_all();
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(const std::size_t count, const std::size_t minChunkSize,
+                             const std::function<void(std::size_t, std::size_t)> &body) {
+    if (count == 0) {
+        return;
+    }
+
+    // a few chunks per thread evens out the load when chunks take different amounts of time
+    const std::size_t targetChunkCount = getThreadCount() * 4;
+    const std::size_t chunkSize = std::max({(count + targetChunkCount - 1) / targetChunkCount, minChunkSize,
+                                            std::size_t{1}});
+    const std::size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    if (chunkCount == 1) {
+        body(0, count);
+        return;
+    }
+
+    struct SharedState {
+        std::atomic<std::size_t> nextChunk = 0;
+        std::atomic<std::size_t> finishedChunks = 0;
+        std::mutex mutex;
+        std::condition_variable finishedCondition;
+        std::exception_ptr exception;
+    };
+
+    const auto state = std::make_shared<SharedState>();
+
+    // helpers may only get to run after the caller has already returned, so they only touch `body` after
+    // successfully claiming a chunk -- which is impossible once all of them have been processed
+    const auto processChunks = [state, &body, count, chunkSize, chunkCount] {
+        std::size_t chunk;
+        while ((chunk = state->nextChunk.fetch_add(1)) < chunkCount) {
+            const std::size_t begin = chunk * chunkSize;
+            const std::size_t end = std::min(begin + chunkSize, count);
+
+            try {
+                body(begin, end);
+            } catch (...) {
+                std::lock_guard lock(state->mutex);
+                if (!state->exception) {
+                    state->exception = std::current_exception();
+                }
+            }
+
+            if (state->finishedChunks.fetch_add(1) + 1 == chunkCount) {
+                std::lock_guard lock(state->mutex);
+                state->finishedCondition.notify_all();
+            }
+        }
+    };
+
+    const std::size_t helperCount = std::min(getThreadCount(), chunkCount - 1);
+    for (std::size_t i = 0; i < helperCount; i++) {
+        enqueue(processChunks);
+    }
+
+    processChunks();
+
+    std::unique_lock lock(state->mutex);
+    state->finishedCondition.wait(lock, [&] { return state->finishedChunks == chunkCount; });
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard lock(tasksMutex);
+        tasks.emplace(std::move(task));
+    }
+
+    tasksCondition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock lock(tasksMutex);
+            tasksCondition.wait(lock, [this] { return isStopping || !tasks.empty(); });
+
+            if (isStopping && tasks.empty()) {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        task();
+    }
+}
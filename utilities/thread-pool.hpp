@@ -0,0 +1,69 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Fixed-size pool of worker threads executing submitted tasks in FIFO order.
+ */
+class ThreadPool {
+    std::vector<std::thread> workers;
+
+    std::queue<std::function<void()>> tasks;
+    std::mutex tasksMutex;
+    std::condition_variable tasksCondition;
+    bool isStopping = false;
+
+public:
+    explicit ThreadPool(std::size_t threadCount = std::thread::hardware_concurrency());
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &other) = delete;
+
+    ThreadPool &operator=(const ThreadPool &other) = delete;
+
+    std::size_t getThreadCount() const { return workers.size(); }
+
+    /**
+     * Schedules a task to be run on one of the workers.
+     * The returned future can be used to wait for the result, or for an exception thrown by the task.
+     */
+    template<typename F>
+    std::future<std::invoke_result_t<F>> submit(F &&task) {
+        using Result = std::invoke_result_t<F>;
+
+        auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packagedTask->get_future();
+
+        enqueue([packagedTask] { (*packagedTask)(); });
+
+        return result;
+    }
+
+    /**
+     * Splits the range [0, count) into chunks of at least `minChunkSize` elements and calls `body(begin, end)`
+     * for each chunk, in parallel. Blocks until every chunk has been processed.
+     *
+     * The calling thread processes chunks as well, so this is safe to call from inside a task running on this pool:
+     * if all the workers are busy, the caller simply ends up doing all the work itself.
+     */
+    void parallelFor(std::size_t count, std::size_t minChunkSize,
+                     const std::function<void(std::size_t begin, std::size_t end)> &body);
+
+private:
+    void enqueue(std::function<void()> task);
+
+    void workerLoop();
+};
+
+#endif //THREAD_POOL_HPP
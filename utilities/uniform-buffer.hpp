@@ -0,0 +1,131 @@
+#ifndef UNIFORM_BUFFER_HPP
+#define UNIFORM_BUFFER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "gl-state.hpp"
+
+/**
+ * Constants shared by everything drawn in a frame, mirroring the std140 `FrameUniforms` block the shaders declare.
+ * Its members have to stay in the same order as the block's, at the offsets std140 puts them at -- vec3s take up a
+ * whole vec4 there, so they're stored as vec4s here.
+ */
+struct FrameUniforms {
+    static constexpr const char *BLOCK_NAME = "FrameUniforms";
+    static constexpr GLuint BINDING = 0;
+
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 lightDirection; // towards the light, w is unused
+    glm::vec4 cameraPosition; // w is unused
+};
+
+static_assert(offsetof(FrameUniforms, view) == 0);
+static_assert(offsetof(FrameUniforms, projection) == 64);
+static_assert(offsetof(FrameUniforms, lightDirection) == 128);
+static_assert(offsetof(FrameUniforms, cameraPosition) == 144);
+static_assert(sizeof(FrameUniforms) == 160);
+
+/**
+ * Constants of a single drawn object, mirroring the std140 `ObjectUniforms` block the shaders declare.
+ */
+struct ObjectUniforms {
+    static constexpr const char *BLOCK_NAME = "ObjectUniforms";
+    static constexpr GLuint BINDING = 1;
+
+    glm::mat4 model;
+    glm::mat4 normalMatrix; // transforms normals and tangents into world space
+};
+
+static_assert(offsetof(ObjectUniforms, model) == 0);
+static_assert(offsetof(ObjectUniforms, normalMatrix) == 64);
+static_assert(sizeof(ObjectUniforms) == 128);
+
+/**
+ * A uniform buffer holding any number of blocks of the same kind, each of which can be bound to the block's binding
+ * point on its own. Blocks are pushed on the CPU and then uploaded all at once, so that drawing many objects takes a
+ * single upload per frame and then just a `glBindBufferRange` per object.
+ *
+ * `GLShaders` binds every block its programs declare to the binding point of the struct mirroring it.
+ */
+template<typename Block>
+class UniformBuffer {
+    static_assert(std::is_standard_layout_v<Block> && std::is_trivially_copyable_v<Block>,
+                  "uniform blocks have to be copyable as plain bytes");
+
+    GLuint bufferID = 0;
+    std::size_t stride; // bound ranges have to start at multiples of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    std::vector<std::byte> blocks;
+
+public:
+    UniformBuffer() {
+        GLint alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        alignment = std::max(alignment, 1);
+        stride = (sizeof(Block) + alignment - 1) / alignment * alignment;
+
+        glGenBuffers(1, &bufferID);
+    }
+
+    ~UniformBuffer() {
+        getGLState().deleteBuffer(bufferID);
+    }
+
+    UniformBuffer(const UniformBuffer &other) = delete;
+
+    UniformBuffer &operator=(const UniformBuffer &other) = delete;
+
+    [[nodiscard]] std::size_t getBlockCount() const { return blocks.size() / stride; }
+
+    /**
+     * Drops all the pushed blocks, so that the next ones start from index 0 again.
+     */
+    void clear() { blocks.clear(); }
+
+    /**
+     * Appends a block, which only reaches the GPU with the next `upload`. Returns its index.
+     */
+    std::size_t push(const Block &block) {
+        const std::size_t offset = blocks.size();
+        blocks.resize(offset + stride);
+        std::memcpy(blocks.data() + offset, &block, sizeof(Block));
+
+        return offset / stride;
+    }
+
+    /**
+     * Uploads all the pushed blocks.
+     */
+    void upload() const {
+        // respecifying the whole store orphans the previous one, so draws still reading it don't stall the upload
+        getGLState().bindBuffer(GL_UNIFORM_BUFFER, bufferID);
+        glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(blocks.size()), blocks.data(), GL_STREAM_DRAW);
+    }
+
+    /**
+     * Binds the uploaded block at the given index to the block's binding point.
+     */
+    void bind(const std::size_t index) const {
+        getGLState().bindUniformBufferRange(Block::BINDING, bufferID, static_cast<GLintptr>(index * stride),
+                                            sizeof(Block));
+    }
+
+    /**
+     * Replaces all the blocks with the given one, uploads and binds it -- for blocks which there's one of at a time.
+     */
+    void update(const Block &block) {
+        clear();
+        push(block);
+        upload();
+        bind(0);
+    }
+};
+
+#endif //UNIFORM_BUFFER_HPP
@@ -0,0 +1,15 @@
+#include "vertex-layout.hpp"
+
+void VertexLayout::apply() const {
+    for (const VertexAttribute &attribute : attributes) {
+        glVertexAttribPointer(
+            attribute.location,
+            attribute.componentCount,
+            attribute.type,
+            attribute.normalized ? GL_TRUE : GL_FALSE,
+            static_cast<GLsizei>(stride),
+            reinterpret_cast<void *>(attribute.offset)
+        );
+        glEnableVertexAttribArray(attribute.location);
+    }
+}
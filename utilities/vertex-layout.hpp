@@ -0,0 +1,36 @@
+#ifndef VERTEX_LAYOUT_HPP
+#define VERTEX_LAYOUT_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+
+/**
+ * Describes how a single vertex attribute is stored in a vertex buffer.
+ * Normalized integer attributes are read by shaders as floats in [0, 1] (or [-1, 1] for signed types).
+ */
+struct VertexAttribute {
+    GLuint location;
+    GLint componentCount;
+    GLenum type;
+    bool normalized;
+    std::size_t offset;
+};
+
+/**
+ * Describes the memory layout of interleaved vertices, so that attribute setup is driven by data
+ * instead of being spelled out by hand for every vertex format.
+ */
+struct VertexLayout {
+    std::size_t stride = 0;
+    std::vector<VertexAttribute> attributes;
+
+    /**
+     * Points all the attributes at the currently bound array buffer and enables them
+     * in the currently bound vertex array.
+     */
+    void apply() const;
+};
+
+#endif //VERTEX_LAYOUT_HPP